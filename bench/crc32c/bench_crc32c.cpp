@@ -0,0 +1,104 @@
+// -*- C++ -*-
+/*!
+ * @file bench_crc32c.cpp
+ * @brief Cost of the integrity mode (CRC32C of the event data)
+ *
+ * usage: bench_crc32c [event_byte_size [event_num [loops]]]
+ *
+ * Prints throughput of the table driven and the SSE4.2 implementation
+ * and the CPU time needed to checksum a 1 GB/s data stream.  Integrity
+ * mode computes the CRC once in the sender and once in the receiver,
+ * so each side of a data path pays this cost once.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <time.h>
+
+#include "Crc32c.h"
+
+using namespace DAQMW;
+
+static double now_sec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+typedef uint32_t (*CrcFunc)(uint32_t crc, const unsigned char *data, size_t len);
+
+static double run(CrcFunc func, const std::vector<unsigned char> &buf,
+                  unsigned int event_byte_size, unsigned int event_num,
+                  int loops, uint32_t *sum)
+{
+    uint32_t s = 0;
+    double t0 = now_sec();
+    for (int l = 0; l < loops; l++) {
+        for (unsigned int i = 0; i < event_num; i++) {
+            s ^= ~func(0xffffffff, &buf[(size_t)i * event_byte_size], event_byte_size);
+        }
+    }
+    *sum = s;
+    return (now_sec() - t0) / loops;
+}
+
+static void print_result(const char *name, double t, unsigned int event_byte_size,
+                         unsigned int event_num)
+{
+    double bytes = (double)event_byte_size * event_num;
+    double gbytes_per_sec = bytes / t / 1.0e9;
+    printf("%-12s %10.2f %10.2f %12.1f\n", name, t * 1e9 / event_num,
+           gbytes_per_sec, 100.0 / gbytes_per_sec);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int event_byte_size = 1024;
+    unsigned int event_num = 100000;
+    int loops = 10;
+    if (argc > 1) {
+        event_byte_size = strtoul(argv[1], 0, 0);
+    }
+    if (argc > 2) {
+        event_num = strtoul(argv[2], 0, 0);
+    }
+    if (argc > 3) {
+        loops = atoi(argv[3]);
+    }
+
+    std::vector<unsigned char> buf((size_t)event_byte_size * event_num);
+    for (size_t i = 0; i < buf.size(); i++) {
+        buf[i] = (i * 7 + (i >> 8)) & 0xff;
+    }
+
+    // check value of the CRC32C specification
+    const unsigned char check[] = "123456789";
+    if (crc32c(check, 9) != 0xe3069283) {
+        fprintf(stderr, "### ERROR: crc32c(\"123456789\") = %08x\n", crc32c(check, 9));
+        return 1;
+    }
+
+    printf("event byte size %u, %u events, %d loops\n", event_byte_size, event_num, loops);
+    printf("%-12s %10s %10s %12s\n", "", "ns/event", "GB/s", "CPU% @1GB/s");
+
+    uint32_t sum_sw;
+    double t_sw = run(crc32c_sw, buf, event_byte_size, event_num, loops, &sum_sw);
+    print_result("table", t_sw, event_byte_size, event_num);
+
+#ifdef DAQMW_CRC32C_X86
+    if (crc32c_hw_available()) {
+        uint32_t sum_hw;
+        double t_hw = run(crc32c_hw, buf, event_byte_size, event_num, loops, &sum_hw);
+        if (sum_hw != sum_sw) {
+            fprintf(stderr, "### ERROR: sse4.2 and table results differ\n");
+            return 1;
+        }
+        print_result("sse4.2", t_hw, event_byte_size, event_num);
+        return 0;
+    }
+#endif
+    printf("sse4.2 crc32 not available on this CPU\n");
+    return 0;
+}
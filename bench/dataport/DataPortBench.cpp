@@ -0,0 +1,422 @@
+// -*- C++ -*-
+/*!
+ * @file DataPortBench.cpp
+ * @brief Source, relay or sink of the data port benchmark (run_bench.py)
+ * @date
+ * @author
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <time.h>
+#include "DataPortBench.h"
+
+using DAQMW::FatalType::DATAPATH_DISCONNECTED;
+using DAQMW::FatalType::CANNOT_OPEN_FILE;
+
+// Module specification
+// Change following items to suit your component's spec.
+static const char* dataportbench_spec[] =
+{
+    "implementation_id", "DataPortBench",
+    "type_name",         "DataPortBench",
+    "description",       "Data port benchmark component",
+    "version",           "1.0",
+    "vendor",            "Kazuo Nakayoshi, KEK",
+    "category",          "example",
+    "activity_type",     "DataFlowComponent",
+    "max_instance",      "1",
+    "language",          "C++",
+    "lang_type",         "compile",
+    ""
+};
+
+DataPortBench::DataPortBench(RTC::Manager* manager)
+    : DAQMW::DaqComponentBase(manager),
+      m_InPort("bench_in", m_in_data),
+      m_OutPort("bench_out", m_out_data),
+      m_role(ROLE_SINK),
+      m_event_byte_size(1024),
+      m_buffer_length(0),
+      m_hops(0),
+      m_out_pending(false),
+      m_recv_byte_size(0),
+      m_latency_num(0),
+      m_latency_max_usec(0),
+      m_random(0x9e3779b97f4a7c15ULL),
+      m_recv_events(0),
+      m_recv_bytes(0),
+      m_first_nsec(0),
+      m_last_nsec(0),
+      m_debug(false)
+{
+    // Registration: InPort/OutPort/Service
+
+    // Set InPort/OutPort buffers
+    registerInPort("bench_in", m_InPort);
+    registerOutPort("bench_out", m_OutPort);
+
+    using namespace std::placeholders;
+    m_drain_func = std::bind(&DataPortBench::record_frame, this, _1, _2);
+
+    init_command_port();
+    init_state_table();
+    set_comp_name("DATAPORTBENCH");
+}
+
+DataPortBench::~DataPortBench()
+{
+}
+
+RTC::ReturnCode_t DataPortBench::onInitialize()
+{
+    if (m_debug) {
+        std::cerr << "DataPortBench::onInitialize()" << std::endl;
+    }
+
+    return RTC::RTC_OK;
+}
+
+RTC::ReturnCode_t DataPortBench::onExecute(RTC::UniqueId ec_id)
+{
+    daq_do();
+
+    return RTC::RTC_OK;
+}
+
+int DataPortBench::daq_dummy()
+{
+    return 0;
+}
+
+int DataPortBench::daq_configure()
+{
+    std::cerr << "*** DataPortBench::configure" << std::endl;
+
+    ::NVList* paramList;
+    paramList = m_daq_service0.getCompParams();
+    parse_params(paramList);
+
+    return 0;
+}
+
+int DataPortBench::parse_params(::NVList* list)
+{
+    std::cerr << "param list length:" << (*list).length() << std::endl;
+
+    m_role = ROLE_SINK;
+    m_event_byte_size = 1024;
+    m_result_file = "/tmp/daqmw/bench.csv";
+    m_transport = "corba_cdr";
+    m_buffer_length = 0;
+    m_hops = 0;
+
+    int len = (*list).length();
+    for (int i = 0; i < len; i+=2) {
+        std::string sname  = (std::string)(*list)[i].value;
+        std::string svalue = (std::string)(*list)[i+1].value;
+
+        std::cerr << "sname: " << sname << "  ";
+        std::cerr << "value: " << svalue << std::endl;
+
+        if (sname == "role") {
+            if (svalue == "source") {
+                m_role = ROLE_SOURCE;
+            }
+            else if (svalue == "relay") {
+                m_role = ROLE_RELAY;
+            }
+            else if (svalue == "sink") {
+                m_role = ROLE_SINK;
+            }
+            else {
+                std::cerr << "### ERROR: role must be source, relay or sink: "
+                          << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+        }
+        else if (sname == "eventByteSize") {
+            int size = atoi(svalue.c_str());
+            if (size < (int)sizeof(uint64_t)) {
+                std::cerr << "### ERROR: eventByteSize must be at least "
+                          << sizeof(uint64_t) << ": " << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+            m_event_byte_size = size;
+        }
+        else if (sname == "resultFile") {
+            m_result_file = svalue;
+        }
+        else if (sname == "transport") {
+            m_transport = svalue;
+        }
+        else if (sname == "bufferLength") {
+            m_buffer_length = atoi(svalue.c_str());
+        }
+        else if (sname == "hops") {
+            m_hops = atoi(svalue.c_str());
+        }
+    }
+
+    return 0;
+}
+
+int DataPortBench::daq_unconfigure()
+{
+    std::cerr << "*** DataPortBench::unconfigure" << std::endl;
+
+    return 0;
+}
+
+int DataPortBench::daq_start()
+{
+    std::cerr << "*** DataPortBench::start" << std::endl;
+
+    m_out_pending = false;
+    if (m_role != ROLE_SINK && !check_dataPort_connections(m_OutPort)) {
+        std::cerr << "### NO Connection: bench_out" << std::endl;
+        fatal_error_report(DATAPATH_DISCONNECTED);
+    }
+
+    if (m_role == ROLE_SOURCE) {
+        // the payload pattern is written once, only the time stamp
+        // changes per event
+        unsigned char* data = reserve_frame(m_out_data, m_event_byte_size);
+        for (unsigned int i = 0; i < m_event_byte_size; i++) {
+            data[i] = (i % 256);
+        }
+    }
+    else if (m_role == ROLE_SINK) {
+        m_latency_usec.clear();
+        m_latency_usec.reserve(MAX_LATENCY_SAMPLES);
+        m_latency_num = 0;
+        m_latency_max_usec = 0;
+        m_recv_events = 0;
+        m_recv_bytes = 0;
+        m_first_nsec = 0;
+        m_last_nsec = 0;
+    }
+
+    return 0;
+}
+
+int DataPortBench::daq_stop()
+{
+    std::cerr << "*** DataPortBench::stop" << std::endl;
+
+    if (m_role == ROLE_SINK) {
+        write_result();
+    }
+
+    return 0;
+}
+
+int DataPortBench::daq_pause()
+{
+    std::cerr << "*** DataPortBench::pause" << std::endl;
+
+    return 0;
+}
+
+int DataPortBench::daq_resume()
+{
+    std::cerr << "*** DataPortBench::resume" << std::endl;
+
+    return 0;
+}
+
+uint64_t DataPortBench::now_nsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t DataPortBench::next_random()
+{
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 7;
+    m_random ^= m_random << 17;
+    return m_random;
+}
+
+int DataPortBench::run_source()
+{
+    if (check_trans_lock()) {  // check if stop command has come
+        set_trans_unlock();    // transit to CONFIGURED state
+        return 0;
+    }
+
+    if (!m_out_pending) {
+        unsigned char* data = reserve_frame(m_out_data, m_event_byte_size);
+        uint64_t t = now_nsec();
+        memcpy(data, &t, sizeof(t));
+        commit_frame(m_out_data, m_event_byte_size);
+        m_out_pending = true;
+    }
+
+    int ret = write_OutPort_flow(m_OutPort);
+    if (ret < 0) { // no free slot yet
+        return 0;
+    }
+    m_out_pending = false;
+    inc_sequence_num();                          // dropped too, see write_OutPort_flow()
+    if (ret > 0) {
+        inc_total_data_size(m_event_byte_size);  // increase total data byte size
+    }
+
+    return 0;
+}
+
+int DataPortBench::run_relay()
+{
+    if (!m_out_pending) {
+        if (!m_InPort.read()) {
+            BufferStatus in_status = check_inPort_status(m_InPort);
+            if (in_status == BUF_TIMEOUT && check_trans_lock()) {
+                set_trans_unlock();
+            }
+            else if (in_status == BUF_FATAL) {
+                fatal_error_report(DAQMW::FatalType::INPORT_ERROR);
+            }
+            return 0;
+        }
+        m_recv_byte_size = m_in_data.data.length();
+        check_header_footer(m_in_data, m_recv_byte_size);
+        unsigned int event_byte_size = get_event_size(m_recv_byte_size);
+        unsigned char* data = reserve_frame(m_out_data, event_byte_size);
+        memcpy(data, &(m_in_data.data[HEADER_BYTE_SIZE]), event_byte_size);
+        commit_frame(m_out_data, event_byte_size);
+        m_out_pending = true;
+    }
+
+    if (write_OutPort_flow(m_OutPort) < 0) { // no free slot yet
+        return 0;
+    }
+    m_out_pending = false;
+
+    inc_sequence_num();                      // increase sequence num.
+    inc_total_data_size(get_event_size(m_recv_byte_size));
+
+    return 0;
+}
+
+int DataPortBench::record_frame(RTC::TimedOctetSeq& in_data, unsigned int frame_byte_size)
+{
+    uint64_t now = now_nsec();
+    check_header_footer(in_data, frame_byte_size);
+    unsigned int event_byte_size = get_event_size(frame_byte_size);
+    if (event_byte_size >= sizeof(uint64_t)) {
+        uint64_t sent;
+        memcpy(&sent, &(in_data.data[HEADER_BYTE_SIZE]), sizeof(sent));
+        uint32_t latency = now > sent ? (now - sent) / 1000 : 0;
+        if (latency > m_latency_max_usec) {
+            m_latency_max_usec = latency;
+        }
+        // algorithm R: the n-th latency replaces a random sample with
+        // probability MAX_LATENCY_SAMPLES / n
+        m_latency_num++;
+        if (m_latency_usec.size() < MAX_LATENCY_SAMPLES) {
+            m_latency_usec.push_back(latency);
+        }
+        else {
+            uint64_t i = next_random() % m_latency_num;
+            if (i < MAX_LATENCY_SAMPLES) {
+                m_latency_usec[i] = latency;
+            }
+        }
+    }
+    if (m_recv_events == 0) {
+        m_first_nsec = now;
+    }
+    m_last_nsec = now;
+    m_recv_events++;
+    m_recv_bytes += event_byte_size;
+
+    inc_sequence_num();                    // increase sequence num.
+    inc_total_data_size(event_byte_size);  // increase total data byte size
+
+    return 0;
+}
+
+int DataPortBench::run_sink()
+{
+    if (drain_InPort(m_InPort, m_in_data, m_drain_func) == 0
+        && check_trans_lock()) {
+        set_trans_unlock();
+    }
+
+    return 0;
+}
+
+int DataPortBench::write_result()
+{
+    double seconds = (m_last_nsec - m_first_nsec) * 1.0e-9;
+    double events_per_sec = 0.0;
+    double mbyte_per_sec = 0.0;
+    // the first event starts the clock
+    if (seconds > 0.0 && m_recv_events > 1) {
+        events_per_sec = (m_recv_events - 1) / seconds;
+        mbyte_per_sec = m_recv_bytes * (m_recv_events - 1) / m_recv_events / seconds / 1.0e6;
+    }
+    uint32_t p50 = 0, p99 = 0, max = m_latency_max_usec;
+    if (!m_latency_usec.empty()) {
+        std::vector<uint32_t>& lat = m_latency_usec;
+        size_t n = lat.size();
+        std::nth_element(lat.begin(), lat.begin() + n / 2, lat.end());
+        p50 = lat[n / 2];
+        std::nth_element(lat.begin(), lat.begin() + n * 99 / 100, lat.end());
+        p99 = lat[n * 99 / 100];
+    }
+
+    FILE* fp = fopen(m_result_file.c_str(), "a");
+    if (fp == NULL) {
+        std::cerr << "### ERROR: cannot open " << m_result_file << std::endl;
+        fatal_error_report(CANNOT_OPEN_FILE);
+    }
+    if (ftell(fp) == 0) {
+        fprintf(fp, "transport,event_byte_size,buffer_length,hops,events,seconds,"
+                    "events_per_sec,mbyte_per_sec,p50_usec,p99_usec,max_usec\n");
+    }
+    unsigned int event_byte_size = m_recv_events > 0 ? m_recv_bytes / m_recv_events : 0;
+    fprintf(fp, "%s,%u,%u,%u,%llu,%.3f,%.1f,%.1f,%u,%u,%u\n",
+            m_transport.c_str(), event_byte_size, m_buffer_length, m_hops,
+            m_recv_events, seconds, events_per_sec, mbyte_per_sec, p50, p99, max);
+    fclose(fp);
+
+    std::cerr << "events: " << m_recv_events << " events/s: " << events_per_sec
+              << " MB/s: " << mbyte_per_sec << " latency p50/p99/max usec: "
+              << p50 << "/" << p99 << "/" << max << std::endl;
+
+    return 0;
+}
+
+int DataPortBench::daq_run()
+{
+    if (m_debug) {
+        std::cerr << "*** DataPortBench::run" << std::endl;
+    }
+
+    switch (m_role) {
+    case ROLE_SOURCE:
+        return run_source();
+    case ROLE_RELAY:
+        return run_relay();
+    case ROLE_SINK:
+        return run_sink();
+    }
+
+    return 0;
+}
+
+extern "C"
+{
+    void DataPortBenchInit(RTC::Manager* manager)
+    {
+        RTC::Properties profile(dataportbench_spec);
+        manager->registerFactory(profile,
+                    RTC::Create<DataPortBench>,
+                    RTC::Delete<DataPortBench>);
+    }
+};
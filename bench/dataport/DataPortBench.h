@@ -0,0 +1,125 @@
+// -*- C++ -*-
+/*!
+ * @file DataPortBench.h
+ * @brief Source, relay or sink of the data port benchmark (run_bench.py)
+ * @date
+ * @author
+ *
+ */
+
+#ifndef DATAPORTBENCH_H
+#define DATAPORTBENCH_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "DaqComponentBase.h"
+
+using namespace RTC;
+
+/*!
+ * @class DataPortBench
+ * @brief TinySource/TinySink style component measuring a data port chain
+ *
+ *   <param pid="role">source</param>        source, relay or sink
+ *   <param pid="eventByteSize">1024</param> source: event data size (>= 8)
+ *   <param pid="resultFile">/tmp/daqmw/bench.csv</param>  sink
+ *   <param pid="transport">shm</param>      sink: copied to the result
+ *   <param pid="bufferLength">8</param>     sink: copied to the result
+ *   <param pid="hops">2</param>             sink: copied to the result
+ *
+ * The source sends frames as fast as the chain takes them
+ * (write_OutPort_flow(), backpressure block) and puts the send time
+ * (CLOCK_MONOTONIC nsec, all components on one host) into the first 8
+ * bytes of the event data.  A relay forwards the event data unchanged.
+ * The sink measures the latency of every event, keeps a uniform random
+ * sample of at most MAX_LATENCY_SAMPLES of them for the percentiles
+ * (reservoir sampling, so a long run is sampled from start to end) and
+ * the exact maximum, and at stop appends one CSV line to resultFile:
+ *
+ *   transport,event_byte_size,buffer_length,hops,events,seconds,
+ *   events_per_sec,mbyte_per_sec,p50_usec,p99_usec,max_usec
+ *
+ * Throughput is measured from the first to the last event received.
+ */
+class DataPortBench
+    : public DAQMW::DaqComponentBase
+{
+public:
+    DataPortBench(RTC::Manager* manager);
+    ~DataPortBench();
+
+    // The initialize action (on CREATED->ALIVE transition)
+    // former rtc_init_entry()
+    virtual RTC::ReturnCode_t onInitialize();
+
+    // The execution action that is invoked periodically
+    // former rtc_active_do()
+    virtual RTC::ReturnCode_t onExecute(RTC::UniqueId ec_id);
+
+private:
+    enum Role {
+        ROLE_SOURCE,
+        ROLE_RELAY,
+        ROLE_SINK
+    };
+
+    TimedOctetSeq          m_in_data;
+    InPort<TimedOctetSeq>  m_InPort;
+
+    TimedOctetSeq          m_out_data;
+    OutPort<TimedOctetSeq> m_OutPort;
+
+private:
+    int daq_dummy();
+    int daq_configure();
+    int daq_unconfigure();
+    int daq_start();
+    int daq_run();
+    int daq_stop();
+    int daq_pause();
+    int daq_resume();
+
+    int parse_params(::NVList* list);
+    int run_source();
+    int run_relay();
+    int run_sink();
+    int record_frame(RTC::TimedOctetSeq& in_data, unsigned int frame_byte_size);
+    int write_result();
+    static uint64_t now_nsec();
+    uint64_t next_random();
+
+    static const unsigned int MAX_LATENCY_SAMPLES = 1 << 22;
+
+    Role m_role;
+    unsigned int m_event_byte_size;
+    std::string m_result_file;
+    std::string m_transport;
+    unsigned int m_buffer_length;
+    unsigned int m_hops;
+
+    bool m_out_pending;
+    unsigned int m_recv_byte_size;
+    DrainFunc m_drain_func;
+
+    // sink
+    std::vector<uint32_t> m_latency_usec;  // reservoir
+    unsigned long long m_latency_num;      // latencies measured
+    uint32_t m_latency_max_usec;
+    uint64_t m_random;                     // xorshift64 state
+    unsigned long long m_recv_events;
+    unsigned long long m_recv_bytes;
+    uint64_t m_first_nsec;
+    uint64_t m_last_nsec;
+
+    bool m_debug;
+};
+
+
+extern "C"
+{
+    void DataPortBenchInit(RTC::Manager* manager);
+};
+
+#endif // DATAPORTBENCH_H
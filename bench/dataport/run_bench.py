@@ -0,0 +1,282 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""Data port throughput and latency benchmark.
+
+Runs a chain source -> relay ... -> sink of DataPortBench components on
+this host for every combination of event size, buffer length, number of
+hops (data port connections) and transport, and collects one CSV line
+per run (see DataPortBench.h) in the result file.
+
+The chain is driven by run.py in console mode (-c -l): configure, start,
+run for --duration seconds, stop.  Every step waits for the states the
+DaqOperator console shows, and -M raises omniORB giopMaxMsgSize above
+the event size.  Needs OpenRTM-aist, omniNames and run.py like any DAQ-
+Middleware system on one host.
+
+usage: run_bench.py [options]
+"""
+
+import optparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+SIZES = '64,1k,16k,256k,4M'
+BUFFERS = '8,64'
+HOPS = '1,2,4'
+TRANSPORTS = 'corba_cdr,shm'
+
+
+def parse_size(s):
+    units = {'k': 1024, 'K': 1024, 'm': 1024 * 1024, 'M': 1024 * 1024}
+    if s[-1] in units:
+        return int(s[:-1]) * units[s[-1]]
+    return int(s)
+
+
+def port_attrs(transport, buffer_length):
+    attrs = ' buffer_length="%d"' % buffer_length
+    if transport != 'corba_cdr':
+        attrs += ' transport="%s"' % transport
+    return attrs
+
+
+def component(name, exec_dir, start_ord, in_from, out, params, transport, buffer_length):
+    lines = []
+    lines.append('                <component cid="%s">' % name)
+    lines.append('                    <hostAddr>127.0.0.1</hostAddr>')
+    lines.append('                    <hostPort>50000</hostPort>')
+    lines.append('                    <instName>%s.rtc</instName>' % name)
+    lines.append('                    <execPath>%s/%s</execPath>' % (exec_dir, name))
+    lines.append('                    <confFile>/tmp/daqmw/rtc.conf</confFile>')
+    lines.append('                    <startOrd>%d</startOrd>' % start_ord)
+    lines.append('                    <inPorts>')
+    if in_from:
+        lines.append('                        <inPort from="%s:bench_out"%s>bench_in</inPort>'
+                     % (in_from, port_attrs(transport, buffer_length)))
+    lines.append('                    </inPorts>')
+    lines.append('                    <outPorts>')
+    if out:
+        lines.append('                        <outPort buffer_length="%d">bench_out</outPort>'
+                     % buffer_length)
+    lines.append('                    </outPorts>')
+    lines.append('                    <params>')
+    for pid, value in params:
+        lines.append('                        <param pid="%s">%s</param>' % (pid, value))
+    lines.append('                    </params>')
+    lines.append('                </component>')
+    return lines
+
+
+def make_config(exec_dir, size, buffer_length, hops, transport, result_file):
+    """hops data port connections: hops - 1 relays between source and sink"""
+    names = ['BenchSource'] + ['BenchRelay%d' % i for i in range(1, hops)] + ['BenchSink']
+    comps = []
+    for i, name in enumerate(names):
+        if i == 0:
+            role = 'source'
+        elif i == len(names) - 1:
+            role = 'sink'
+        else:
+            role = 'relay'
+        params = [('role', role)]
+        if role == 'source':
+            params.append(('eventByteSize', size))
+        if role == 'sink':
+            params += [('resultFile', result_file), ('transport', transport),
+                       ('bufferLength', buffer_length), ('hops', hops)]
+        in_from = names[i - 1] if i > 0 else None
+        # the sink starts first, the source last
+        comps += component(name, exec_dir, len(names) - i, in_from,
+                           role != 'sink', params, transport, buffer_length)
+
+    lines = ['<?xml version="1.0"?>',
+             '<configInfo>',
+             '    <daqOperator>',
+             '        <hostAddr>127.0.0.1</hostAddr>',
+             '    </daqOperator>',
+             '    <daqGroups>',
+             '        <daqGroup gid="group0">',
+             '            <components>']
+    lines += comps
+    lines += ['            </components>',
+              '        </daqGroup>',
+              '    </daqGroups>',
+              '</configInfo>']
+    return names, '\n'.join(lines) + '\n'
+
+
+class ConsoleStates(object):
+    """last state of every component shown by the DaqOperator console
+
+    The console redraws a table "GROUP:COMP_NAME EVENT_SIZE STATE
+    COMP_STATUS" with ANSI escapes on stderr; a thread reads it.
+    """
+
+    STATES = ('LOADED', 'CONFIGURED', 'RUNNING', 'PAUSED')
+
+    def __init__(self, stream, names):
+        self.names = names
+        self.states = {}
+        self.lock = threading.Lock()
+        self.thread = threading.Thread(target=self.read, args=(stream,))
+        self.thread.daemon = True
+        self.thread.start()
+
+    def read(self, stream):
+        escape = re.compile(r'\x1b\[[0-9;]*[A-Za-z]')
+        for line in iter(stream.readline, b''):
+            words = escape.sub(' ', line.decode('utf-8', 'replace')).split()
+            if len(words) >= 3 and words[2] in self.STATES:
+                name = words[0].split(':')[-1]
+                if name in self.names:
+                    with self.lock:
+                        self.states[name] = words[2]
+
+    def forget(self):
+        """states shown before a command do not count"""
+        with self.lock:
+            self.states = {}
+
+    def wait(self, state, timeout):
+        end = time.time() + timeout
+        while time.time() < end:
+            with self.lock:
+                if all(self.states.get(name) == state for name in self.names):
+                    return True
+            time.sleep(0.1)
+        return False
+
+
+def file_size(path):
+    try:
+        return os.path.getsize(path)
+    except OSError:
+        return 0
+
+
+def wait_growth(path, old_size, timeout):
+    end = time.time() + timeout
+    while time.time() < end:
+        if file_size(path) > old_size:
+            return True
+        time.sleep(0.1)
+    return False
+
+
+def giop_max_msg_size(size):
+    """omniORB rejects GIOP messages above 2 MB by default"""
+    return max(2 * 1024 * 1024, size + 1024 * 1024)
+
+
+def run_one(run_py, config_file, names, size, result_file, duration, timeout):
+    """configure, start, stop and unconfigure by DaqOperator console commands
+
+    Every command waits until all components show the new state, at most
+    timeout seconds.  Returns False if a run did not complete.
+    """
+    p = subprocess.Popen([run_py, '-c', '-l', '-M', str(giop_max_msg_size(size)),
+                          config_file],
+                         stdin=subprocess.PIPE,
+                         stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    console = ConsoleStates(p.stderr, names)
+    result_size = file_size(result_file)
+
+    def command(line, state):
+        console.forget()
+        p.stdin.write(line.encode())
+        p.stdin.flush()
+        if not console.wait(state, timeout):
+            print('ERROR: components not %s after %g seconds' % (state, timeout))
+            return False
+        return True
+
+    try:
+        if not console.wait('LOADED', timeout):     # components booted
+            print('ERROR: components not booted after %g seconds' % timeout)
+            return False
+        if not command('0\n', 'CONFIGURED'):
+            return False
+        if not command('1\n1\n', 'RUNNING'):      # run number 1
+            return False
+        time.sleep(duration)
+        if not command('2\n', 'CONFIGURED'):
+            return False
+        # the sink writes the result in daq_stop()
+        if not wait_growth(result_file, result_size, timeout):
+            print('ERROR: no result in %s' % result_file)
+            return False
+        command('3\n', 'LOADED')
+        return True
+    finally:
+        p.terminate()
+        p.wait()
+
+
+def main():
+    parser = optparse.OptionParser(usage='%prog [options]')
+    parser.add_option('--sizes', default=SIZES,
+                      help='event byte sizes [default: %default]')
+    parser.add_option('--buffers', default=BUFFERS,
+                      help='buffer lengths [default: %default]')
+    parser.add_option('--hops', default=HOPS,
+                      help='data port connections in the chain [default: %default]')
+    parser.add_option('--transports', default=TRANSPORTS,
+                      help='corba_cdr, shm [default: %default]')
+    parser.add_option('--duration', type='float', default=5.0,
+                      help='seconds per run [default: %default]')
+    parser.add_option('--timeout', type='float', default=30.0,
+                      help='seconds to wait at most for boot and every state transition'
+                      ' [default: %default]')
+    parser.add_option('-o', '--output', default='dataport-bench.csv',
+                      help='result CSV, appended [default: %default]')
+    parser.add_option('--comp', default='./DataPortBenchComp',
+                      help='DataPortBench executable [default: %default]')
+    parser.add_option('--run-py', default='run.py',
+                      help='run.py of DAQ-Middleware [default: %default]')
+    (options, args) = parser.parse_args()
+
+    comp = os.path.abspath(options.comp)
+    if not os.access(comp, os.X_OK):
+        sys.exit('ERROR: %s not found, run make first' % comp)
+    result_file = os.path.abspath(options.output)
+
+    work_dir = tempfile.mkdtemp(prefix='daqmw-bench-')
+    sizes = [parse_size(s) for s in options.sizes.split(',')]
+    buffers = [int(s) for s in options.buffers.split(',')]
+    hops_list = [int(s) for s in options.hops.split(',')]
+    transports = options.transports.split(',')
+    failed = 0
+
+    for transport in transports:
+        for hops in hops_list:
+            for buffer_length in buffers:
+                for size in sizes:
+                    names, config = make_config(work_dir, size, buffer_length,
+                                                hops, transport, result_file)
+                    for name in names:
+                        link = os.path.join(work_dir, name)
+                        if not os.path.lexists(link):
+                            os.symlink(comp, link)
+                    config_file = os.path.join(work_dir, 'bench.xml')
+                    with open(config_file, 'w') as f:
+                        f.write(config)
+                    print('%s size %d buffer %d hops %d'
+                          % (transport, size, buffer_length, hops))
+                    sys.stdout.flush()
+                    if not run_one(options.run_py, config_file, names, size,
+                                   result_file, options.duration, options.timeout):
+                        failed += 1
+
+    print('results: %s' % result_file)
+    if failed:
+        sys.exit('ERROR: %d runs failed' % failed)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,142 @@
+// -*- C++ -*-
+/*!
+ * @file bench_event_merger.cpp
+ * @brief Merge cost of EventMerger at 1, 8 and 32 inputs
+ *
+ * usage: bench_event_merger [fragment_byte_size [event_num [batch]]]
+ *
+ * Every input delivers batch fragments in turn, as an event builder
+ * draining its InPorts one after the other sees them.  The time per
+ * event and per fragment includes copying the fragments into the
+ * merger and taking the built events out in order.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <time.h>
+
+#include "EventMerger.h"
+
+using namespace DAQMW;
+
+static double now_sec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+/*
+ * Returns the number of events built in order, or -1 on error.
+ * The fragment of every (missing_every)th event of input 0 is not sent
+ * (0: none), those events come out incomplete when max_pending is hit.
+ */
+static long long run(EventMerger &merger, unsigned int input_num,
+                     const std::vector<unsigned char> &fragment,
+                     unsigned int event_num, unsigned int batch,
+                     unsigned int missing_every)
+{
+    unsigned long long built = 0;
+    uint64_t expected = 0;
+    for (unsigned int first = 0; first < event_num; first += batch) {
+        unsigned int last = first + batch;
+        if (last > event_num) {
+            last = event_num;
+        }
+        for (unsigned int input = 0; input < input_num; input++) {
+            for (unsigned int ev = first; ev < last; ev++) {
+                if (missing_every > 0 && input == 0 && ev % missing_every == 0) {
+                    continue;
+                }
+                if (merger.add(input, ev, &fragment[0], fragment.size()) != EventMerger::ADD_OK) {
+                    return -1;
+                }
+            }
+        }
+        while (const EventMerger::Event *e = merger.ready()) {
+            if (e->number() != expected) {
+                return -1;
+            }
+            expected++;
+            built++;
+            merger.pop();
+        }
+    }
+    while (const EventMerger::Event *e = merger.front()) {
+        if (e->number() < expected) {
+            return -1;
+        }
+        expected = e->number() + 1;
+        built++;
+        merger.pop();
+    }
+    return built;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int fragment_byte_size = 256;
+    unsigned int event_num = 200000;
+    unsigned int batch = 64;
+    if (argc > 1) {
+        fragment_byte_size = strtoul(argv[1], 0, 0);
+    }
+    if (argc > 2) {
+        event_num = strtoul(argv[2], 0, 0);
+    }
+    if (argc > 3) {
+        batch = strtoul(argv[3], 0, 0);
+    }
+    if (batch == 0) {
+        batch = 1;
+    }
+
+    std::vector<unsigned char> fragment(fragment_byte_size);
+    for (unsigned int i = 0; i < fragment_byte_size; i++) {
+        fragment[i] = i & 0xff;
+    }
+
+    const unsigned int inputs[] = { 1, 8, 32 };
+    printf("fragment byte size %u, %u events, batch %u\n",
+           fragment_byte_size, event_num, batch);
+    printf("%-8s %12s %12s %12s\n", "inputs", "ns/event", "ns/fragment", "MB/s");
+    for (unsigned int k = 0; k < sizeof(inputs) / sizeof(inputs[0]); k++) {
+        unsigned int input_num = inputs[k];
+        EventMerger merger;
+
+        // warm up the event buffers, then measure
+        merger.init(input_num, 0);
+        run(merger, input_num, fragment, batch * 2, batch, 0);
+        merger.init(input_num, 0);
+        double t0 = now_sec();
+        long long built = run(merger, input_num, fragment, event_num, batch, 0);
+        double t = now_sec() - t0;
+        if (built != (long long)event_num || merger.get_complete() != event_num
+            || merger.get_incomplete() != 0) {
+            fprintf(stderr, "### ERROR: %u inputs: built %lld complete %llu incomplete %llu (expected %u)\n",
+                    input_num, built, merger.get_complete(), merger.get_incomplete(), event_num);
+            return 1;
+        }
+        double fragments = (double)event_num * input_num;
+        printf("%-8u %12.1f %12.1f %12.1f\n", input_num,
+               t * 1e9 / event_num, t * 1e9 / fragments,
+               fragments * fragment_byte_size / 1.0e6 / t);
+    }
+
+    // incomplete events: input 0 misses every 100th event, max_pending
+    // forces them out behind the complete ones, still in order
+    EventMerger merger;
+    unsigned int input_num = 8;
+    merger.init(input_num, 0, batch);
+    long long built = run(merger, input_num, fragment, event_num, batch, 100);
+    unsigned long long missing = (event_num + 99) / 100;
+    if (built != (long long)event_num || merger.get_incomplete() != missing) {
+        fprintf(stderr, "### ERROR: missing fragments: built %lld incomplete %llu (expected %u, %llu)\n",
+                built, merger.get_incomplete(), event_num, missing);
+        return 1;
+    }
+    printf("incomplete events: %llu of %lld built in order\n", merger.get_incomplete(), built);
+
+    return 0;
+}
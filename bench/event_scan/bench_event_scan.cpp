@@ -0,0 +1,170 @@
+// -*- C++ -*-
+/*!
+ * @file bench_event_scan.cpp
+ * @brief Compare per-event header/footer check with scan_frames()
+ *
+ * usage: bench_event_scan [event_byte_size [event_num [loops]]]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <time.h>
+
+#include "EventScan.h"
+
+using namespace DAQMW;
+
+static double now_sec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+static void set_frame(unsigned char *p, unsigned int size, unsigned int seq)
+{
+    p[0] = 0xe7;
+    p[1] = 0xe7;
+    p[2] = 0;
+    p[3] = 0;
+    p[4] = (size >> 24) & 0xff;
+    p[5] = (size >> 16) & 0xff;
+    p[6] = (size >> 8) & 0xff;
+    p[7] = size & 0xff;
+    for (unsigned int i = 0; i < size; i++) {
+        p[8 + i] = i & 0xff;
+    }
+    unsigned char *f = p + 8 + size;
+    f[0] = 0xcc;
+    f[1] = 0xcc;
+    f[2] = 0;
+    f[3] = 0;
+    f[4] = (seq >> 24) & 0xff;
+    f[5] = (seq >> 16) & 0xff;
+    f[6] = (seq >> 8) & 0xff;
+    f[7] = seq & 0xff;
+}
+
+/*
+ * Same checks as DaqComponentBase::check_header_footer(), one frame
+ * per call: header and footer copied to stack arrays, size and sequence
+ * number decoded with shifts.
+ */
+static bool check_one_frame(const unsigned char *frame, unsigned int frame_byte_size,
+                            unsigned int loop)
+{
+    unsigned char header[8];
+    unsigned char footer[8];
+    for (unsigned int i = 0; i < 8; i++) {
+        header[i] = frame[i];
+    }
+    if (header[0] != 0xe7 || header[1] != 0xe7) {
+        return false;
+    }
+    unsigned int event_size = (header[4] << 24) + (header[5] << 16)
+                            + (header[6] << 8) + header[7];
+    if (event_size != frame_byte_size - 16) {
+        return false;
+    }
+    for (unsigned int i = 0; i < 8; i++) {
+        footer[i] = frame[frame_byte_size - 8 + i];
+    }
+    if (footer[0] != 0xcc || footer[1] != 0xcc) {
+        return false;
+    }
+    unsigned int seq_num = (footer[4] << 24) + (footer[5] << 16)
+                         + (footer[6] << 8) + footer[7];
+    return seq_num == loop;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int event_byte_size = 8;
+    unsigned int event_num = 1000000;
+    int loops = 20;
+    if (argc > 1) {
+        event_byte_size = strtoul(argv[1], 0, 0);
+    }
+    if (argc > 2) {
+        event_num = strtoul(argv[2], 0, 0);
+    }
+    if (argc > 3) {
+        loops = atoi(argv[3]);
+    }
+
+    unsigned int frame_byte_size = event_byte_size + 16;
+    std::vector<unsigned char> buf((size_t)frame_byte_size * event_num);
+    for (unsigned int i = 0; i < event_num; i++) {
+        set_frame(&buf[(size_t)i * frame_byte_size], event_byte_size, i);
+    }
+    std::vector<unsigned int> offsets;
+    offsets.reserve(event_num);
+    EventScanResult res;
+    scan_init_result(&res);
+
+    // per event path
+    double t0 = now_sec();
+    unsigned int good = 0;
+    for (int l = 0; l < loops; l++) {
+        good = 0;
+        unsigned int pos = 0;
+        for (unsigned int i = 0; i < event_num; i++) {
+            if (!check_one_frame(&buf[pos], frame_byte_size, i)) {
+                break;
+            }
+            good++;
+            pos += frame_byte_size;
+        }
+    }
+    double t_per_event = (now_sec() - t0) / loops;
+
+    // scalar batch
+    t0 = now_sec();
+    for (int l = 0; l < loops; l++) {
+        offsets.clear();
+        scan_frames_scalar(&buf[0], buf.size(), &offsets, true, 0, &res);
+    }
+    double t_scalar = (now_sec() - t0) / loops;
+    unsigned int good_scalar = res.event_num;
+
+    // SIMD batch
+    t0 = now_sec();
+    for (int l = 0; l < loops; l++) {
+        offsets.clear();
+        scan_frames(&buf[0], buf.size(), &offsets, true, 0, &res);
+    }
+    double t_simd = (now_sec() - t0) / loops;
+    unsigned int good_simd = res.event_num;
+
+    if (good != event_num || good_scalar != event_num || good_simd != event_num) {
+        fprintf(stderr, "### ERROR: valid frames: per event %u scalar %u simd %u (expected %u)\n",
+                good, good_scalar, good_simd, event_num);
+        return 1;
+    }
+
+    // both batch versions must report the same first failure
+    unsigned int bad = event_num / 2;
+    buf[(size_t)bad * frame_byte_size + frame_byte_size - 1] ^= 0x01;
+    EventScanResult res_scalar;
+    scan_frames_scalar(&buf[0], buf.size(), 0, true, 0, &res_scalar);
+    scan_frames(&buf[0], buf.size(), 0, true, 0, &res);
+    if (res.error != SCAN_SEQ_MISMATCH || res.error_offset != bad * frame_byte_size
+        || res.error != res_scalar.error || res.error_offset != res_scalar.error_offset
+        || res.found_seq != res_scalar.found_seq) {
+        fprintf(stderr, "### ERROR: failure report: simd %s at %u, scalar %s at %u\n",
+                scan_error_string(res.error), res.error_offset,
+                scan_error_string(res_scalar.error), res_scalar.error_offset);
+        return 1;
+    }
+
+    double mbytes = buf.size() / 1.0e6;
+    printf("event byte size %u, %u events, %d loops\n", event_byte_size, event_num, loops);
+    printf("%-12s %10s %10s\n", "", "ns/event", "MB/s");
+    printf("%-12s %10.2f %10.1f\n", "per event", t_per_event * 1e9 / event_num, mbytes / t_per_event);
+    printf("%-12s %10.2f %10.1f\n", "scalar", t_scalar * 1e9 / event_num, mbytes / t_scalar);
+    printf("%-12s %10.2f %10.1f\n", "simd", t_simd * 1e9 / event_num, mbytes / t_simd);
+
+    return 0;
+}
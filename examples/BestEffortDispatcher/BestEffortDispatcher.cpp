@@ -39,6 +39,7 @@ BestEffortDispatcher::BestEffortDispatcher(RTC::Manager* manager)
       m_in_status(BUF_SUCCESS),
       m_out_status(BUF_SUCCESS),
       m_besteffort_out_status(BUF_SUCCESS),
+      m_besteffort_pending(false),
       m_in_tout_counts(0),
       m_out1_tout_counts(0),
       m_out2_tout_counts(0),
@@ -51,6 +52,7 @@ BestEffortDispatcher::BestEffortDispatcher(RTC::Manager* manager)
     registerInPort("dispatcher_in", m_InPort);
     registerOutPort("dispatcher_out1", m_OutPort);
     registerOutPort("dispatcher_out2", m_BestEffort_OutPort);
+    register_output_throttle("dispatcher_out2", &m_besteffort);
 
     init_command_port();
     init_state_table();
@@ -97,6 +99,8 @@ int BestEffortDispatcher::parse_params(::NVList* list)
 {
     std::cerr << "param list length:" << (*list).length() << std::endl;
 
+    m_besteffort = DAQMW::OutputThrottle(); // every frame, drop if full
+
     int len = (*list).length();
     for (int i = 0; i < len; i+=2) {
         std::string sname  = (std::string)(*list)[i].value;
@@ -104,6 +108,15 @@ int BestEffortDispatcher::parse_params(::NVList* list)
 
         std::cerr << "sname: " << sname << "  ";
         std::cerr << "value: " << svalue << std::endl;
+
+        // besteffortPrescale, besteffortRate, besteffortBurst, besteffortMode
+        if (sname.compare(0, 10, "besteffort") == 0) {
+            if (m_besteffort.set_param(sname.substr(10), svalue) < 0) {
+                std::cerr << "### ERROR: bad value of " << sname << ": "
+                          << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+        }
     }
 
     return 0;
@@ -122,6 +135,7 @@ int BestEffortDispatcher::daq_start()
     m_in_status   = BUF_SUCCESS;
     m_out_status = BUF_SUCCESS;
     m_besteffort_out_status = BUF_SUCCESS;
+    m_besteffort_pending = false;
 
     return 0;
 }
@@ -234,7 +248,8 @@ int BestEffortDispatcher::write_BestEffort_OutPort()
         if (m_besteffort_out_status == BUF_FATAL) {   // Fatal error
             fatal_error_report(OUTPORT_ERROR);
         }
-        if (m_besteffort_out_status == BUF_TIMEOUT) { // Timeout
+        if (m_besteffort_out_status == BUF_TIMEOUT ||  // Timeout
+            m_besteffort_out_status == BUF_NOBUF) {    // Full (skip policy)
             m_out2_tout_counts++;
             return -1;
         }
@@ -243,52 +258,66 @@ int BestEffortDispatcher::write_BestEffort_OutPort()
     return 0; // successfully done
 }
 
+int BestEffortDispatcher::send_BestEffort()
+{
+    if (!m_besteffort_pending) {
+        return 0;
+    }
+    if (write_BestEffort_OutPort() < 0) {
+        if (!m_besteffort.latest_only()) { // drop, next frame
+            m_besteffort.write_failed();
+            m_besteffort_pending = false;
+        }
+        return -1;
+    }
+    m_besteffort.sent();
+    m_besteffort_pending = false;
+
+    return 0;
+}
+
 int BestEffortDispatcher::daq_run()
 {
     if (m_debug) {
         std::cerr << "*** BestEffortDispatcher::run" << std::endl;
     }
 
-    std::cerr << "out1_tout_counts:" << m_out2_tout_counts << "  bestEff_tout_counts:" << m_out2_tout_counts << std::endl;
+    if (m_debug) {
+        std::cerr << "out1_tout_counts:" << m_out1_tout_counts << "  bestEff_tout_counts:" << m_out2_tout_counts << std::endl;
+    }
 
-    //if ((m_out_status != BUF_TIMEOUT) && (m_besteffort_out_status != BUF_TIMEOUT)) {
+    // The best effort output never holds up the reliable one: it only
+    // gets the frames m_besteffort accepts, after the reliable write.
     if (m_out_status != BUF_TIMEOUT) {
         m_inport_recv_data_size = read_InPort();
 
         if (m_inport_recv_data_size == 0) { // TIMEOUT
+            send_BestEffort();              // latest only: retry while idle
             return 0;
         }
         else {
             check_header_footer(m_in_data, m_inport_recv_data_size);
             set_data_OutPort(m_inport_recv_data_size);
-            set_data_BestEffort_OutPort(m_inport_recv_data_size);
+            if (m_besteffort.offer()) {
+                if (m_besteffort_pending) {
+                    m_besteffort.superseded();
+                }
+                set_data_BestEffort_OutPort(m_inport_recv_data_size);
+                m_besteffort_pending = true;
+            }
         }
     }
 
-    if (m_in_status != BUF_TIMEOUT) {
-        if (write_OutPort() < 0) { // TIMEOUT
-            ; // do nothing
-        }
-        else {
-            m_out_status = BUF_SUCCESS;
-        }
+    if (write_OutPort() < 0) { // TIMEOUT
+        return 0;
     }
+    m_out_status = BUF_SUCCESS;
 
-    if ((m_in_status != BUF_TIMEOUT) && (m_out_status != BUF_TIMEOUT)) {
-        if (write_BestEffort_OutPort() < 0) { // TIMEOUT
-            ; // do nothing
-        }
-        else {
-            m_besteffort_out_status = BUF_SUCCESS;
-        }
-    }
+    inc_sequence_num();                    // increase sequence num.
+    unsigned int event_data_size = get_event_size(m_inport_recv_data_size);
+    inc_total_data_size(event_data_size);  // increase total data byte size
 
-    if ((m_in_status  != BUF_TIMEOUT) &&
-        (m_out_status != BUF_TIMEOUT)) {
-            inc_sequence_num();                    // increase sequence num.
-            unsigned int event_data_size = get_event_size(m_inport_recv_data_size);
-            inc_total_data_size(event_data_size);  // increase total data byte size
-    }
+    send_BestEffort();
 
     return 0;
 }
@@ -56,6 +56,7 @@ private:
     unsigned int read_InPort();
     int write_OutPort();
     int write_BestEffort_OutPort();
+    int send_BestEffort();
 
     static const int SEND_BUFFER_SIZE = 4096;
     unsigned char m_data[SEND_BUFFER_SIZE];
@@ -64,6 +65,10 @@ private:
     BufferStatus m_out_status;
     BufferStatus m_besteffort_out_status;
 
+    // prescale, rate limit and latest only of dispatcher_out2
+    DAQMW::OutputThrottle m_besteffort;
+    bool m_besteffort_pending;
+
     unsigned int m_in_tout_counts;
     unsigned int m_out1_tout_counts;
     unsigned int m_out2_tout_counts;
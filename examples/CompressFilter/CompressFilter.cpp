@@ -0,0 +1,307 @@
+// -*- C++ -*-
+/*!
+ * @file CompressFilter.cpp
+ * @brief Filter compressing (or expanding) the event data of each frame
+ * @date
+ * @author
+ *
+ */
+
+#include <time.h>
+#include "CompressFilter.h"
+
+using DAQMW::FatalType::DATAPATH_DISCONNECTED;
+using DAQMW::FatalType::INPORT_ERROR;
+using DAQMW::FatalType::USER_DEFINED_ERROR1;
+
+// Module specification
+// Change following items to suit your component's spec.
+static const char* compressfilter_spec[] =
+{
+    "implementation_id", "CompressFilter",
+    "type_name",         "CompressFilter",
+    "description",       "Compression filter component",
+    "version",           "1.0",
+    "vendor",            "Kazuo Nakayoshi, KEK",
+    "category",          "example",
+    "activity_type",     "DataFlowComponent",
+    "max_instance",      "1",
+    "language",          "C++",
+    "lang_type",         "compile",
+    ""
+};
+
+CompressFilter::CompressFilter(RTC::Manager* manager)
+    : DAQMW::DaqComponentBase(manager),
+      m_InPort("compressfilter_in", m_in_data),
+      m_OutPort("compressfilter_out", m_out_data),
+      m_decompress(false),
+      m_max_raw_byte_size(DAQMW::COMPRESS_MAX_RAW_SIZE),
+      m_inport_recv_data_size(0),
+      m_out_pending(false),
+      m_debug(false)
+{
+    // Registration: InPort/OutPort/Service
+
+    // Set OutPort buffers
+    registerInPort("compressfilter_in", m_InPort);
+    registerOutPort("compressfilter_out", m_OutPort);
+
+    init_command_port();
+    init_state_table();
+    set_comp_name("COMPRESSFILTER");
+}
+
+CompressFilter::~CompressFilter()
+{
+}
+
+RTC::ReturnCode_t CompressFilter::onInitialize()
+{
+    if (m_debug) {
+        std::cerr << "CompressFilter::onInitialize()" << std::endl;
+    }
+
+    return RTC::RTC_OK;
+}
+
+RTC::ReturnCode_t CompressFilter::onExecute(RTC::UniqueId ec_id)
+{
+    daq_do();
+
+    return RTC::RTC_OK;
+}
+
+int CompressFilter::daq_dummy()
+{
+    return 0;
+}
+
+int CompressFilter::daq_configure()
+{
+    std::cerr << "*** CompressFilter::configure" << std::endl;
+
+    ::NVList* paramList;
+    paramList = m_daq_service0.getCompParams();
+    parse_params(paramList);
+
+    return 0;
+}
+
+int CompressFilter::parse_params(::NVList* list)
+{
+    std::cerr << "param list length:" << (*list).length() << std::endl;
+
+    m_decompress = false;
+    m_compressor.set_level(1);
+    m_max_raw_byte_size = DAQMW::COMPRESS_MAX_RAW_SIZE;
+
+    int len = (*list).length();
+    for (int i = 0; i < len; i+=2) {
+        std::string sname  = (std::string)(*list)[i].value;
+        std::string svalue = (std::string)(*list)[i+1].value;
+
+        std::cerr << "sname: " << sname  << "  ";
+        std::cerr << "value: " << svalue << std::endl;
+
+        if (sname == "mode") {
+            if (svalue == "compress") {
+                m_decompress = false;
+            }
+            else if (svalue == "decompress") {
+                m_decompress = true;
+            }
+            else {
+                std::cerr << "### ERROR: mode must be compress or decompress: "
+                          << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+        }
+        else if (sname == "compressLevel") {
+            if (m_compressor.set_level(atoi(svalue.c_str())) < 0) {
+                std::cerr << "### ERROR: compressLevel must be 1 to 9: "
+                          << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+        }
+        else if (sname == "maxRawByteSize") {
+            m_max_raw_byte_size = strtoul(svalue.c_str(), 0, 0);
+        }
+    }
+
+    return 0;
+}
+
+int CompressFilter::daq_unconfigure()
+{
+    std::cerr << "*** CompressFilter::unconfigure" << std::endl;
+
+    return 0;
+}
+
+int CompressFilter::daq_start()
+{
+    std::cerr << "*** CompressFilter::start" << std::endl;
+
+    m_out_pending = false;
+
+    // Check data port connections
+    if (!check_dataPort_connections(m_OutPort)) {
+        std::cerr << "### NO Connection: compressfilter_out" << std::endl;
+        fatal_error_report(DATAPATH_DISCONNECTED);
+    }
+
+    return 0;
+}
+
+int CompressFilter::daq_stop()
+{
+    std::cerr << "*** CompressFilter::stop" << std::endl;
+
+    return 0;
+}
+
+int CompressFilter::daq_pause()
+{
+    std::cerr << "*** CompressFilter::pause" << std::endl;
+
+    return 0;
+}
+
+int CompressFilter::daq_resume()
+{
+    std::cerr << "*** CompressFilter::resume" << std::endl;
+
+    return 0;
+}
+
+/*
+ * Compress or expand the event data of m_in_data directly into the
+ * OutPort buffer and stamp header and footer.
+ */
+int CompressFilter::set_data_OutPort(unsigned int data_byte_size)
+{
+    const unsigned char* in = &(m_in_data.data[HEADER_BYTE_SIZE]);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    unsigned char codec = get_frame_codec(m_in_data);
+    bool compressed = (codec == DAQMW::COMPRESS_CODEC_DEFLATE);
+    if (codec != FRAME_CODEC_RAW && !compressed) {
+        fatal_error_report(USER_DEFINED_ERROR1, "unknown codec in frame header");
+    }
+
+    int out_byte_size;
+    unsigned char out_codec;
+    if (!m_decompress && !compressed) {
+        unsigned int max = m_compressor.bound(data_byte_size);
+        unsigned char* out = reserve_frame(m_out_data, max);
+        out_byte_size = m_compressor.compress(in, data_byte_size, out, max);
+        out_codec = DAQMW::COMPRESS_CODEC_DEFLATE;
+    }
+    else if (m_decompress && compressed) {
+        if (!DAQMW::is_compressed_block(in, data_byte_size)) {
+            fatal_error_report(USER_DEFINED_ERROR1, "compressed block invalid");
+        }
+        unsigned int max = DAQMW::compressed_raw_size(in);
+        if (max > m_max_raw_byte_size) {
+            std::cerr << "### ERROR: raw size " << max << " exceeds maxRawByteSize "
+                      << m_max_raw_byte_size << std::endl;
+            fatal_error_report(USER_DEFINED_ERROR1, "raw size too large");
+        }
+        unsigned char* out = reserve_frame(m_out_data, max);
+        out_byte_size = m_decompressor.decompress(in, data_byte_size, out, max);
+        out_codec = FRAME_CODEC_RAW;
+    }
+    else { // already in the wanted form, pass through
+        unsigned char* out = reserve_frame(m_out_data, data_byte_size);
+        memcpy(out, in, data_byte_size);
+        commit_frame(m_out_data, data_byte_size, codec);
+        return 0;
+    }
+    if (out_byte_size < 0) {
+        fatal_error_report(USER_DEFINED_ERROR1,
+                           m_decompress ? "decompress error" : "compress error");
+    }
+    commit_frame(m_out_data, out_byte_size, out_codec);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long long usec = (end.tv_sec - start.tv_sec) * 1000000LL
+                     + (end.tv_nsec - start.tv_nsec) / 1000;
+    add_codec_bytes(data_byte_size, out_byte_size, usec);
+    if (m_debug) {
+        std::cerr << "event data " << data_byte_size << " -> "
+                  << out_byte_size << " bytes" << std::endl;
+    }
+
+    return 0;
+}
+
+unsigned int CompressFilter::read_InPort()
+{
+    /////////////// read data from InPort Buffer ///////////////
+    unsigned int recv_byte_size = 0;
+    bool ret = m_InPort.read();
+
+    //////////////////// check read status /////////////////////
+    if (ret == false) { // false: TIMEOUT or FATAL
+        BufferStatus in_status = check_inPort_status(m_InPort);
+        if (in_status == BUF_TIMEOUT) { // Buffer empty.
+            if (check_trans_lock()) {   // Check if stop command has come.
+                set_trans_unlock();     // Transit to CONFIGURE state.
+            }
+        }
+        else if (in_status == BUF_FATAL) { // Fatal error
+            fatal_error_report(INPORT_ERROR);
+        }
+    }
+    else {
+        recv_byte_size = m_in_data.data.length();
+    }
+    if (m_debug) {
+        std::cerr << "m_in_data.data.length():" << recv_byte_size
+                  << std::endl;
+    }
+
+    return recv_byte_size;
+}
+
+int CompressFilter::daq_run()
+{
+    if (m_debug) {
+        std::cerr << "*** CompressFilter::run" << std::endl;
+    }
+
+    if (!m_out_pending) {
+        m_inport_recv_data_size = read_InPort();
+        if (m_inport_recv_data_size == 0) { // TIMEOUT
+            return 0;
+        }
+        check_header_footer(m_in_data, m_inport_recv_data_size);
+        set_data_OutPort(get_event_size(m_inport_recv_data_size));
+        m_out_pending = true;
+    }
+
+    // waits for a free slot in the receiver (backpressure parameter)
+    if (write_OutPort_flow(m_OutPort) < 0) { // no free slot yet
+        return 0;
+    }
+    m_out_pending = false;
+
+    inc_sequence_num();                    // increase sequence num.
+    unsigned int event_data_size = get_event_size(m_inport_recv_data_size);
+    inc_total_data_size(event_data_size);  // increase total data byte size
+
+    return 0;
+}
+
+extern "C"
+{
+    void CompressFilterInit(RTC::Manager* manager)
+    {
+        RTC::Properties profile(compressfilter_spec);
+        manager->registerFactory(profile,
+                    RTC::Create<CompressFilter>,
+                    RTC::Delete<CompressFilter>);
+    }
+};
@@ -0,0 +1,91 @@
+// -*- C++ -*-
+/*!
+ * @file CompressFilter.h
+ * @brief Filter compressing (or expanding) the event data of each frame
+ * @date
+ * @author
+ *
+ */
+
+#ifndef COMPRESSFILTER_H
+#define COMPRESSFILTER_H
+
+#include "DaqComponentBase.h"
+#include "Compression.h"
+
+using namespace RTC;
+
+/*!
+ * @class CompressFilter
+ * @brief replaces the event data of each frame by a compressed block
+ *
+ *   <param pid="mode">compress</param>         (default) or decompress
+ *   <param pid="compressLevel">1</param>       1 (fastest) to 9
+ *   <param pid="maxRawByteSize">67108864</param> decompress: largest frame
+ *
+ * Put it in front of a logger on another host to trade CPU for network
+ * bandwidth: the logger expands the blocks before saving (its
+ * decompress parameter, yes by default).  With mode decompress the filter restores the original
+ * frames, e.g. in front of a monitor reading compressed frames.
+ * Compressed frames are marked by the codec in the frame header; frames
+ * already in the wanted form pass unchanged.  A compressed block whose
+ * raw size exceeds maxRawByteSize is a fatal error.
+ *
+ * Header and footer are rebuilt by commit_frame(), so the output frames
+ * pass check_header_footer() (with the CRC in integrity mode).  The
+ * compression ratio and codec MB/s are in the metrics (compressRatio,
+ * codecMBps in the status log).
+ */
+class CompressFilter
+    : public DAQMW::DaqComponentBase
+{
+public:
+    CompressFilter(RTC::Manager* manager);
+    ~CompressFilter();
+
+    // The initialize action (on CREATED->ALIVE transition)
+    // former rtc_init_entry()
+    virtual RTC::ReturnCode_t onInitialize();
+
+    // The execution action that is invoked periodically
+    // former rtc_active_do()
+    virtual RTC::ReturnCode_t onExecute(RTC::UniqueId ec_id);
+
+private:
+    TimedOctetSeq          m_in_data;
+    InPort<TimedOctetSeq>  m_InPort;
+
+    TimedOctetSeq          m_out_data;
+    OutPort<TimedOctetSeq> m_OutPort;
+
+private:
+    int daq_dummy();
+    int daq_configure();
+    int daq_unconfigure();
+    int daq_start();
+    int daq_run();
+    int daq_stop();
+    int daq_pause();
+    int daq_resume();
+
+    int parse_params(::NVList* list);
+    unsigned int read_InPort();
+    int set_data_OutPort(unsigned int data_byte_size);
+
+    DAQMW::BlockCompressor   m_compressor;
+    DAQMW::BlockDecompressor m_decompressor;
+    bool m_decompress;
+    unsigned int m_max_raw_byte_size;
+
+    unsigned int m_inport_recv_data_size;
+    bool m_out_pending;
+    bool m_debug;
+};
+
+
+extern "C"
+{
+    void CompressFilterInit(RTC::Manager* manager);
+};
+
+#endif // COMPRESSFILTER_H
@@ -0,0 +1,410 @@
+// -*- C++ -*-
+/*!
+ * @file EventBuilder.cpp
+ * @brief Event builder merging the fragments of N readers
+ * @date
+ * @author
+ *
+ */
+
+#include <cstdio>
+#include "EventBuilder.h"
+
+using DAQMW::FatalType::DATAPATH_DISCONNECTED;
+using DAQMW::FatalType::HEADER_DATA_MISMATCH;
+using DAQMW::FatalType::FOOTER_DATA_MISMATCH;
+
+// Module specification
+// Change following items to suit your component's spec.
+static const char* eventbuilder_spec[] =
+{
+    "implementation_id", "EventBuilder",
+    "type_name",         "EventBuilder",
+    "description",       "Event builder component with N inputs",
+    "version",           "1.0",
+    "vendor",            "Kazuo Nakayoshi, KEK",
+    "category",          "example",
+    "activity_type",     "DataFlowComponent",
+    "max_instance",      "1",
+    "language",          "C++",
+    "lang_type",         "compile",
+    ""
+};
+
+EventBuilder::EventBuilder(RTC::Manager* manager)
+    : DAQMW::DaqComponentBase(manager),
+      m_input_num(1),
+      m_OutPort("eventbuilder_out", m_out_data),
+      m_merge_key(MERGE_BY_SEQUENCE),
+      m_trigger_offset(0),
+      m_trigger_byte_size(4),
+      m_event_timeout_usec(100000),
+      m_max_pending(DAQMW::EventMerger::DEFAULT_MAX_PENDING),
+      m_out_pending(false),
+      m_out_byte_size(0),
+      m_debug(false)
+{
+    // Registration: InPort/OutPort/Service
+
+    // Set InPort buffers
+    for (unsigned int i = 0; i < MAX_INPUTS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "eventbuilder_in%u", i);
+        m_in[i].port.reset(new InPort<TimedOctetSeq>(name, m_in[i].data));
+        m_in[i].drain_func = [this, i](RTC::TimedOctetSeq&, unsigned int size) {
+            return add_fragment(i, size);
+        };
+        registerInPort(name, *m_in[i].port);
+    }
+    // Set OutPort buffers
+    registerOutPort("eventbuilder_out", m_OutPort);
+    register_event_merger(&m_merger);
+
+    init_command_port();
+    init_state_table();
+    set_comp_name("EVENTBUILDER");
+}
+
+EventBuilder::~EventBuilder()
+{
+}
+
+RTC::ReturnCode_t EventBuilder::onInitialize()
+{
+    if (m_debug) {
+        std::cerr << "EventBuilder::onInitialize()" << std::endl;
+    }
+
+    return RTC::RTC_OK;
+}
+
+RTC::ReturnCode_t EventBuilder::onExecute(RTC::UniqueId ec_id)
+{
+    daq_do();
+
+    return RTC::RTC_OK;
+}
+
+int EventBuilder::daq_dummy()
+{
+    return 0;
+}
+
+int EventBuilder::daq_configure()
+{
+    std::cerr << "*** EventBuilder::configure" << std::endl;
+
+    ::NVList* paramList;
+    paramList = m_daq_service0.getCompParams();
+    parse_params(paramList);
+
+    return 0;
+}
+
+int EventBuilder::parse_params(::NVList* list)
+{
+    std::cerr << "param list length:" << (*list).length() << std::endl;
+
+    m_input_num = 1;
+    m_merge_key = MERGE_BY_SEQUENCE;
+    m_trigger_offset = 0;
+    m_trigger_byte_size = 4;
+    m_event_timeout_usec = 100000;
+    m_max_pending = DAQMW::EventMerger::DEFAULT_MAX_PENDING;
+
+    int len = (*list).length();
+    for (int i = 0; i < len; i+=2) {
+        std::string sname  = (std::string)(*list)[i].value;
+        std::string svalue = (std::string)(*list)[i+1].value;
+
+        std::cerr << "sname: " << sname << "  ";
+        std::cerr << "value: " << svalue << std::endl;
+
+        int num = atoi(svalue.c_str());
+        if (sname == "inputs") {
+            if (num < 1 || num > (int)MAX_INPUTS) {
+                std::cerr << "### ERROR: inputs must be 1 to " << MAX_INPUTS
+                          << ": " << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+            m_input_num = num;
+        }
+        else if (sname == "mergeKey") {
+            if (svalue == "sequence") {
+                m_merge_key = MERGE_BY_SEQUENCE;
+            }
+            else if (svalue == "trigger") {
+                m_merge_key = MERGE_BY_TRIGGER;
+            }
+            else {
+                std::cerr << "### ERROR: mergeKey must be sequence or trigger: "
+                          << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+        }
+        else if (sname == "triggerOffset") {
+            if (num < 0) {
+                std::cerr << "### ERROR: bad triggerOffset: " << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+            m_trigger_offset = num;
+        }
+        else if (sname == "triggerBytes") {
+            if (num < 1 || num > 8) {
+                std::cerr << "### ERROR: triggerBytes must be 1 to 8: " << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+            m_trigger_byte_size = num;
+        }
+        else if (sname == "eventTimeoutUsec") {
+            if (num < 0) {
+                std::cerr << "### ERROR: bad eventTimeoutUsec: " << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+            m_event_timeout_usec = num;
+        }
+        else if (sname == "maxPendingEvents") {
+            if (num < 1) {
+                std::cerr << "### ERROR: bad maxPendingEvents: " << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+            m_max_pending = num;
+        }
+    }
+
+    return 0;
+}
+
+int EventBuilder::daq_unconfigure()
+{
+    std::cerr << "*** EventBuilder::unconfigure" << std::endl;
+
+    return 0;
+}
+
+int EventBuilder::daq_start()
+{
+    std::cerr << "*** EventBuilder::start" << std::endl;
+
+    m_merger.init(m_input_num, m_event_timeout_usec, m_max_pending);
+    m_block.reset();
+    m_out_pending = false;
+
+    // Check data port connections
+    for (unsigned int i = 0; i < m_input_num; i++) {
+        if (!check_dataPort_connections(*m_in[i].port)) {
+            std::cerr << "### NO Connection: eventbuilder_in" << i << std::endl;
+            fatal_error_report(DATAPATH_DISCONNECTED);
+        }
+    }
+    if (!check_dataPort_connections(m_OutPort)) {
+        std::cerr << "### NO Connection: eventbuilder_out" << std::endl;
+        fatal_error_report(DATAPATH_DISCONNECTED);
+    }
+
+    return 0;
+}
+
+int EventBuilder::daq_stop()
+{
+    std::cerr << "*** EventBuilder::stop" << std::endl;
+    std::cerr << "complete events:   " << m_merger.get_complete() << std::endl;
+    std::cerr << "incomplete events: " << m_merger.get_incomplete() << std::endl;
+    std::cerr << "late fragments:    " << m_merger.get_late() << std::endl;
+    std::cerr << "dup. fragments:    " << m_merger.get_duplicate() << std::endl;
+
+    return 0;
+}
+
+int EventBuilder::daq_pause()
+{
+    std::cerr << "*** EventBuilder::pause" << std::endl;
+
+    return 0;
+}
+
+int EventBuilder::daq_resume()
+{
+    std::cerr << "*** EventBuilder::resume" << std::endl;
+
+    return 0;
+}
+
+/*
+ * Check one input frame and give its event data to the merger.
+ */
+int EventBuilder::add_fragment(unsigned int input, unsigned int frame_byte_size)
+{
+    TimedOctetSeq& in_data = m_in[input].data;
+    if (frame_byte_size < HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE) {
+        std::cerr << "### ERROR: eventbuilder_in" << input
+                  << ": frame too short: " << frame_byte_size << std::endl;
+        fatal_error_report(HEADER_DATA_MISMATCH);
+    }
+    unsigned int event_byte_size = get_event_size(frame_byte_size);
+    const unsigned char* frame = &(in_data.data[0]);
+    const unsigned char* footer = &frame[HEADER_BYTE_SIZE + event_byte_size];
+
+    if (!check_header(&(in_data.data[0]), event_byte_size)) {
+        std::cerr << "### ERROR: eventbuilder_in" << input
+                  << ": header invalid" << std::endl;
+        fatal_error_report(HEADER_DATA_MISMATCH);
+    }
+    if (footer[0] != FOOTER_MAGIC || footer[1] != FOOTER_MAGIC) {
+        std::cerr << "### ERROR: eventbuilder_in" << input
+                  << ": footer invalid" << std::endl;
+        fatal_error_report(FOOTER_DATA_MISMATCH);
+    }
+    if (is_integrity_on() && !check_frame_crc(frame, event_byte_size)) {
+        std::cerr << "### ERROR: eventbuilder_in" << input
+                  << ": event data corrupted" << std::endl;
+        fatal_error_report(FOOTER_DATA_MISMATCH);
+    }
+
+    uint64_t number = 0;
+    unsigned int number_bits;
+    if (m_merge_key == MERGE_BY_SEQUENCE) {
+        number = ((uint32_t)footer[4] << 24) + ((uint32_t)footer[5] << 16)
+                 + ((uint32_t)footer[6] << 8) + (uint32_t)footer[7];
+        number_bits = 32;
+    }
+    else {
+        if (m_trigger_offset + m_trigger_byte_size > event_byte_size) {
+            std::cerr << "### ERROR: eventbuilder_in" << input
+                      << ": no trigger number in " << event_byte_size
+                      << " bytes event data" << std::endl;
+            fatal_error_report(HEADER_DATA_MISMATCH);
+        }
+        const unsigned char* p = &frame[HEADER_BYTE_SIZE + m_trigger_offset];
+        for (unsigned int i = 0; i < m_trigger_byte_size; i++) {
+            number = (number << 8) | p[i];
+        }
+        number_bits = 8 * m_trigger_byte_size;
+    }
+    // the counters wrap around, keep the event numbers growing
+    number = m_merger.extend_number(number, number_bits);
+
+    int ret = m_merger.add(input, number, &frame[HEADER_BYTE_SIZE], event_byte_size);
+    if (ret != DAQMW::EventMerger::ADD_OK && m_debug) {
+        std::cerr << "eventbuilder_in" << input << ": event " << number
+                  << (ret == DAQMW::EventMerger::ADD_LATE ? " late" : " duplicate")
+                  << std::endl;
+    }
+
+    return 0;
+}
+
+/*
+ * Build the output frame of one event: an event block with the event
+ * data of input i as entry i.
+ */
+int EventBuilder::send_event(const DAQMW::EventMerger::Event* event)
+{
+    for (unsigned int i = 0; i < m_input_num; i++) {
+        unsigned int size = event->fragment_byte_size(i);
+        if (size > 0) {
+            add_block_event(m_out_data, m_block, event->fragment(i), size);
+        }
+        else {
+            reserve_block_event(m_out_data, m_block, 0);
+            commit_block_event(m_out_data, m_block, 0);
+        }
+    }
+    commit_block(m_out_data, m_block);
+    m_out_byte_size = get_event_size(m_out_data.data.length());
+    m_out_pending = true;
+
+    return write_pending();
+}
+
+/*
+ * Returns 0 if the built event was written (or dropped by
+ * backpressure=drop), -1 if it is still pending.
+ */
+int EventBuilder::write_pending()
+{
+    int ret = write_OutPort_flow(m_OutPort);
+    if (ret < 0) {
+        return -1;
+    }
+    m_out_pending = false;
+    inc_sequence_num();                       // dropped too, see write_OutPort_flow()
+    if (ret > 0) {
+        inc_total_data_size(m_out_byte_size); // increase total data byte size
+    }
+
+    return 0;
+}
+
+unsigned int EventBuilder::read_inputs()
+{
+    unsigned int frames = 0;
+    for (unsigned int i = 0; i < m_input_num; i++) {
+        // only non-empty inputs, so that no read waits
+        if (m_in[i].port->isEmpty()) {
+            continue;
+        }
+        int ret = drain_InPort(*m_in[i].port, m_in[i].data, m_in[i].drain_func);
+        if (ret > 0) {
+            frames += ret;
+        }
+    }
+    if (m_debug) {
+        std::cerr << "frames read: " << frames
+                  << " events pending: " << m_merger.pending() << std::endl;
+    }
+
+    return frames;
+}
+
+int EventBuilder::daq_run()
+{
+    if (m_debug) {
+        std::cerr << "*** EventBuilder::run" << std::endl;
+    }
+
+    if (m_out_pending && write_pending() < 0) {
+        return 0;
+    }
+
+    unsigned int frames = read_inputs();
+
+    // send the events ready in order
+    while (const DAQMW::EventMerger::Event* event = m_merger.ready()) {
+        int ret = send_event(event);
+        m_merger.pop();
+        if (ret < 0) { // the receiver is full, retry in the next daq_run()
+            return 0;
+        }
+    }
+
+    if (frames == 0) {
+        if (check_trans_lock()) {
+            // stop: the inputs are empty, send the events left incomplete
+            while (const DAQMW::EventMerger::Event* event = m_merger.front()) {
+                int ret = send_event(event);
+                m_merger.pop();
+                if (ret < 0) {
+                    return 0;
+                }
+            }
+            set_trans_unlock();
+        }
+        else {
+            m_daq_service0.waitCommand(INPUT_POLL_USEC);
+        }
+    }
+
+    return 0;
+}
+
+extern "C"
+{
+    void EventBuilderInit(RTC::Manager* manager)
+    {
+        RTC::Properties profile(eventbuilder_spec);
+        manager->registerFactory(profile,
+                    RTC::Create<EventBuilder>,
+                    RTC::Delete<EventBuilder>);
+    }
+};
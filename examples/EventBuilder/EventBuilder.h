@@ -0,0 +1,118 @@
+// -*- C++ -*-
+/*!
+ * @file EventBuilder.h
+ * @brief Event builder merging the fragments of N readers
+ * @date
+ * @author
+ *
+ */
+
+#ifndef EVENTBUILDER_H
+#define EVENTBUILDER_H
+
+#include <memory>
+
+#include "DaqComponentBase.h"
+
+using namespace RTC;
+
+/*!
+ * @class EventBuilder
+ * @brief builds events from one fragment per InPort, sent in event order
+ *
+ * Each reader (e.g. one per SiTCP board) sends one fragment per event
+ * to its own InPort.  Fragments are merged by the sequence number in the
+ * footer or by a trigger number field in the fragment data:
+ *
+ *   <param pid="inputs">8</param>
+ *   <param pid="mergeKey">trigger</param>        (default: sequence)
+ *   <param pid="triggerOffset">4</param>         byte offset in the event data
+ *   <param pid="triggerBytes">4</param>          1 to 8, big endian
+ *   <param pid="eventTimeoutUsec">100000</param> 0: wait for all fragments
+ *   <param pid="maxPendingEvents">4096</param>
+ *
+ * InPorts eventbuilder_in0 ... eventbuilder_in31 are always registered,
+ * the first "inputs" of them must be connected.  An event is sent when
+ * all inputs delivered their fragment, or incomplete when the timeout
+ * passed since its first fragment or maxPendingEvents events are being
+ * built.  Events go out in event number order.  Incomplete events and
+ * late fragments (of events already sent) are counted in the metrics
+ * (incompleteEvents, lateFragments in the status log).
+ *
+ * The output frame is an event block (EventBlock.h) with one entry per
+ * input, entry i is the event data of input i, 0 bytes if it is missing.
+ * The footer sequence number counts built events.
+ */
+class EventBuilder
+    : public DAQMW::DaqComponentBase
+{
+public:
+    EventBuilder(RTC::Manager* manager);
+    ~EventBuilder();
+
+    // The initialize action (on CREATED->ALIVE transition)
+    // former rtc_init_entry()
+    virtual RTC::ReturnCode_t onInitialize();
+
+    // The execution action that is invoked periodically
+    // former rtc_active_do()
+    virtual RTC::ReturnCode_t onExecute(RTC::UniqueId ec_id);
+
+    static const unsigned int MAX_INPUTS = 32;
+
+private:
+    enum MergeKey {
+        MERGE_BY_SEQUENCE,
+        MERGE_BY_TRIGGER
+    };
+
+    struct Input {
+        TimedOctetSeq data;
+        std::unique_ptr< InPort<TimedOctetSeq> > port;
+        DrainFunc drain_func; // add_fragment() of this input
+    };
+
+    Input m_in[MAX_INPUTS];
+    unsigned int m_input_num;
+
+    TimedOctetSeq          m_out_data;
+    OutPort<TimedOctetSeq> m_OutPort;
+
+    DAQMW::EventMerger     m_merger;
+    DAQMW::EventBlockWriter m_block;
+
+private:
+    int daq_dummy();
+    int daq_configure();
+    int daq_unconfigure();
+    int daq_start();
+    int daq_run();
+    int daq_stop();
+    int daq_pause();
+    int daq_resume();
+
+    int parse_params(::NVList* list);
+    unsigned int read_inputs();
+    int add_fragment(unsigned int input, unsigned int frame_byte_size);
+    int send_event(const DAQMW::EventMerger::Event* event);
+    int write_pending();
+
+    static const unsigned int INPUT_POLL_USEC = 1000; // all inputs empty
+
+    MergeKey m_merge_key;
+    unsigned int m_trigger_offset;
+    unsigned int m_trigger_byte_size;
+    unsigned int m_event_timeout_usec;
+    unsigned int m_max_pending;
+    bool m_out_pending;          // built event not yet written
+    unsigned int m_out_byte_size;
+    bool m_debug;
+};
+
+
+extern "C"
+{
+    void EventBuilderInit(RTC::Manager* manager);
+};
+
+#endif // EVENTBUILDER_H
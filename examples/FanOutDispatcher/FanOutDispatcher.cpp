@@ -0,0 +1,393 @@
+// -*- C++ -*-
+/*!
+ * @file FanOutDispatcher.cpp
+ * @brief Dispatcher with N outputs sharing one reference-counted frame
+ * @date
+ * @author
+ *
+ */
+
+#include <cstdio>
+#include "FanOutDispatcher.h"
+
+using DAQMW::FatalType::DATAPATH_DISCONNECTED;
+using DAQMW::FatalType::INPORT_ERROR;
+using DAQMW::FatalType::OUTPORT_ERROR;
+
+// octet sequence of TimedOctetSeq (allocbuf/freebuf)
+typedef decltype(TimedOctetSeq::data) OctetData;
+
+// Module specification
+// Change following items to suit your component's spec.
+static const char* fanoutdispatcher_spec[] =
+{
+    "implementation_id", "FanOutDispatcher",
+    "type_name",         "FanOutDispatcher",
+    "description",       "Dispatcher component with N outputs",
+    "version",           "1.0",
+    "vendor",            "Kazuo Nakayoshi, KEK",
+    "category",          "example",
+    "activity_type",     "DataFlowComponent",
+    "max_instance",      "1",
+    "language",          "C++",
+    "lang_type",         "compile",
+    ""
+};
+
+FanOutDispatcher::FanOutDispatcher(RTC::Manager* manager)
+    : DAQMW::DaqComponentBase(manager),
+      m_InPort("fanout_in", m_in_data),
+      m_output_num(1),
+      m_in_status(BUF_SUCCESS),
+      m_inport_recv_data_size(0),
+      m_debug(false)
+{
+    // Registration: InPort/OutPort/Service
+
+    // Set OutPort buffers
+    registerInPort("fanout_in", m_InPort);
+    for (unsigned int i = 0; i < MAX_OUTPUTS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "fanout_out%u", i);
+        m_out[i].port.reset(new OutPort<TimedOctetSeq>(name, m_out[i].data));
+        m_out[i].must_deliver = true;
+        registerOutPort(name, *m_out[i].port);
+    }
+
+    init_command_port();
+    init_state_table();
+    set_comp_name("FANOUT_DISPATCHER");
+}
+
+FanOutDispatcher::~FanOutDispatcher()
+{
+    // frames go back to m_free_frames, free them all
+    for (unsigned int i = 0; i < MAX_OUTPUTS; i++) {
+        clear_output_frame(m_out[i]);
+    }
+    for (unsigned int i = 0; i < m_free_frames.size(); i++) {
+        OctetData::freebuf(m_free_frames[i]->buf);
+        delete m_free_frames[i];
+    }
+}
+
+RTC::ReturnCode_t FanOutDispatcher::onInitialize()
+{
+    if (m_debug) {
+        std::cerr << "FanOutDispatcher::onInitialize()" << std::endl;
+    }
+
+    return RTC::RTC_OK;
+}
+
+RTC::ReturnCode_t FanOutDispatcher::onExecute(RTC::UniqueId ec_id)
+{
+    daq_do();
+
+    return RTC::RTC_OK;
+}
+
+int FanOutDispatcher::daq_dummy()
+{
+    return 0;
+}
+
+int FanOutDispatcher::daq_configure()
+{
+    std::cerr << "*** FanOutDispatcher::configure" << std::endl;
+
+    ::NVList* paramList;
+    paramList = m_daq_service0.getCompParams();
+    parse_params(paramList);
+
+    return 0;
+}
+
+int FanOutDispatcher::parse_params(::NVList* list)
+{
+    std::cerr << "param list length:" << (*list).length() << std::endl;
+
+    m_output_num = 1;
+    for (unsigned int i = 0; i < MAX_OUTPUTS; i++) {
+        m_out[i].must_deliver = true;
+        m_out[i].throttle = DAQMW::OutputThrottle();
+        m_out[i].throttle.set_latest_only(true);
+    }
+
+    int len = (*list).length();
+    for (int i = 0; i < len; i+=2) {
+        std::string sname  = (std::string)(*list)[i].value;
+        std::string svalue = (std::string)(*list)[i+1].value;
+
+        std::cerr << "sname: " << sname << "  ";
+        std::cerr << "value: " << svalue << std::endl;
+
+        if (sname == "outputs") {
+            int num = atoi(svalue.c_str());
+            if (num < 1 || num > (int)MAX_OUTPUTS) {
+                std::cerr << "### ERROR: outputs must be 1 to " << MAX_OUTPUTS
+                          << ": " << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+            m_output_num = num;
+        }
+        else if (sname.compare(0, 6, "output") == 0 && sname.size() > 7
+                 && sname[6] >= '0' && sname[6] < (char)('0' + MAX_OUTPUTS)) {
+            // outputNPrescale, outputNRate, outputNBurst, outputNMode
+            unsigned int index = sname[6] - '0';
+            if (m_out[index].throttle.set_param(sname.substr(7), svalue) <= 0) {
+                std::cerr << "### ERROR: bad parameter " << sname << ": "
+                          << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+        }
+        else if (sname.compare(0, 6, "output") == 0 && sname.size() == 7
+                 && sname[6] >= '0' && sname[6] < (char)('0' + MAX_OUTPUTS)) {
+            unsigned int index = sname[6] - '0';
+            if (svalue == "must") {
+                m_out[index].must_deliver = true;
+            }
+            else if (svalue == "best_effort") {
+                m_out[index].must_deliver = false;
+            }
+            else {
+                std::cerr << "### ERROR: " << sname
+                          << " must be must or best_effort: " << svalue << std::endl;
+                fatal_error_report(DAQMW::FatalType::BAD_PARAMETER);
+            }
+        }
+    }
+
+    // only the best effort outputs in use drop frames
+    clear_output_throttles();
+    for (unsigned int i = 0; i < m_output_num; i++) {
+        if (!m_out[i].must_deliver) {
+            char name[32];
+            snprintf(name, sizeof(name), "fanout_out%u", i);
+            register_output_throttle(name, &m_out[i].throttle);
+        }
+    }
+
+    return 0;
+}
+
+int FanOutDispatcher::daq_unconfigure()
+{
+    std::cerr << "*** FanOutDispatcher::unconfigure" << std::endl;
+
+    return 0;
+}
+
+int FanOutDispatcher::daq_start()
+{
+    std::cerr << "*** FanOutDispatcher::start" << std::endl;
+    m_in_status = BUF_SUCCESS;
+
+    // Check data port connections
+    for (unsigned int i = 0; i < m_output_num; i++) {
+        if (!check_dataPort_connections(*m_out[i].port)) {
+            std::cerr << "### NO Connection: fanout_out" << i << std::endl;
+            fatal_error_report(DATAPATH_DISCONNECTED);
+        }
+    }
+
+    return 0;
+}
+
+int FanOutDispatcher::daq_stop()
+{
+    std::cerr << "*** FanOutDispatcher::stop" << std::endl;
+
+    // frames not yet taken by best effort outputs
+    for (unsigned int i = 0; i < MAX_OUTPUTS; i++) {
+        clear_output_frame(m_out[i]);
+    }
+
+    return 0;
+}
+
+int FanOutDispatcher::daq_pause()
+{
+    std::cerr << "*** FanOutDispatcher::pause" << std::endl;
+
+    return 0;
+}
+
+int FanOutDispatcher::daq_resume()
+{
+    std::cerr << "*** FanOutDispatcher::resume" << std::endl;
+
+    return 0;
+}
+
+unsigned int FanOutDispatcher::read_InPort()
+{
+    /////////////// read data from InPort Buffer ///////////////
+    unsigned int recv_byte_size = 0;
+    bool ret = m_InPort.read();
+
+    //////////////////// check read status /////////////////////
+    if (ret == false) { // false: TIMEOUT or FATAL
+        m_in_status = check_inPort_status(m_InPort);
+        if (m_in_status == BUF_TIMEOUT) { // Buffer empty.
+            if (check_trans_lock()) {     // Check if stop command has come.
+                set_trans_unlock();       // Transit to CONFIGURE state.
+            }
+        }
+        else if (m_in_status == BUF_FATAL) { // Fatal error
+            fatal_error_report(INPORT_ERROR);
+        }
+    }
+    else {
+        recv_byte_size = m_in_data.data.length();
+        m_in_status = BUF_SUCCESS;
+    }
+    if (m_debug) {
+        std::cerr << "m_in_data.data.length():" << recv_byte_size
+                  << std::endl;
+    }
+
+    return recv_byte_size;
+}
+
+/*
+ * Take the received buffer out of m_in_data without copying it and
+ * give the InPort a released buffer for the next read.  The connectors
+ * still copy it when they marshal it in OutPort::write().
+ */
+FanOutDispatcher::FramePtr FanOutDispatcher::take_input_frame(unsigned int data_byte_size)
+{
+    Frame* frame;
+    CORBA::Octet* free_buf = 0;
+    CORBA::ULong  free_max = 0;
+    if (m_free_frames.empty()) {
+        frame = new Frame;
+    }
+    else {
+        frame = m_free_frames.back();
+        m_free_frames.pop_back();
+        free_buf = frame->buf;
+        free_max = frame->max;
+    }
+
+    frame->max = m_in_data.data.maximum();
+    frame->len = data_byte_size;
+    frame->buf = m_in_data.data.get_buffer(true); // orphan, m_in_data is empty
+    if (free_buf) {
+        m_in_data.data.replace(free_max, 0, free_buf, true);
+    }
+
+    return FramePtr(frame, [this](Frame* f) { release_frame(f); });
+}
+
+// called when the last output released the frame
+void FanOutDispatcher::release_frame(Frame* frame)
+{
+    m_free_frames.push_back(frame);
+}
+
+void FanOutDispatcher::set_output_frame(Output& out, const FramePtr& frame)
+{
+    out.frame = frame;
+    // OutPort data refers to the shared buffer, release = false
+    out.data.data.replace(frame->max, frame->len, frame->buf, false);
+}
+
+void FanOutDispatcher::clear_output_frame(Output& out)
+{
+    out.data.data.length(0);
+    out.frame.reset();
+}
+
+/*
+ * Returns 0 if the frame was sent (or dropped by backpressure=drop),
+ * -1 if the output still holds it.
+ */
+int FanOutDispatcher::write_output(Output& out)
+{
+    if (out.must_deliver) {
+        // waits for a free slot (backpressure parameter)
+        if (write_OutPort_flow(*out.port) < 0) {
+            return -1;
+        }
+    }
+    else {
+        // one try; latest only: retried in the next daq_run() until a
+        // new frame comes
+        if (!out.port->write()) {
+            if (check_outPort_status(*out.port) == BUF_FATAL) {
+                fatal_error_report(OUTPORT_ERROR);
+            }
+            if (!out.throttle.latest_only()) {
+                out.throttle.write_failed();
+                clear_output_frame(out);
+            }
+            return -1;
+        }
+        out.throttle.sent();
+    }
+    clear_output_frame(out);
+
+    return 0;
+}
+
+int FanOutDispatcher::daq_run()
+{
+    if (m_debug) {
+        std::cerr << "*** FanOutDispatcher::run" << std::endl;
+    }
+
+    // frames not yet sent; the next input waits for the must outputs
+    bool must_pending = false;
+    for (unsigned int i = 0; i < m_output_num; i++) {
+        if (m_out[i].frame && write_output(m_out[i]) < 0 && m_out[i].must_deliver) {
+            must_pending = true;
+        }
+    }
+    if (must_pending) {
+        return 0;
+    }
+
+    m_inport_recv_data_size = read_InPort();
+    if (m_inport_recv_data_size == 0) { // TIMEOUT
+        return 0;
+    }
+    check_header_footer(m_in_data, m_inport_recv_data_size);
+
+    FramePtr frame = take_input_frame(m_inport_recv_data_size);
+    for (unsigned int i = 0; i < m_output_num; i++) {
+        if (!m_out[i].must_deliver) {
+            if (!m_out[i].throttle.offer()) { // prescale, rate limit
+                continue;
+            }
+            if (m_out[i].frame) { // did not take the last one
+                m_out[i].throttle.superseded();
+            }
+        }
+        set_output_frame(m_out[i], frame);
+    }
+    frame.reset();
+
+    inc_sequence_num();                    // increase sequence num.
+    unsigned int event_data_size = get_event_size(m_inport_recv_data_size);
+    inc_total_data_size(event_data_size);  // increase total data byte size
+
+    for (unsigned int i = 0; i < m_output_num; i++) {
+        if (m_out[i].frame) {
+            write_output(m_out[i]);
+        }
+    }
+
+    return 0;
+}
+
+extern "C"
+{
+    void FanOutDispatcherInit(RTC::Manager* manager)
+    {
+        RTC::Properties profile(fanoutdispatcher_spec);
+        manager->registerFactory(profile,
+                    RTC::Create<FanOutDispatcher>,
+                    RTC::Delete<FanOutDispatcher>);
+    }
+};
@@ -0,0 +1,129 @@
+// -*- C++ -*-
+/*!
+ * @file FanOutDispatcher.h
+ * @brief Dispatcher with N outputs sharing one reference-counted frame
+ * @date
+ * @author
+ *
+ */
+
+#ifndef FANOUTDISPATCHER_H
+#define FANOUTDISPATCHER_H
+
+#include <memory>
+#include <vector>
+
+#include "DaqComponentBase.h"
+
+using namespace RTC;
+
+/*!
+ * @class FanOutDispatcher
+ * @brief sends every input frame to up to MAX_OUTPUTS OutPorts
+ *
+ * The number of outputs and the reliability of each output come from
+ * the component parameters:
+ *
+ *   <param pid="outputs">3</param>
+ *   <param pid="output0">must</param>          (default)
+ *   <param pid="output1">best_effort</param>
+ *   <param pid="output2">best_effort</param>
+ *
+ * OutPorts fanout_out0 ... fanout_out7 are always registered, the first
+ * "outputs" of them must be connected.
+ * A must output gets every frame; the next input frame is not read until
+ * all must outputs took the current one.  A best effort output gets the
+ * frames its OutputThrottle accepts (outputNPrescale, outputNRate,
+ * outputNBurst) and holds at most one frame: when a new frame arrives
+ * before the old one was taken, the old one is dropped (outputNMode
+ * latest, the default) or, with outputNMode drop, a frame the receiver
+ * could not take at once is dropped.  Drops are counted per best effort
+ * output (outputDrops in the status log) and the component behind it sees a
+ * sequence number gap.  Use
+ * buffer_write_full_policy="skip" on its inPort so that a full receiver
+ * does not block the dispatcher for buffer_write_timeout.
+ * With backpressure=drop a must output drops frames too, and its
+ * receiver sees a gap: the frames keep the footers of the input (see
+ * write_OutPort_flow()).
+ *
+ * The dispatcher keeps one buffer per input frame: the input buffer is
+ * taken over from the InPort data and all OutPort data point at it; the
+ * buffer goes back to a free list when the last output released its
+ * reference.  The frame is still copied once per output when
+ * OutPort::write() marshals it for the connector (the CORBA and shm
+ * transports serialize the data into their own buffer), so the copies
+ * saved are the ones the dispatcher itself would make.
+ */
+class FanOutDispatcher
+    : public DAQMW::DaqComponentBase
+{
+public:
+    FanOutDispatcher(RTC::Manager* manager);
+    ~FanOutDispatcher();
+
+    // The initialize action (on CREATED->ALIVE transition)
+    // former rtc_init_entry()
+    virtual RTC::ReturnCode_t onInitialize();
+
+    // The execution action that is invoked periodically
+    // former rtc_active_do()
+    virtual RTC::ReturnCode_t onExecute(RTC::UniqueId ec_id);
+
+    static const unsigned int MAX_OUTPUTS = 8;
+
+private:
+    /// one input frame, shared by the outputs sending it
+    struct Frame {
+        CORBA::Octet* buf;
+        CORBA::ULong  max;
+        CORBA::ULong  len;
+    };
+    typedef std::shared_ptr<Frame> FramePtr;
+
+    struct Output {
+        TimedOctetSeq data;
+        std::unique_ptr< OutPort<TimedOctetSeq> > port;
+        bool must_deliver;
+        FramePtr frame; // frame not yet sent, empty if none
+        DAQMW::OutputThrottle throttle; // best effort only
+    };
+
+    TimedOctetSeq          m_in_data;
+    InPort<TimedOctetSeq>  m_InPort;
+
+    Output m_out[MAX_OUTPUTS];
+    unsigned int m_output_num;
+
+    // buffers of released frames, reused as InPort buffer
+    std::vector<Frame*> m_free_frames;
+
+private:
+    int daq_dummy();
+    int daq_configure();
+    int daq_unconfigure();
+    int daq_start();
+    int daq_run();
+    int daq_stop();
+    int daq_pause();
+    int daq_resume();
+
+    int parse_params(::NVList* list);
+    unsigned int read_InPort();
+    FramePtr take_input_frame(unsigned int data_byte_size);
+    void release_frame(Frame* frame);
+    void set_output_frame(Output& out, const FramePtr& frame);
+    void clear_output_frame(Output& out);
+    int write_output(Output& out);
+
+    BufferStatus m_in_status;
+    unsigned int m_inport_recv_data_size;
+    bool m_debug;
+};
+
+
+extern "C"
+{
+    void FanOutDispatcherInit(RTC::Manager* manager);
+};
+
+#endif // FANOUTDISPATCHER_H
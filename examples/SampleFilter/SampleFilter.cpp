@@ -39,7 +39,9 @@ SampleFilter::SampleFilter(RTC::Manager* manager)
       m_in_status(BUF_SUCCESS),
       m_out_status(BUF_SUCCESS),
       m_inport_recv_data_size(0),
-      m_debug(false)
+      m_debug(false),
+      m_in_pending(false),
+      m_out_pending(false)
 {
     // Registration: InPort/OutPort/Service
 
@@ -90,6 +92,8 @@ int SampleFilter::daq_configure()
 
 int SampleFilter::parse_params(::NVList* list)
 {
+    unsigned int worker_num = 0;
+
     std::cerr << "param list length:" << (*list).length() << std::endl;
 
     int len = (*list).length();
@@ -99,8 +103,18 @@ int SampleFilter::parse_params(::NVList* list)
 
         std::cerr << "sname: " << sname  << "  ";
         std::cerr << "value: " << svalue << std::endl;
+
+        if ( sname == "workerNum" ) {
+            char* offset;
+            worker_num = (unsigned int)strtoul(svalue.c_str(), &offset, 10);
+        }
     }
 
+    // workerNum > 0: filter on worker threads, output stays in order
+    using namespace std::placeholders;
+    set_worker_num(worker_num,
+                   std::bind(&SampleFilter::work_filter, this, _1, _2, _3));
+
     return 0;
 }
 
@@ -117,6 +131,8 @@ int SampleFilter::daq_start()
 
     m_in_status  = BUF_SUCCESS;
     m_out_status = BUF_SUCCESS;
+    m_in_pending  = false;
+    m_out_pending = false;
 
     return 0;
 }
@@ -142,7 +158,7 @@ int SampleFilter::daq_resume()
     return 0;
 }
 
-bool SampleFilter::is_good_event(unsigned char *one_event, int size)
+bool SampleFilter::is_good_event(const unsigned char *one_event, int size)
 {
     // Sample criterion (if module number is less than 5, then ok)
     if (one_event[2] < 5) {
@@ -151,12 +167,12 @@ bool SampleFilter::is_good_event(unsigned char *one_event, int size)
     return false;
 }
 
-int SampleFilter::event_data_filter(unsigned char *event_data, int event_data_size)
+int SampleFilter::event_data_filter(unsigned char *out_event_data, const unsigned char *event_data, int event_data_size)
 {
     int good_event_byte_size = 0;
     for (int i = 0; i < event_data_size; i += ONE_EVENT_BYTE_SIZE) {
         if (is_good_event(&event_data[i], ONE_EVENT_BYTE_SIZE)) {
-            memcpy(&(m_out_event_data[good_event_byte_size]), &(event_data[i]), ONE_EVENT_BYTE_SIZE);
+            memcpy(&(out_event_data[good_event_byte_size]), &(event_data[i]), ONE_EVENT_BYTE_SIZE);
             good_event_byte_size += ONE_EVENT_BYTE_SIZE;
         }
     }
@@ -164,27 +180,34 @@ int SampleFilter::event_data_filter(unsigned char *event_data, int event_data_si
     return good_event_byte_size;
 }
 
+// called from worker threads (workerNum > 0)
+int SampleFilter::work_filter(const unsigned char *event_data, unsigned int event_data_size,
+                              std::vector<unsigned char>& out)
+{
+    out.resize(event_data_size);
+    if (event_data_size == 0) {
+        return 0;
+    }
+    return event_data_filter(&out[0], event_data, event_data_size);
+}
+
 int SampleFilter::set_data_OutPort()
 {
     // filtering.
     // event_data_filter()
     // Return value: Filtered event data size in bytes.
-    //               Good event data is stored in m_out_event_data
+    //               Good event data is written directly into the
+    //               OutPort buffer reserved by reserve_frame()
     int all_event_byte_size = get_event_size(m_inport_recv_data_size);
-    int event_data_byte_size = event_data_filter(&(m_in_data.data[HEADER_BYTE_SIZE]), all_event_byte_size);
+    unsigned char *out_event_data = reserve_frame(m_out_data, all_event_byte_size);
+    int event_data_byte_size = event_data_filter(out_event_data,
+                                                 &(m_in_data.data[HEADER_BYTE_SIZE]),
+                                                 all_event_byte_size);
     if (event_data_byte_size < 0) {
         fatal_error_report(USER_DEFINED_ERROR1, "SampleFilter error");
     }
 
-    unsigned char header[HEADER_BYTE_SIZE];
-    unsigned char footer[FOOTER_BYTE_SIZE];
-    set_header(header, event_data_byte_size);
-    set_footer(footer);
-
-    m_out_data.data.length(event_data_byte_size + HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE);
-    memcpy(&(m_out_data.data[0]), header, HEADER_BYTE_SIZE);
-    memcpy(&(m_out_data.data[HEADER_BYTE_SIZE]), m_out_event_data, event_data_byte_size);
-    memcpy(&(m_out_data.data[HEADER_BYTE_SIZE + event_data_byte_size]), footer, FOOTER_BYTE_SIZE);
+    commit_frame(m_out_data, event_data_byte_size);
 
     return 0;
 }
@@ -199,7 +222,8 @@ unsigned int SampleFilter::read_InPort()
     if (ret == false) { // false: TIMEOUT or FATAL
         m_in_status = check_inPort_status(m_InPort);
         if (m_in_status == BUF_TIMEOUT) { // Buffer empty.
-            if (check_trans_lock()) {     // Check if stop command has come.
+            // Check if stop command has come and worker results are sent.
+            if (check_trans_lock() && workers_idle() && !m_out_pending) {
                 set_trans_unlock();       // Transit to CONFIGURE state.
             }
         }
@@ -222,20 +246,17 @@ unsigned int SampleFilter::read_InPort()
 int SampleFilter::write_OutPort()
 {
     ////////////////// send data from OutPort  //////////////////
-    bool ret = m_OutPort.write();
+    // waits for a free slot in the receiver (backpressure parameter),
+    // a dropped frame takes no sequence number downstream
+    int ret = write_OutPort_flow(m_OutPort);
 
     //////////////////// check write status /////////////////////
-    if (ret == false) {  // TIMEOUT or FATAL
-        m_out_status  = check_outPort_status(m_OutPort);
-        if (m_out_status == BUF_FATAL) {   // Fatal error
-            fatal_error_report(OUTPORT_ERROR);
-        }
-        if (m_out_status == BUF_TIMEOUT) { // Timeout
-            return -1;
-        }
+    if (ret < 0) {  // no free slot yet
+        m_out_status = BUF_TIMEOUT;
+        return -1;
     }
 
-    return 0; // successfully done
+    return 0; // successfully done (or dropped)
 }
 
 int SampleFilter::daq_run()
@@ -244,6 +265,10 @@ int SampleFilter::daq_run()
         std::cerr << "*** SampleFilter::run" << std::endl;
     }
 
+    if (get_worker_num() > 0) {
+        return daq_run_workers();
+    }
+
     if (m_out_status != BUF_TIMEOUT) {
         m_inport_recv_data_size = read_InPort();
 
@@ -270,6 +295,48 @@ int SampleFilter::daq_run()
         inc_sequence_num();                    // increase sequence num.
         unsigned int event_data_size = get_event_size(m_inport_recv_data_size);
         inc_total_data_size(event_data_size);  // increase total data byte size
+        inc_total_event_num(event_data_size / ONE_EVENT_BYTE_SIZE);
+    }
+
+    return 0;
+}
+
+int SampleFilter::daq_run_workers()
+{
+    // output: results come back in the order of the input sequence numbers
+    for (;;) {
+        if (!m_out_pending) {
+            int ret = collect_worker_frame(m_out_data);
+            if (ret < 0) {
+                fatal_error_report(USER_DEFINED_ERROR1, "SampleFilter error");
+            }
+            if (ret == 0) { // next result not ready
+                break;
+            }
+            m_out_pending = true;
+        }
+        if (write_OutPort() < 0) { // TIMEOUT
+            break;
+        }
+        m_out_status  = BUF_SUCCESS;
+        m_out_pending = false;
+    }
+
+    // input: keep the frame until the reorder window has room
+    if (!m_in_pending) {
+        m_inport_recv_data_size = read_InPort();
+        if (m_inport_recv_data_size == 0) { // TIMEOUT
+            return 0;
+        }
+        check_header_footer(m_in_data, m_inport_recv_data_size);
+        m_in_pending = true;
+    }
+    if (submit_worker_frame(m_in_data, m_inport_recv_data_size)) {
+        m_in_pending = false;
+        inc_sequence_num();                    // increase sequence num.
+        unsigned int event_data_size = get_event_size(m_inport_recv_data_size);
+        inc_total_data_size(event_data_size);  // increase total data byte size
+        inc_total_event_num(event_data_size / ONE_EVENT_BYTE_SIZE);
     }
 
     return 0;
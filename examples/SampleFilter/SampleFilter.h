@@ -49,6 +49,7 @@ private:
     int daq_unconfigure();
     int daq_start();
     int daq_run();
+    int daq_run_workers();
     int daq_stop();
     int daq_pause();
     int daq_resume();
@@ -65,11 +66,12 @@ private:
 
     unsigned int m_inport_recv_data_size;
     bool m_debug;
-    const static int OUT_EVENT_BUF_SIZE = 8*1024;
-    unsigned char m_out_event_data[OUT_EVENT_BUF_SIZE];
-    int event_data_filter(unsigned char *, int);
+    int event_data_filter(unsigned char *, const unsigned char *, int);
+    int work_filter(const unsigned char *, unsigned int, std::vector<unsigned char>&);
     const static int ONE_EVENT_BYTE_SIZE = 8;
-    bool is_good_event(unsigned char *, int);
+    bool is_good_event(const unsigned char *, int);
+    bool m_in_pending;
+    bool m_out_pending;
     
     int m_n_timeout;
 };
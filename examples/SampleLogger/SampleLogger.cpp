@@ -40,6 +40,8 @@ SampleLogger::SampleLogger(RTC::Manager* manager)
       m_InPort("samplelogger_in", m_in_data),
       m_isDataLogging(false),
       m_filesOpened(false),
+      m_decompress(true),
+      m_max_raw_byte_size(DAQMW::COMPRESS_MAX_RAW_SIZE),
       m_in_status(BUF_SUCCESS),
       m_update_rate(100),
       m_debug(false)
@@ -47,6 +49,9 @@ SampleLogger::SampleLogger(RTC::Manager* manager)
     // Registration: InPort/OutPort/Service
     registerInPort("samplelogger_in", m_InPort);
 
+    using namespace std::placeholders;
+    m_drain_func = std::bind(&SampleLogger::log_frame, this, _1, _2);
+
     init_command_port();
     init_state_table();
     set_comp_name("SampleLogger");
@@ -95,6 +100,8 @@ int SampleLogger::parse_params(::NVList* list)
 
     bool isExistParamLogging = false;
     bool isExistParamDirName = false;
+    m_decompress = true;
+    m_max_raw_byte_size = DAQMW::COMPRESS_MAX_RAW_SIZE;
 
     int length = (*list).length();
     for (int i = 0; i < length; i += 2) {
@@ -126,6 +133,19 @@ int SampleLogger::parse_params(::NVList* list)
             }
         }
 
+        // decompress=yes (default): event data compressed by
+        // CompressFilter is saved expanded.  no saves the compressed
+        // blocks, nothing in DAQ-Middleware reads those files back yet
+        // (see Compression.h)
+        if (sname == "decompress") {
+            toLower(svalue);
+            m_decompress = (svalue == "yes");
+            std::cerr << "SampleLogger: decompress: " << svalue << std::endl;
+        }
+        if (sname == "maxRawByteSize") {
+            m_max_raw_byte_size = strtoul(svalue.c_str(), 0, 0);
+        }
+
         if (sname == "monRate") {
             m_update_rate = atoi(svalue.c_str());
             if (m_debug) {
@@ -273,43 +293,67 @@ void SampleLogger::toLower(std::basic_string<char>& s)
 
 int SampleLogger::daq_run()
 {
-
-    int event_byte_size = 0;
-    bool ret = m_InPort.read();
-
-    if (ret == true) {
-        int block_byte_size = m_in_data.data.length();
-
-        event_byte_size =
-            block_byte_size - HEADER_BYTE_SIZE - FOOTER_BYTE_SIZE;
-        if (m_debug) {
-            std::cerr << "m_in_data.data.length:"
-                      << m_in_data.data.length() << std::endl;
-            std::cerr << "event_byte_size w/ header, fooger = "
-                      << event_byte_size << std::endl;
-        }
-
-        if (event_byte_size == 0) {
-            return 0;
-        }
-
-        if (check_header_footer(m_in_data, block_byte_size)) {
-            //data header and footer were valid, do nothing
-        }
-    }
-    else {
+    // all the frames buffered in the InPort, up to the drain budget
+    int ret = drain_InPort(m_InPort, m_in_data, m_drain_func);
+    if (ret == 0) {
         if (check_trans_lock()) {
             if (m_debug) {
                 std::cerr << "**** trans unlock\n";
             }
             set_trans_unlock();
         }
+    }
+
+    return 0;
+}
+
+int SampleLogger::log_frame(RTC::TimedOctetSeq& in_data, unsigned int block_byte_size)
+{
+    int event_byte_size =
+        block_byte_size - HEADER_BYTE_SIZE - FOOTER_BYTE_SIZE;
+    if (m_debug) {
+        std::cerr << "m_in_data.data.length:"
+                  << in_data.data.length() << std::endl;
+        std::cerr << "event_byte_size w/ header, fooger = "
+                  << event_byte_size << std::endl;
+    }
+
+    if (event_byte_size == 0) {
         return 0;
     }
 
+    if (check_header_footer(in_data, block_byte_size)) {
+        //data header and footer were valid, do nothing
+    }
+
     if (m_isDataLogging) {
-        int ret = fileUtils->write_data((char *)&m_in_data.data[HEADER_BYTE_SIZE],
-                                        event_byte_size);
+        char *data = (char *)&in_data.data[HEADER_BYTE_SIZE];
+        unsigned long data_byte_size = event_byte_size;
+        const unsigned char *block = &in_data.data[HEADER_BYTE_SIZE];
+        if (m_decompress
+            && get_frame_codec(in_data) == DAQMW::COMPRESS_CODEC_DEFLATE) {
+            unsigned int raw_size = 0;
+            if (DAQMW::is_compressed_block(block, event_byte_size)) {
+                raw_size = DAQMW::compressed_raw_size(block);
+            }
+            if (raw_size > m_max_raw_byte_size) {
+                std::cerr << "### SampleLogger: ERROR raw size " << raw_size
+                          << " exceeds maxRawByteSize " << m_max_raw_byte_size
+                          << std::endl;
+                fatal_error_report(CANNOT_WRITE_DATA);
+            }
+            m_raw_buf.resize(raw_size);
+            int raw_byte_size = m_decompressor.decompress(block, event_byte_size,
+                                                          m_raw_buf.data(),
+                                                          m_raw_buf.size());
+            if (raw_byte_size < 0) {
+                std::cerr << "### SampleLogger: ERROR compressed block invalid\n";
+                fatal_error_report(CANNOT_WRITE_DATA);
+            }
+            data = (char *)m_raw_buf.data();
+            data_byte_size = raw_byte_size;
+        }
+        int ret = fileUtils->write_data(data, data_byte_size);
 
         if (ret < 0) {
             std::cerr << "### SampleLogger: ERROR occured at data saving\n";
@@ -16,7 +16,10 @@
 #ifndef SAMPLELOGGER_H
 #define SAMPLELOGGER_H
 
+#include <vector>
+
 #include "DaqComponentBase.h"
+#include "Compression.h"
 #include "FileUtils.h"
 
 using namespace RTC;
@@ -51,11 +54,17 @@ private:
 
     int parse_params(::NVList* list);
     int reset_InPort();
+    int log_frame(RTC::TimedOctetSeq& in_data, unsigned int block_byte_size);
     void toLower(std::basic_string<char>& s);
 
+    DrainFunc m_drain_func;
     FileUtils* fileUtils;
     bool m_isDataLogging;
     bool m_filesOpened;
+    bool m_decompress;   // expand compressed blocks (CompressFilter) before saving, default
+    unsigned int m_max_raw_byte_size; // largest expanded block (maxRawByteSize)
+    DAQMW::BlockDecompressor m_decompressor;
+    std::vector<unsigned char> m_raw_buf;
     std::string m_dirName;
     unsigned int m_maxFileSizeInMByte;
     BufferStatus m_in_status;
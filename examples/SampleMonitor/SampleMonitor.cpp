@@ -307,6 +307,7 @@ int SampleMonitor::daq_run()
     /////////////////////////////////////////////////////////////
     inc_sequence_num();                      // increase sequence num.
     inc_total_data_size(m_event_byte_size);  // increase total data byte size
+    inc_total_event_num(m_event_byte_size / ONE_EVENT_SIZE);
 
     return 0;
 }
@@ -197,8 +197,9 @@ int SampleReader::read_data_from_detectors()
     int received_data_size = 0;
 
     /// write your logic here
-    /// read 1024 byte data from data server
-    int status = m_sock->readAll(m_data, SEND_BUFFER_SIZE);
+    /// read 1024 byte data from data server directly into OutPort buffer
+    unsigned char *data = reserve_frame(m_out_data, SEND_BUFFER_SIZE);
+    int status = m_sock->readAll(data, SEND_BUFFER_SIZE);
     if (status == DAQMW::Sock::ERROR_FATAL) {
         std::cerr << "### ERROR: m_sock->readAll" << std::endl;
         fatal_error_report(USER_DEFINED_ERROR1, "SOCKET FATAL ERROR");
@@ -216,18 +217,9 @@ int SampleReader::read_data_from_detectors()
 
 int SampleReader::set_data(unsigned int data_byte_size)
 {
-    unsigned char header[8];
-    unsigned char footer[8];
-
-    set_header(&header[0], data_byte_size);
-    set_footer(&footer[0]);
-
-    ///set OutPort buffer length
-    m_out_data.data.length(data_byte_size + HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE);
-    memcpy(&(m_out_data.data[0]), &header[0], HEADER_BYTE_SIZE);
-    memcpy(&(m_out_data.data[HEADER_BYTE_SIZE]), &m_data[0], data_byte_size);
-    memcpy(&(m_out_data.data[HEADER_BYTE_SIZE + data_byte_size]), &footer[0],
-           FOOTER_BYTE_SIZE);
+    /// payload is already in the OutPort buffer (see reserve_frame()).
+    /// set OutPort buffer length and stamp header and footer in place.
+    commit_frame(m_out_data, data_byte_size);
 
     return 0;
 }
@@ -235,23 +227,17 @@ int SampleReader::set_data(unsigned int data_byte_size)
 int SampleReader::write_OutPort()
 {
     ////////////////// send data from OutPort  //////////////////
-    bool ret = m_OutPort.write();
+    // waits for a free slot in the receiver (backpressure parameter)
+    int ret = write_OutPort_flow(m_OutPort);
 
     //////////////////// check write status /////////////////////
-    if (ret == false) {  // TIMEOUT or FATAL
-        m_out_status  = check_outPort_status(m_OutPort);
-        if (m_out_status == BUF_FATAL) {   // Fatal error
-            fatal_error_report(OUTPORT_ERROR);
-        }
-        if (m_out_status == BUF_TIMEOUT) { // Timeout
-            return -1;
-        }
-    }
-    else {
-        m_out_status = BUF_SUCCESS; // successfully done
+    if (ret < 0) {  // no free slot yet
+        m_out_status = BUF_TIMEOUT;
+        return -1;
     }
+    m_out_status = BUF_SUCCESS; // successfully done (or dropped)
 
-    return 0;
+    return ret;
 }
 
 int SampleReader::daq_run()
@@ -273,12 +259,17 @@ int SampleReader::daq_run()
         }
     }
 
-    if (write_OutPort() < 0) {
+    int ret = write_OutPort();
+    if (ret < 0) {
         ;     // Timeout. do nothing.
     }
-    else {    // OutPort write successfully done
+    else {
+        // ret == 0: dropped (backpressure drop), counted too: the footers
+        // skip dropped frames by themselves (see write_OutPort_flow())
         inc_sequence_num();                     // increase sequence num.
-        inc_total_data_size(m_recv_byte_size);  // increase total data byte size
+        if (ret > 0) {     // OutPort write successfully done
+            inc_total_data_size(m_recv_byte_size);  // increase total data byte size
+        }
     }
 
     return 0;
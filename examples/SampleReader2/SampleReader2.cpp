@@ -197,8 +197,9 @@ int SampleReader2::read_data_from_detectors()
     int received_data_size = 0;
 
     /// write your logic here
-    /// read 1024 byte data from data server
-    int status = m_sock->readAll(m_data, SEND_BUFFER_SIZE);
+    /// read 1024 byte data from data server directly into OutPort buffer
+    unsigned char *data = reserve_frame(m_out_data, SEND_BUFFER_SIZE);
+    int status = m_sock->readAll(data, SEND_BUFFER_SIZE);
     if (status == DAQMW::Sock::ERROR_FATAL) {
         std::cerr << "### ERROR: m_sock->readAll" << std::endl;
         fatal_error_report(USER_DEFINED_ERROR1, "SOCKET FATAL ERROR");
@@ -217,18 +218,9 @@ int SampleReader2::read_data_from_detectors()
 
 int SampleReader2::set_data(unsigned int data_byte_size)
 {
-    unsigned char header[8];
-    unsigned char footer[8];
-
-    set_header(&header[0], data_byte_size);
-    set_footer(&footer[0]);
-
-    ///set OutPort buffer length
-    m_out_data.data.length(data_byte_size + HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE);
-    memcpy(&(m_out_data.data[0]), &header[0], HEADER_BYTE_SIZE);
-    memcpy(&(m_out_data.data[HEADER_BYTE_SIZE]), &m_data[0], data_byte_size);
-    memcpy(&(m_out_data.data[HEADER_BYTE_SIZE + data_byte_size]), &footer[0],
-           FOOTER_BYTE_SIZE);
+    /// payload is already in the OutPort buffer (see reserve_frame()).
+    /// set OutPort buffer length and stamp header and footer in place.
+    commit_frame(m_out_data, data_byte_size);
 
     return 0;
 }
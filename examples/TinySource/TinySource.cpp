@@ -142,8 +142,9 @@ int TinySource::read_data_from_detectors()
     int received_data_size = 0;
     /// write your logic here
     usleep(500000);
+    unsigned char *data = reserve_frame(m_out_data, SEND_BUFFER_SIZE);
     for (int i = 0; i < SEND_BUFFER_SIZE; i++) {
-        m_data[i] = (i % 256);
+        data[i] = (i % 256);
     }
     received_data_size = SEND_BUFFER_SIZE;
     /// end of my tiny logic
@@ -153,18 +154,9 @@ int TinySource::read_data_from_detectors()
 
 int TinySource::set_data(unsigned int data_byte_size)
 {
-    unsigned char header[8];
-    unsigned char footer[8];
-
-    set_header(&header[0], data_byte_size);
-    set_footer(&footer[0]);
-
-    ///set OutPort buffer length
-    m_out_data.data.length(data_byte_size + HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE);
-    memcpy(&(m_out_data.data[0]), &header[0], HEADER_BYTE_SIZE);
-    memcpy(&(m_out_data.data[HEADER_BYTE_SIZE]), &m_data[0], data_byte_size);
-    memcpy(&(m_out_data.data[HEADER_BYTE_SIZE + data_byte_size]), &footer[0],
-           FOOTER_BYTE_SIZE);
+    /// payload is already in the OutPort buffer (see reserve_frame()).
+    /// set OutPort buffer length and stamp header and footer in place.
+    commit_frame(m_out_data, data_byte_size);
 
     return 0;
 }
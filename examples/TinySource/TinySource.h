@@ -49,7 +49,6 @@ private:
     int write_OutPort();
 
     static const int SEND_BUFFER_SIZE = 4096;
-    unsigned char m_data[SEND_BUFFER_SIZE];
     unsigned int m_recv_byte_size;
 
     BufferStatus m_out_status;
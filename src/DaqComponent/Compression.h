@@ -0,0 +1,262 @@
+// -*- C++ -*-
+/*!
+ * @file Compression.h
+ * @brief Compressed block format of frame payloads (zlib deflate)
+ *
+ */
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstring>
+#include <zlib.h>
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/**
+ *  A compressed block replaces the event data of a frame, header and
+ *  footer stay as they are (size in the header is the block size), so
+ *  check_header_footer() and integrity mode work on compressed frames.
+ *
+ *  dat[0] dat[1] dat[2]  dat[3]
+ *  'D'    'Z'    codec   reserved
+ *  raw size (4bytes)          event data size before compression
+ *  compressed size (4bytes)   byte size of the deflate data
+ *  deflate data
+ *
+ *  The words are big endian like the header and footer.  The sender sets
+ *  the codec in the frame header too (commit_frame(out, size, codec)),
+ *  receivers decide by get_frame_codec() and never by the payload, raw
+ *  event data may well start with 'D' 'Z' 1.  The block header is only
+ *  checked for consistency.
+ *
+ *  SampleLogger expands compressed frames before saving (decompress=yes,
+ *  the default), so its files hold raw event data for every reader.
+ *  With decompress=no it writes the blocks back to back; a block carries
+ *  both sizes, so such a file can be walked with compressed_block_size()
+ *  and expanded by BlockDecompressor, but DAQ-Middleware has no replay
+ *  reader for it yet.
+ *
+ *  The raw size comes from the wire, receivers check it against a
+ *  maximum (COMPRESS_MAX_RAW_SIZE by default) before allocating.
+ *
+ *  Components using this header link -lz.
+ */
+static const unsigned int COMPRESS_BLOCK_HEADER_SIZE = 12;
+static const unsigned char COMPRESS_MAGIC_0 = 'D';
+static const unsigned char COMPRESS_MAGIC_1 = 'Z';
+static const unsigned char COMPRESS_CODEC_DEFLATE = 1;
+static const unsigned int COMPRESS_MAX_RAW_SIZE = 64 * 1024 * 1024;
+
+inline void compress_put_word(unsigned char *p, unsigned int val)
+{
+    p[0] = (val & 0xff000000) >> 24;
+    p[1] = (val & 0x00ff0000) >> 16;
+    p[2] = (val & 0x0000ff00) >> 8;
+    p[3] = (val & 0x000000ff);
+}
+
+inline unsigned int compress_get_word(const unsigned char *p)
+{
+    return (p[0] << 24) + (p[1] << 16) + (p[2] << 8) + p[3];
+}
+
+/// true if data starts with a consistent compressed block header
+inline bool is_compressed_block(const unsigned char *data, unsigned int byte_size)
+{
+    if (byte_size < COMPRESS_BLOCK_HEADER_SIZE)
+    {
+        return false;
+    }
+    return data[0] == COMPRESS_MAGIC_0 && data[1] == COMPRESS_MAGIC_1
+           && data[2] == COMPRESS_CODEC_DEFLATE
+           && COMPRESS_BLOCK_HEADER_SIZE + compress_get_word(&data[8]) <= byte_size;
+}
+
+/// event data size of the block before compression
+inline unsigned int compressed_raw_size(const unsigned char *block)
+{
+    return compress_get_word(&block[4]);
+}
+
+/// byte size of the whole block (header + deflate data)
+inline unsigned int compressed_block_size(const unsigned char *block)
+{
+    return COMPRESS_BLOCK_HEADER_SIZE + compress_get_word(&block[8]);
+}
+
+/*!
+ * @class BlockCompressor
+ * @brief compresses event data into compressed blocks
+ *
+ * The deflate state is allocated once and reset per block, so small
+ * frames do not pay the zlib setup.  Raw deflate (no zlib header and
+ * checksum): the frame CRC of integrity mode covers the block.
+ */
+class BlockCompressor
+{
+  public:
+    BlockCompressor()
+        : m_level(1), m_ready(false)
+    {
+        memset(&m_stream, 0, sizeof(m_stream));
+    }
+
+    virtual ~BlockCompressor()
+    {
+        if (m_ready)
+        {
+            deflateEnd(&m_stream);
+        }
+    }
+
+    /// 1 (fastest) to 9 (smallest), returns -1 for a bad level
+    int set_level(int level)
+    {
+        if (level < 1 || level > 9)
+        {
+            return -1;
+        }
+        if (m_ready && level != m_level)
+        {
+            deflateEnd(&m_stream);
+            m_ready = false;
+        }
+        m_level = level;
+        return 0;
+    }
+
+    /// largest block compress() can produce for raw_size bytes
+    unsigned int bound(unsigned int raw_size)
+    {
+        if (!init())
+        {
+            return COMPRESS_BLOCK_HEADER_SIZE + raw_size + raw_size / 8 + 64;
+        }
+        return COMPRESS_BLOCK_HEADER_SIZE + deflateBound(&m_stream, raw_size);
+    }
+
+    /**
+     *  Compress raw_size bytes of raw into block (block_max bytes).
+     *  Returns the block byte size, -1 on error.
+     */
+    int compress(const unsigned char *raw, unsigned int raw_size,
+                 unsigned char *block, unsigned int block_max)
+    {
+        if (block_max < COMPRESS_BLOCK_HEADER_SIZE || !init())
+        {
+            return -1;
+        }
+        deflateReset(&m_stream);
+        m_stream.next_in = (Bytef *)raw;
+        m_stream.avail_in = raw_size;
+        m_stream.next_out = &block[COMPRESS_BLOCK_HEADER_SIZE];
+        m_stream.avail_out = block_max - COMPRESS_BLOCK_HEADER_SIZE;
+        if (deflate(&m_stream, Z_FINISH) != Z_STREAM_END)
+        {
+            return -1;
+        }
+        unsigned int deflate_size = m_stream.total_out;
+        block[0] = COMPRESS_MAGIC_0;
+        block[1] = COMPRESS_MAGIC_1;
+        block[2] = COMPRESS_CODEC_DEFLATE;
+        block[3] = 0;
+        compress_put_word(&block[4], raw_size);
+        compress_put_word(&block[8], deflate_size);
+        return COMPRESS_BLOCK_HEADER_SIZE + deflate_size;
+    }
+
+  private:
+    bool init()
+    {
+        if (!m_ready)
+        {
+            memset(&m_stream, 0, sizeof(m_stream));
+            m_ready = (deflateInit2(&m_stream, m_level, Z_DEFLATED, -15, 8,
+                                    Z_DEFAULT_STRATEGY) == Z_OK);
+        }
+        return m_ready;
+    }
+
+    z_stream m_stream;
+    int m_level;
+    bool m_ready;
+};
+
+/*!
+ * @class BlockDecompressor
+ * @brief expands compressed blocks
+ */
+class BlockDecompressor
+{
+  public:
+    BlockDecompressor()
+        : m_ready(false)
+    {
+        memset(&m_stream, 0, sizeof(m_stream));
+    }
+
+    virtual ~BlockDecompressor()
+    {
+        if (m_ready)
+        {
+            inflateEnd(&m_stream);
+        }
+    }
+
+    /**
+     *  Expand the block (block_size bytes, see is_compressed_block())
+     *  into raw (raw_max bytes, at least compressed_raw_size()).
+     *  Returns the raw byte size, -1 on error.
+     */
+    int decompress(const unsigned char *block, unsigned int block_size,
+                   unsigned char *raw, unsigned int raw_max)
+    {
+        if (!is_compressed_block(block, block_size) || !init())
+        {
+            return -1;
+        }
+        unsigned int raw_size = compressed_raw_size(block);
+        if (raw_size > raw_max)
+        {
+            return -1;
+        }
+        if (raw_size == 0)
+        {
+            return 0;
+        }
+        inflateReset(&m_stream);
+        m_stream.next_in = (Bytef *)&block[COMPRESS_BLOCK_HEADER_SIZE];
+        m_stream.avail_in = compress_get_word(&block[8]);
+        m_stream.next_out = raw;
+        m_stream.avail_out = raw_size;
+        if (inflate(&m_stream, Z_FINISH) != Z_STREAM_END
+            || m_stream.total_out != raw_size)
+        {
+            return -1;
+        }
+        return raw_size;
+    }
+
+  private:
+    bool init()
+    {
+        if (!m_ready)
+        {
+            memset(&m_stream, 0, sizeof(m_stream));
+            m_ready = (inflateInit2(&m_stream, -15) == Z_OK);
+        }
+        return m_ready;
+    }
+
+    z_stream m_stream;
+    bool m_ready;
+};
+
+} // namespace DAQMW
+
+#endif // COMPRESSION_H
@@ -0,0 +1,139 @@
+// -*- C++ -*-
+/*!
+ * @file Crc32c.h
+ * @brief CRC32C (Castagnoli) checksum
+ *
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define DAQMW_CRC32C_X86 1
+#endif
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/**
+ *  CRC32C of a buffer.
+ *
+ *    uint32_t crc = crc32c(data, len);
+ *
+ *  crc32c(crc, data, len) continues the CRC crc of the preceding bytes,
+ *  crc32c(crc32c(a, n), b, m) is the CRC of a followed by b.
+ *
+ *  Uses the SSE4.2 crc32 instruction when the CPU has it (checked once at
+ *  run time, so the binary does not need -msse4.2) and a table driven
+ *  implementation otherwise.  Both give the same result.
+ */
+static const uint32_t CRC32C_POLY = 0x82f63b78; // reflected 0x1edc6f41
+
+struct Crc32cTable
+{
+    uint32_t entry[256];
+
+    Crc32cTable()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; j++)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : (crc >> 1);
+            }
+            entry[i] = crc;
+        }
+    }
+};
+
+inline const uint32_t *crc32c_table()
+{
+    static const Crc32cTable table;
+    return table.entry;
+}
+
+/// table driven update, crc is the running (inverted) value
+inline uint32_t crc32c_sw(uint32_t crc, const unsigned char *data, size_t len)
+{
+    const uint32_t *table = crc32c_table();
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef DAQMW_CRC32C_X86
+/// SSE4.2 update, crc is the running (inverted) value
+__attribute__((target("sse4.2")))
+inline uint32_t crc32c_hw(uint32_t crc, const unsigned char *data, size_t len)
+{
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (len >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (len >= 4)
+    {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+        data += 4;
+        len -= 4;
+    }
+    while (len > 0)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+        data++;
+        len--;
+    }
+    return crc;
+}
+#endif
+
+inline bool crc32c_hw_available()
+{
+#ifdef DAQMW_CRC32C_X86
+    static const bool available = __builtin_cpu_supports("sse4.2");
+    return available;
+#else
+    return false;
+#endif
+}
+
+inline uint32_t crc32c(uint32_t crc, const unsigned char *data, size_t len)
+{
+    crc = ~crc;
+#ifdef DAQMW_CRC32C_X86
+    if (crc32c_hw_available())
+    {
+        return ~crc32c_hw(crc, data, len);
+    }
+#endif
+    return ~crc32c_sw(crc, data, len);
+}
+
+inline uint32_t crc32c(const unsigned char *data, size_t len)
+{
+    return crc32c(0, data, len);
+}
+
+} // namespace DAQMW
+
+#endif // CRC32C_H
@@ -18,10 +18,11 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <fstream>
+#include <functional>
 #include <memory>
-#include <pwd.h> // Mesure Time use
 #include <unistd.h>
 #include <sys/time.h>
 
@@ -35,8 +36,16 @@
 
 #include "DAQServiceSVC_impl.h"
 #include "DAQService.hh"
+#include "Crc32c.h"
 #include "DaqComponentException.h"
+#include "DaqStateMachine.h"
+#include "DaqWorkerPool.h"
+#include "EventBlock.h"
+#include "EventMerger.h"
+#include "OutputThrottle.h"
+#include "ShmTransport.h"
 #include "Timer.h"
+#include "TimingRecorder.h"
 
 using namespace std;
 
@@ -68,14 +77,31 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
           m_trans_lock(false),
           m_DAQServicePort("DAQService"),
           m_command(CMD_NOP),
-          m_state(LOADED),
-          m_state_prev(LOADED),
           m_isOnError(false),
           m_isTimerAlarm(false),
           m_has_printed_error_log(false),
           m_debug(false),
-          m_time(false)
+          m_time(false),
+          m_event_driven(false),
+          m_integrity(false),
+          m_seq_tolerant(false),
+          m_worker_num(0),
+          m_worker_window(0),
+          m_drain_max_events(DRAIN_MAX_EVENTS),
+          m_drain_max_bytes(0),
+          m_drain_max_usec(DRAIN_MAX_USEC),
+          m_backpressure(BACKPRESSURE_BLOCK),
+          m_backpressure_wait_usec(BACKPRESSURE_WAIT_USEC),
+          m_out_seq_skip(0),
+          m_timing_format(TimingRecorder::CSV),
+          m_merger(0)
     {
+        ShmTransportInit(); // before the component registers its ports
+        reset_metrics();
+        for (int i = 0; i < DAQ_CMD_SIZE; i++)
+        {
+            m_trans_usec[i] = 0;
+        }
     }
 
     virtual ~DaqComponentBase()
@@ -99,7 +125,13 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
     static constexpr unsigned int FOOTER_BYTE_SIZE = 8;
     static constexpr unsigned char HEADER_MAGIC = 0xe7;
     static constexpr unsigned char FOOTER_MAGIC = 0xcc;
+    static constexpr unsigned char FRAME_CODEC_RAW = 0;
     static constexpr unsigned int EVENT_BUF_OFFSET = HEADER_BYTE_SIZE;
+    static constexpr unsigned int DRAIN_MAX_EVENTS = 64;   // drain_InPort() default
+    static constexpr unsigned int DRAIN_MAX_USEC = 10000;  // 10 msec
+    static constexpr unsigned int BACKPRESSURE_WAIT_USEC = 100000;        // 100 msec
+    static constexpr unsigned int BACKPRESSURE_FIRST_WAIT_USEC = 1000;    // 1 msec
+    static constexpr unsigned int BACKPRESSURE_MAX_INTERVAL_USEC = 16000; // 16 msec
 
     /**
          *  The data structure transferring between DAQ-Components is
@@ -110,11 +142,20 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
          *  Footer data includes magic number(2bytes), sequence number(4bytes).
          *
          *                dat[0] dat[1] dat[2]    dat[3]   dat[4]     dat[5]     dat[6]    dat[7]
-         *  Header        0xe7   0xe7   reserved  reserved siz(24:31) siz(16:23) siz(8:15) siz(0:7)
+         *  Header        0xe7   0xe7   codec     reserved siz(24:31) siz(16:23) siz(8:15) siz(0:7)
          *  Event data1
          *  ...
          *  Event dataN
          *  Footer        0xcc   0xcc   reserved  reserved seq(24:31) seq(16:23) seq(8:15) seq(0:7)
+         *
+         *  codec is 0 (FRAME_CODEC_RAW) for plain event data, otherwise the
+         *  event data is a compressed block of that codec (Compression.h).
+         *  commit_frame() sets it, get_frame_codec() reads it.
+         *
+         *  In integrity mode (set_integrity_on() or param integrity=crc32c)
+         *  the reserved bytes carry the low 24 bits of the CRC32C of codec
+         *  and event data: crc(16:23) in the header, crc(8:15) crc(0:7) in
+         *  the footer.  Sender and receiver must both be in integrity mode.
          */
 
     virtual int set_header(unsigned char *header, unsigned int data_byte_size)
@@ -130,19 +171,210 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
         return 0;
     }
 
+    /// frames dropped by write_OutPort_flow() do not count (see there)
     virtual int set_footer(unsigned char *footer)
     {
+        unsigned long long seq = m_loop - m_out_seq_skip;
         footer[0] = FOOTER_MAGIC;
         footer[1] = FOOTER_MAGIC;
         footer[2] = 0;
         footer[3] = 0;
-        footer[4] = (m_loop & 0xff000000) >> 24;
-        footer[5] = (m_loop & 0x00ff0000) >> 16;
-        footer[6] = (m_loop & 0x0000ff00) >> 8;
-        footer[7] = (m_loop & 0x000000ff);
+        footer[4] = (seq & 0xff000000) >> 24;
+        footer[5] = (seq & 0x00ff0000) >> 16;
+        footer[6] = (seq & 0x0000ff00) >> 8;
+        footer[7] = (seq & 0x000000ff);
+        return 0;
+    }
+
+    /**
+         *  Frame builder for OutPort data.
+         *
+         *  reserve_frame() sizes the TimedOctetSeq once for the largest
+         *  payload and returns a pointer to the payload region (just after
+         *  the header), so that the payload can be read from a socket or
+         *  computed directly into the OutPort buffer.
+         *  commit_frame() trims the sequence to the real payload size and
+         *  stamps the header and footer in place.  No staging buffer and
+         *  no memcpy are required.
+         *
+         *    unsigned char *payload = reserve_frame(m_out_data, MAX_SIZE);
+         *    int len = m_sock->readAll(payload, MAX_SIZE);
+         *    commit_frame(m_out_data, len);
+         *    m_OutPort.write();
+         *
+         *  The sequence keeps its allocation when it is trimmed, so
+         *  reserving the same size again in the next loop does not
+         *  reallocate.
+         */
+    unsigned char *reserve_frame(RTC::TimedOctetSeq &out_data,
+                                 unsigned int max_data_byte_size)
+    {
+        out_data.data.length(max_data_byte_size + HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE);
+        return &(out_data.data[EVENT_BUF_OFFSET]);
+    }
+
+    int commit_frame(RTC::TimedOctetSeq &out_data, unsigned int data_byte_size,
+                     unsigned char codec = FRAME_CODEC_RAW)
+    {
+        unsigned int frame_byte_size = out_data.data.length();
+        unsigned int reserved_byte_size = 0;
+        if (frame_byte_size >= HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE)
+        {
+            reserved_byte_size = get_event_size(frame_byte_size);
+        }
+        if (data_byte_size > reserved_byte_size)
+        {
+            cerr << "### ERROR: commit_frame: data byte size " << data_byte_size
+                 << " exceeds reserved size " << reserved_byte_size << '\n';
+            fatal_error_report(FatalType::OUTPORT_ERROR);
+        }
+        out_data.data.length(data_byte_size + HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE);
+        set_header(&(out_data.data[0]), data_byte_size);
+        out_data.data[2] = codec;
+        set_footer(&(out_data.data[HEADER_BYTE_SIZE + data_byte_size]));
+        if (m_integrity)
+        {
+            set_frame_crc(&(out_data.data[0]), data_byte_size);
+        }
+        return 0;
+    }
+
+    /// codec of the event data of a received frame (see the header format)
+    unsigned char get_frame_codec(const RTC::TimedOctetSeq &in_data)
+    {
+        return in_data.data[2];
+    }
+
+    /**
+         *  Store the CRC of codec and event data into the reserved bytes
+         *  of header and footer.  commit_frame() and commit_block() call
+         *  it in integrity mode; components which build frames by
+         *  set_header()/set_footer() call it after them.
+         */
+    int set_frame_crc(unsigned char *frame, unsigned int data_byte_size)
+    {
+        uint32_t crc = frame_crc(frame, data_byte_size);
+        unsigned char *footer = &frame[HEADER_BYTE_SIZE + data_byte_size];
+        frame[3] = (crc & 0x00ff0000) >> 16;
+        footer[2] = (crc & 0x0000ff00) >> 8;
+        footer[3] = (crc & 0x000000ff);
         return 0;
     }
 
+    bool check_frame_crc(const unsigned char *frame, unsigned int data_byte_size)
+    {
+        const unsigned char *footer = &frame[HEADER_BYTE_SIZE + data_byte_size];
+        uint32_t crc_in_frame = (frame[3] << 16) + (footer[2] << 8) + footer[3];
+        uint32_t crc = frame_crc(frame, data_byte_size);
+        if (crc != crc_in_frame)
+        {
+            cerr << "### ERROR: CRC32C missmatch" << '\n';
+            cerr << "crc in frame: " << hex << crc_in_frame
+                 << "  crc of event data: " << crc << dec << '\n';
+            return false;
+        }
+        return true;
+    }
+
+    /// low 24 bits of the CRC32C of codec byte and event data
+    uint32_t frame_crc(const unsigned char *frame, unsigned int data_byte_size)
+    {
+        uint32_t crc = crc32c(&frame[2], 1);
+        crc = crc32c(crc, &frame[HEADER_BYTE_SIZE], data_byte_size);
+        return crc & 0x00ffffff;
+    }
+
+    /**
+         *  Event block builder for OutPort data (see EventBlock.h).
+         *
+         *  Events are appended to the OutPort buffer one by one, either
+         *  copied by add_block_event() or written in place between
+         *  reserve_block_event() and commit_block_event().  When
+         *  block.flush_due() becomes true the block is closed by
+         *  commit_block() and written by OutPort::write().
+         *
+         *    add_block_event(m_out_data, m_block, event, event_byte_size);
+         *    if (m_block.flush_due()) {
+         *        m_block_event_num = commit_block(m_out_data, m_block);
+         *        if (m_OutPort.write()) {
+         *            inc_sequence_num();
+         *            inc_total_event_num(m_block_event_num);
+         *        }
+         *    }
+         *
+         *  One block is one frame: the sequence number counts blocks and
+         *  inc_total_event_num() takes the number of events in the block.
+         */
+    unsigned char *reserve_block_event(RTC::TimedOctetSeq &out_data,
+                                       EventBlockWriter &block,
+                                       unsigned int max_event_byte_size)
+    {
+        unsigned int pos = HEADER_BYTE_SIZE + block.event_byte_size();
+        unsigned int length = out_data.data.length();
+        if (pos + max_event_byte_size > length)
+        {
+            // sized for the whole block (EventBlockWriter::reserve_byte_size()),
+            // without a max_bytes policy doubled, commit_block() trims it
+            unsigned int new_length = HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE
+                                      + block.reserve_byte_size(max_event_byte_size);
+            if (block.get_policy().max_bytes == 0 && new_length < 2 * length)
+            {
+                new_length = 2 * length;
+            }
+            out_data.data.length(new_length);
+        }
+        return &(out_data.data[pos]);
+    }
+
+    int commit_block_event(RTC::TimedOctetSeq &out_data,
+                           EventBlockWriter &block,
+                           unsigned int event_byte_size)
+    {
+        unsigned int pos = HEADER_BYTE_SIZE + block.event_byte_size();
+        if (pos + event_byte_size > out_data.data.length())
+        {
+            cerr << "### ERROR: commit_block_event: event byte size "
+                 << event_byte_size << " exceeds reserved size" << '\n';
+            fatal_error_report(FatalType::OUTPORT_ERROR);
+        }
+        block.add(event_byte_size);
+        return 0;
+    }
+
+    int add_block_event(RTC::TimedOctetSeq &out_data,
+                        EventBlockWriter &block,
+                        const unsigned char *event_data,
+                        unsigned int event_byte_size)
+    {
+        unsigned char *p = reserve_block_event(out_data, block, event_byte_size);
+        memcpy(p, event_data, event_byte_size);
+        return commit_block_event(out_data, block, event_byte_size);
+    }
+
+    /**
+         *  Close the block: append index and event count, stamp header
+         *  and footer, and reset the builder for the next block.
+         *  Returns the number of events in the block.
+         */
+    unsigned int commit_block(RTC::TimedOctetSeq &out_data,
+                              EventBlockWriter &block)
+    {
+        unsigned int event_num = block.event_num();
+        unsigned int event_byte_size = block.event_byte_size();
+        unsigned int block_byte_size = block.block_byte_size();
+
+        out_data.data.length(block_byte_size + HEADER_BYTE_SIZE + FOOTER_BYTE_SIZE);
+        block.write_index(&(out_data.data[HEADER_BYTE_SIZE + event_byte_size]));
+        set_header(&(out_data.data[0]), block_byte_size);
+        set_footer(&(out_data.data[HEADER_BYTE_SIZE + block_byte_size]));
+        if (m_integrity)
+        {
+            set_frame_crc(&(out_data.data[0]), block_byte_size);
+        }
+        block.reset();
+        return event_num;
+    }
+
     bool check_header(unsigned char *header, unsigned int received_byte)
     {
         bool ret = false;
@@ -177,12 +409,18 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
         if (footer[0] == FOOTER_MAGIC && footer[1] == FOOTER_MAGIC)
         {
             unsigned int seq_num = (footer[4] << 24) + (footer[5] << 16) + (footer[6] << 8) + footer[7];
-            if (seq_num == m_loop)
+            if (seq_num == (unsigned int)m_loop)
+            {
+                ret = true;
+            }
+            else if (m_seq_tolerant)
             {
+                resync_sequence(seq_num);
                 ret = true;
             }
             else
             {
+                m_seq_gap++;
                 cerr << "### ERROR: Sequence No. missmatch" << '\n';
                 cerr << "sequece no. in footer :" << seq_num << '\n';
                 cerr << "loop cnts at component:" << m_loop << '\n';
@@ -191,6 +429,32 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
         return ret;
     }
 
+    /**
+         *  Tolerant sequence check: take the sequence number of the footer
+         *  as the new local one and count the gap instead of failing.
+         *  A forward jump of n is n lost frames; a backward jump (sender
+         *  restarted) is counted as a gap without lost frames.
+         */
+    void resync_sequence(unsigned int seq_num)
+    {
+        // footer holds the low 32 bits of the sender's loop count
+        unsigned int diff = seq_num - (unsigned int)m_loop;
+        m_seq_gap++;
+        if (diff < 0x80000000u)
+        {
+            m_seq_gap_frames += diff;
+            if (diff > m_seq_gap_max)
+            {
+                m_seq_gap_max = diff;
+            }
+            m_loop += diff;
+        }
+        else
+        {
+            m_loop -= (0x100000000ULL - diff);
+        }
+    }
+
     bool check_header_footer(const RTC::TimedOctetSeq &in_data, unsigned int block_byte_size)
     {
         unsigned int event_byte_size =
@@ -224,9 +488,354 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
             cerr << "### ERROR: footer invalid" << '\n';
             fatal_error_report(FatalType::FOOTER_DATA_MISMATCH);
         }
+
+        if (m_integrity && !check_frame_crc(&(in_data.data[0]), event_byte_size))
+        {
+            cerr << "### ERROR: event data corrupted in loop" << m_loop
+                 << '\n';
+            fatal_error_report(FatalType::FOOTER_DATA_MISMATCH);
+        }
         return true;
     }
 
+    /**
+         *  check_header_footer() for an event block.  In addition to the
+         *  header and footer, the index of the block is checked against
+         *  the payload size.  Returns the number of events in the block.
+         */
+    unsigned int check_block_header_footer(const RTC::TimedOctetSeq &in_data,
+                                           unsigned int block_byte_size)
+    {
+        check_header_footer(in_data, block_byte_size);
+
+        EventBlockReader block(&(in_data.data[HEADER_BYTE_SIZE]),
+                               get_event_size(block_byte_size));
+        if (!block.is_valid())
+        {
+            cerr << "### ERROR: event block index invalid in loop" << m_loop
+                 << '\n';
+            fatal_error_report(FatalType::HEADER_DATA_MISMATCH);
+        }
+        return block.event_num();
+    }
+
+    /**
+         *  Worker threads for filters with heavy per-event work
+         *  (see DaqWorkerPool.h).  set_worker_num() declares the number of
+         *  workers and the work function, e.g. in daq_configure().  The
+         *  pool is started after daq_start() and stopped before daq_stop().
+         *
+         *    if (!m_in_pending && read_InPort() > 0) {
+         *        check_header_footer(m_in_data, m_inport_recv_data_size);
+         *        m_in_pending = true;
+         *    }
+         *    if (m_in_pending
+         *        && submit_worker_frame(m_in_data, m_inport_recv_data_size)) {
+         *        inc_sequence_num();
+         *        m_in_pending = false;
+         *    }
+         *    if (collect_worker_frame(m_out_data) > 0) {
+         *        write m_out_data to the OutPort
+         *    }
+         *
+         *  Results are collected in the order the input frames were
+         *  submitted.  The pool numbers the frames itself, counting from
+         *  the sequence number at start, and each output footer carries
+         *  that number, so a gap skipped by the tolerant sequence check
+         *  does not stall the pool.  Before releasing the transition
+         *  lock at stop, wait until workers_idle().
+         *  worker_num 0 (default) disables the pool.
+         */
+    int set_worker_num(unsigned int worker_num, DaqWorkerPool::WorkFunc func,
+                       unsigned int window = 0)
+    {
+        m_worker_num = worker_num;
+        m_worker_func = func;
+        m_worker_window = window;
+        return 0;
+    }
+
+    unsigned int get_worker_num()
+    {
+        return m_worker_num;
+    }
+
+    /// false if the reorder window is full, submit the frame again later
+    bool submit_worker_frame(const RTC::TimedOctetSeq &in_data,
+                             unsigned int block_byte_size)
+    {
+        return m_workers.submit(&(in_data.data[HEADER_BYTE_SIZE]),
+                                get_event_size(block_byte_size));
+    }
+
+    /**
+         *  Build the next result frame in out_data.
+         *  Returns 1 if a frame was built, 0 if the next result is not
+         *  ready yet and -1 if the work function failed.
+         */
+    int collect_worker_frame(RTC::TimedOctetSeq &out_data)
+    {
+        unsigned long long seq;
+        int ret;
+        if (!m_workers.collect(m_worker_out, &seq, &ret))
+        {
+            return 0;
+        }
+        if (ret < 0)
+        {
+            cerr << "### ERROR: work function failed in sequence no. " << seq
+                 << '\n';
+            return -1;
+        }
+        unsigned int data_byte_size = m_worker_out.size();
+        unsigned char *payload = reserve_frame(out_data, data_byte_size);
+        if (data_byte_size > 0)
+        {
+            memcpy(payload, &m_worker_out[0], data_byte_size);
+        }
+        commit_frame(out_data, data_byte_size);
+        // frame number of the pool, not m_loop (frames already submitted)
+        seq -= m_out_seq_skip;
+        unsigned char *footer = &(out_data.data[HEADER_BYTE_SIZE + data_byte_size]);
+        footer[4] = (seq & 0xff000000) >> 24;
+        footer[5] = (seq & 0x00ff0000) >> 16;
+        footer[6] = (seq & 0x0000ff00) >> 8;
+        footer[7] = (seq & 0x000000ff);
+        return 1;
+    }
+
+    /// true if every submitted frame has been collected
+    bool workers_idle()
+    {
+        return m_workers.is_idle();
+    }
+
+    /**
+         *  Frame handler of drain_InPort(): called once per frame read,
+         *  block_byte_size is the frame size with header and footer.
+         *  Return 0 to go on, a negative value to stop draining.
+         */
+    typedef std::function<int(RTC::TimedOctetSeq &in_data,
+                              unsigned int block_byte_size)> DrainFunc;
+
+    /**
+         *  Budget of one drain_InPort() call.  0 means no limit on bytes
+         *  or time; at least one frame is always handled.  Also set by the
+         *  drainEvents, drainBytes and drainUsec component parameters.
+         */
+    void set_drain_budget(unsigned int max_events, unsigned int max_bytes = 0,
+                          unsigned int max_usec = 0)
+    {
+        m_drain_max_events = (max_events == 0) ? 1 : max_events;
+        m_drain_max_bytes = max_bytes;
+        m_drain_max_usec = max_usec;
+    }
+
+    /**
+         *  Read the frames buffered in the InPort and hand them to func
+         *  until the InPort buffer is empty, the budget is used up or a
+         *  command arrives, so the daq_do() round trip (command check,
+         *  status report) is paid once per batch instead of once per frame.
+         *  Only the first read waits (buffer_read_timeout).
+         *
+         *    int SampleLogger::daq_run()
+         *    {
+         *        if (drain_InPort(m_InPort, m_in_data, m_drain_func) == 0
+         *            && check_trans_lock()) {
+         *            set_trans_unlock();
+         *        }
+         *        return 0;
+         *    }
+         *
+         *  func does what daq_run() did for one frame: check_header_footer(),
+         *  inc_sequence_num(), inc_total_data_size(), ...
+         *  Returns the number of frames handled, -1 if func failed.
+         *  A fatal InPort status is reported with fatal_error_report().
+         */
+    int drain_InPort(RTC::InPort<RTC::TimedOctetSeq> &myInPort,
+                     RTC::TimedOctetSeq &in_data, const DrainFunc &func)
+    {
+        struct timespec start;
+        if (m_drain_max_usec > 0)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+        }
+        unsigned int events = 0;
+        unsigned long long bytes = 0;
+        while (events < m_drain_max_events)
+        {
+            if (events > 0 && (myInPort.isEmpty() || m_daq_service0.hasCommand()))
+            {
+                break;
+            }
+            if (!myInPort.read())
+            {
+                if (check_inPort_status(myInPort) == BUF_FATAL)
+                {
+                    fatal_error_report(FatalType::INPORT_ERROR);
+                }
+                break;
+            }
+            unsigned int block_byte_size = in_data.data.length();
+            events++;
+            bytes += block_byte_size;
+            if (func(in_data, block_byte_size) < 0)
+            {
+                return -1;
+            }
+            if (m_drain_max_bytes > 0 && bytes >= m_drain_max_bytes)
+            {
+                break;
+            }
+            if (m_drain_max_usec > 0)
+            {
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                long long usec = (now.tv_sec - start.tv_sec) * 1000000LL
+                                 + (now.tv_nsec - start.tv_nsec) / 1000;
+                if (usec >= m_drain_max_usec)
+                {
+                    break;
+                }
+            }
+        }
+        return events;
+    }
+
+    /**
+         *  What write_OutPort_flow() does when the receiver has no free
+         *  slot: wait for one (block) or drop the frame (drop, degraded
+         *  mode for monitors and other best effort paths).
+         */
+    enum Backpressure
+    {
+        BACKPRESSURE_BLOCK,
+        BACKPRESSURE_DROP
+    };
+
+    /**
+         *  Also set by the backpressure (block or drop) and
+         *  backpressureWaitUsec component parameters.
+         *  max_wait_usec bounds one write_OutPort_flow() call so that
+         *  daq_do() still reports the status while the receiver is stalled.
+         */
+    void set_backpressure(Backpressure mode,
+                          unsigned int max_wait_usec = BACKPRESSURE_WAIT_USEC)
+    {
+        m_backpressure = mode;
+        m_backpressure_wait_usec = max_wait_usec;
+    }
+
+    /**
+         *  Write the OutPort with flow control.  The receiver grants a
+         *  credit for each frame by taking it into its InPort buffer
+         *  (PORT_OK); a full buffer (SEND_TIMEOUT/SEND_FULL, or a full
+         *  ring with transport="shm") means no free slot.  Without a
+         *  credit the sender sleeps on the command mailbox with growing
+         *  intervals instead of going around daq_do() at full speed, and
+         *  a STOP/PAUSE command wakes it at once.
+         *
+         *  Returns 1 if the frame was sent, 0 if it was dropped
+         *  (BACKPRESSURE_DROP) and -1 if it is still not sent (command
+         *  arrived or max_wait_usec passed); call it again with the same
+         *  data from the next daq_run().
+         *  Stalls, stalled time and drops are reported in the metrics;
+         *  a stalled frame counts once in outport_timeout however often
+         *  it is retried.  The stall is kept per OutPort, a component
+         *  writing several OutPorts (FanOutDispatcher) counts each.
+         *
+         *  A dropped frame does not take a sequence number: the footers
+         *  set_footer() and collect_worker_frame() stamp afterwards are
+         *  one lower, so the receiver sees no gap and keeps the strict
+         *  sequence check.  The component itself still counts the frame
+         *  (inc_sequence_num()) to check its own input.  A component
+         *  forwarding input frames with their footers (FanOutDispatcher)
+         *  stamps nothing, so with drop its receiver does see a gap and
+         *  needs the tolerant sequence check.
+         */
+    int write_OutPort_flow(RTC::OutPort<RTC::TimedOctetSeq> &myOutPort)
+    {
+        struct timespec start;
+        unsigned int wait_usec = BACKPRESSURE_FIRST_WAIT_USEC;
+        long long waited_usec = 0;
+        for (;;)
+        {
+            if (myOutPort.write())
+            {
+                set_stalled(myOutPort, false);
+                return 1;
+            }
+            if (check_outPort_status(myOutPort) == BUF_FATAL)
+            {
+                fatal_error_report(FatalType::OUTPORT_ERROR);
+            }
+            if (!is_stalled(myOutPort))
+            {
+                set_stalled(myOutPort, true);
+                m_stall_count++;
+            }
+            if (m_backpressure == BACKPRESSURE_DROP)
+            {
+                set_stalled(myOutPort, false);
+                m_drop_count++;
+                m_out_seq_skip++;
+                return 0;
+            }
+            if (waited_usec >= m_backpressure_wait_usec)
+            {
+                return -1;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            bool has_command = m_daq_service0.waitCommand(wait_usec);
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long usec = (now.tv_sec - start.tv_sec) * 1000000LL
+                             + (now.tv_nsec - start.tv_nsec) / 1000;
+            m_stall_usec += usec;
+            waited_usec += usec;
+            if (has_command)
+            {
+                return -1;
+            }
+            if (wait_usec < BACKPRESSURE_MAX_INTERVAL_USEC)
+            {
+                wait_usec *= 2;
+            }
+        }
+    }
+
+    bool is_stalled(const RTC::OutPort<RTC::TimedOctetSeq> &myOutPort) const
+    {
+        for (unsigned int i = 0; i < m_stalled_ports.size(); i++)
+        {
+            if (m_stalled_ports[i] == &myOutPort)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// a handful of OutPorts at most, usually none stalled
+    void set_stalled(const RTC::OutPort<RTC::TimedOctetSeq> &myOutPort, bool stalled)
+    {
+        for (unsigned int i = 0; i < m_stalled_ports.size(); i++)
+        {
+            if (m_stalled_ports[i] == &myOutPort)
+            {
+                if (!stalled)
+                {
+                    m_stalled_ports.erase(m_stalled_ports.begin() + i);
+                }
+                return;
+            }
+        }
+        if (stalled)
+        {
+            m_stalled_ports.push_back(&myOutPort);
+        }
+    }
+
     unsigned int get_event_size(unsigned int block_byte_size)
     {
         return (block_byte_size - HEADER_BYTE_SIZE - FOOTER_BYTE_SIZE);
@@ -281,6 +890,7 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
     int reset_sequence_num()
     {
         m_loop = 0;
+        m_out_seq_skip = 0;
         return 0;
     }
 
@@ -306,6 +916,40 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
         return m_totalDataSize;
     }
 
+    /// counters of throttle go to the metrics as output_drops of port_name
+    int register_output_throttle(const char *port_name, OutputThrottle *throttle)
+    {
+        m_throttles.push_back(std::make_pair(string(port_name), throttle));
+        return 0;
+    }
+
+    /// for components that register the throttles of the configured outputs
+    int clear_output_throttles()
+    {
+        m_throttles.clear();
+        return 0;
+    }
+
+    /// incomplete events and late fragments of merger go to the metrics
+    int register_event_merger(EventMerger *merger)
+    {
+        m_merger = merger;
+        return 0;
+    }
+
+    /**
+         *  Bytes into and out of a codec (compression filter) and the time
+         *  it took, for compress_ratio and codec_byte_rate in the metrics.
+         */
+    int add_codec_bytes(unsigned long long in_bytes, unsigned long long out_bytes,
+                        unsigned long long usec)
+    {
+        m_codec_in_bytes += in_bytes;
+        m_codec_out_bytes += out_bytes;
+        m_codec_usec += usec;
+        return 0;
+    }
+
     int inc_total_event_num(unsigned int eventNum)
     {
         m_totalEventNum += eventNum;
@@ -363,19 +1007,24 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
         throw DaqCompUserException(type, desc, code);
     }
 
+    /**
+         *  Legal transitions are in DAQ_TRANSITION_TABLE (DaqStateMachine.h)
+         *  and actions are dispatched by transAction() and doAction().
+         *  Kept for the components which call it in the constructor.
+         */
     void init_state_table()
     {
-        m_daq_trans_func[CMD_CONFIGURE] = &DAQMW::DaqComponentBase::daq_base_configure;
-        m_daq_trans_func[CMD_START] = &DAQMW::DaqComponentBase::daq_base_start;
-        m_daq_trans_func[CMD_PAUSE] = &DAQMW::DaqComponentBase::daq_pause;
-        m_daq_trans_func[CMD_RESUME] = &DAQMW::DaqComponentBase::daq_resume;
-        m_daq_trans_func[CMD_STOP] = &DAQMW::DaqComponentBase::daq_base_stop;
-        m_daq_trans_func[CMD_UNCONFIGURE] = &DAQMW::DaqComponentBase::daq_base_unconfigure;
+    }
 
-        m_daq_do_func[LOADED] = &DAQMW::DaqComponentBase::daq_base_dummy;
-        m_daq_do_func[CONFIGURED] = &DAQMW::DaqComponentBase::daq_base_dummy;
-        m_daq_do_func[RUNNING] = &DAQMW::DaqComponentBase::daq_run;
-        m_daq_do_func[PAUSED] = &DAQMW::DaqComponentBase::daq_base_dummy;
+    /// usec spent in the last transition by command, including the wait
+    /// for the transition lock
+    long long get_transition_usec(DAQCommand command)
+    {
+        if ((int)command < 0 || (int)command >= DAQ_CMD_SIZE)
+        {
+            return 0;
+        }
+        return m_trans_usec[command];
     }
 
     int reset_timer()
@@ -392,14 +1041,20 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
 
     /**
          * Convert OutPort RTC::DataPortStatus to DAQMW::BufferStatus
-         * We use RTC::RingBuffer with the following condition:
-         *   buffer.write.full_policy: block with timeout
-         *   buffer.read.empty_policy: block with timeout
+         * The buffers are RTC::RingBuffer configured per connection by the
+         * inPort/outPort attributes of the configuration file (DaqOperator
+         * sets dataport.inport.buffer.* and dataport.outport.buffer.*):
+         *   buffer.write.full_policy: block (with timeout), overwrite,
+         *                             do_nothing (skip)
+         *   buffer.read.empty_policy: block (with timeout), do_nothing
          * OutPort::write() returns:
          *   PORT_OK, PORT_ERROR, SEND_FULL, SEND_TIMEOUT, UNKNOWN_ERROR,
          *   PRECONDITION_NOT_MET, CONNECTION_LOST
-         * In this case, we get a DataPortStatus such as PORT_OK, SEND_TIMEOUT,
-         * PRECONDITION_NOT_MET, CONNECTION_LOST and UNKNOWN_ERROR.
+         * and, with subscription_type new or periodic (OutPort buffer),
+         *   BUFFER_FULL, BUFFER_TIMEOUT
+         * A full buffer with block policy gives SEND_TIMEOUT (BUFFER_TIMEOUT),
+         * with do_nothing policy SEND_FULL (BUFFER_FULL).  With overwrite
+         * policy write() succeeds and the oldest data in the buffer is lost.
          */
     BufferStatus check_outPort_status(RTC::OutPort<RTC::TimedOctetSeq> &myOutPort)
     {
@@ -418,9 +1073,15 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
             ret = BUF_SUCCESS;
             break;
         case RTC::DataPortStatus::SEND_TIMEOUT:
+        case RTC::DataPortStatus::BUFFER_TIMEOUT:
             ret = BUF_TIMEOUT;
+            if (!is_stalled(myOutPort)) // retries of write_OutPort_flow() count once
+            {
+                m_outport_timeout++;
+            }
             break;
         case RTC::DataPortStatus::SEND_FULL:
+        case RTC::DataPortStatus::BUFFER_FULL:
             ret = BUF_NOBUF;
             break;
         case RTC::DataPortStatus::PORT_ERROR:
@@ -435,8 +1096,6 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
             /*** Could never happen in this case ***/
         case RTC::DataPortStatus::BUFFER_EMPTY:
         case RTC::DataPortStatus::RECV_TIMEOUT:
-        case RTC::DataPortStatus::BUFFER_TIMEOUT:
-        case RTC::DataPortStatus::BUFFER_FULL:
         case RTC::DataPortStatus::RECV_EMPTY:
         case RTC::DataPortStatus::BUFFER_ERROR:
         case RTC::DataPortStatus::INVALID_ARGS:
@@ -451,12 +1110,13 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
 
     /**
          * Convert InPort RTC::DataPortStatus to DAQMW::BufferStatus
-         * We use RTC::RingBuffer with the following condition:
-         *   buffer.write.full_policy: block with timeout
-         *   buffer.read.empty_policy: block with timeout
+         * See check_outPort_status() for the buffer policies.
          * InPort::read returns:
          *   PORT_OK, BUFFER_EMPTY, BUFFER_TIMEOUT, PORT_ERROR, PRECONDITION_NOT_MET
-         * In this case, we get a DataPortStatus such as PORT_OK, BUFFER_TIMEOUT.
+         * An empty buffer gives BUFFER_TIMEOUT with block policy and
+         * BUFFER_EMPTY with do_nothing policy.  readback policy is not
+         * accepted by DaqOperator: it returns the last data again, which
+         * breaks the sequence number check.
          */
     BufferStatus check_inPort_status(RTC::InPort<RTC::TimedOctetSeq> &myInPort)
     {
@@ -476,6 +1136,7 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
             break;
         case RTC::DataPortStatus::BUFFER_TIMEOUT:
             ret = BUF_TIMEOUT;
+            m_inport_timeout++;
             break;
         case RTC::DataPortStatus::BUFFER_EMPTY:
             ret = BUF_NODATA;
@@ -537,6 +1198,8 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
 
         if (m_command != CMD_NOP)
         {                                  // got other command
+            struct timespec trans_start;
+            clock_gettime(CLOCK_MONOTONIC, &trans_start);
             status = set_state(m_command); // set next state
 
             if (status)
@@ -552,7 +1215,7 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
                     {
                         try
                         {
-                            doAction(m_state_prev); // daq_base_XX{}
+                            doAction(m_state_machine.prev_state()); // daq_base_XX{}
                         }
                         catch (DaqCompDefinedException &e)
                         {
@@ -607,18 +1270,19 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
                     cerr << "### got unknown exception at transition\n";
                 }
                 set_status(COMP_WORKING);
+                record_transition_timing(m_command, trans_start);
             }
             else
             {
                 cerr << "daq_do: transAction call: illegal command"
                      << '\n';
+                m_daq_service0.setRejected();
             }
             set_done();
 
             if (m_time)
             {
-                get_time_inline(m_command);
-                get_time_output(m_command);
+                record_command_timing(m_command);
             }
         }
         else
@@ -628,7 +1292,7 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
             {
                 try
                 {
-                    doAction(m_state);
+                    doAction(m_state_machine.state());
                 }
                 catch (DaqCompDefinedException &e)
                 {
@@ -679,11 +1343,251 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
         return 0;
     }
 
+    /**
+         *  Transition timing (see TimingRecorder.h).
+         *  Records are written by a background thread to path, by default
+         *  /tmp/daqmw/timing.<component name>.csv.  The file is opened at
+         *  the first command, so set_comp_name() may come later.
+         */
+    int set_time_on(const string &path = "",
+                    TimingRecorder::Format format = TimingRecorder::CSV)
+    {
+        m_time = true;
+        m_timing_path = path;
+        m_timing_format = format;
+        return 0;
+    }
+
+    int set_time_off()
+    {
+        m_time = false;
+        m_timing.close();
+        return 0;
+    }
+
+    /// Record a user defined timestamp (kind >= TIMING_USER) while
+    /// timing is on.  Cheap enough for daq_run().
+    bool record_timing(unsigned int kind, int arg = 0, long long value = 0)
+    {
+        return m_timing.record(kind, arg, value);
+    }
+
+    /**
+         *  Event driven mode (opt-in).
+         *  In LOADED, CONFIGURED and PAUSED state and after a fatal error,
+         *  the component thread blocks until the DAQService servant
+         *  receives a command instead of polling it every
+         *  DAQ_IDLE_TIME_USEC.  The wait is bounded by
+         *  DAQ_EVENT_WAIT_MAX_USEC so that daq_dummy(), status report and
+         *  heart beat keep running while idle.
+         *  Call it in the constructor of the component.
+         */
+    int set_event_driven_on()
+    {
+        m_event_driven = true;
+        return 0;
+    }
+
+    int set_event_driven_off()
+    {
+        m_event_driven = false;
+        return 0;
+    }
+
+    /**
+         *  Integrity mode (opt-in).
+         *  A CRC32C of the event data is embedded in every frame and
+         *  verified by check_header_footer() (see set_frame_crc()).
+         *  Also selectable per component by the config param
+         *  integrity (crc32c or none).
+         */
+    int set_integrity_on()
+    {
+        m_integrity = true;
+        return 0;
+    }
+
+    int set_integrity_off()
+    {
+        m_integrity = false;
+        return 0;
+    }
+
+    bool is_integrity_on() const
+    {
+        return m_integrity;
+    }
+
+    /**
+         *  Sequence check of check_header_footer().  Strict (default): a
+         *  footer sequence number other than the local one is fatal
+         *  (FOOTER_DATA_MISMATCH).  Tolerant: for consumers that may miss
+         *  frames by design (e.g. a monitor behind BestEffortDispatcher),
+         *  the local sequence number follows the received one and the
+         *  gaps are counted (seq_gap, seq_gap_frames, seq_gap_max in the
+         *  metrics).  Also selectable by the config param sequenceCheck
+         *  (strict or tolerant).
+         */
+    int set_sequence_check_tolerant()
+    {
+        m_seq_tolerant = true;
+        return 0;
+    }
+
+    int set_sequence_check_strict()
+    {
+        m_seq_tolerant = false;
+        return 0;
+    }
+
+    /**
+         *  Publish hot path metrics to the DAQService servant.  Called every
+         *  status cycle and at stop.  The counters themselves are plain
+         *  members updated only by the component thread.
+         */
+    int set_metrics()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsed = (now.tv_sec - m_metrics_time.tv_sec)
+                         + (now.tv_nsec - m_metrics_time.tv_nsec) * 1.0e-9;
+
+        unique_ptr<Metrics> mymetrics(new Metrics);
+        mymetrics->comp_name = CORBA::string_dup(m_comp_name.c_str());
+        mymetrics->state = m_state_machine.state();
+        mymetrics->event_num = m_totalEventNum;
+        mymetrics->byte_size = m_totalDataSize;
+        mymetrics->event_rate = 0.0;
+        mymetrics->byte_rate = 0.0;
+        if (elapsed > 0.0)
+        {
+            mymetrics->event_rate = (m_totalEventNum - m_metrics_event_num) / elapsed;
+            mymetrics->byte_rate = (m_totalDataSize - m_metrics_byte_size) / elapsed;
+        }
+        mymetrics->run_count = m_run_count;
+        for (int i = 0; i < RUN_HIST_SIZE; i++)
+        {
+            mymetrics->run_hist[i] = m_run_hist[i];
+        }
+        mymetrics->inport_timeout = m_inport_timeout;
+        mymetrics->outport_timeout = m_outport_timeout;
+        mymetrics->seq_gap = m_seq_gap;
+        mymetrics->seq_gap_frames = m_seq_gap_frames;
+        mymetrics->seq_gap_max = m_seq_gap_max;
+        mymetrics->stall_count = m_stall_count;
+        mymetrics->stall_usec = m_stall_usec;
+        mymetrics->drop_count = m_drop_count;
+        set_port_buffer_metrics(mymetrics->port_buffer);
+        mymetrics->output_drops.length(m_throttles.size());
+        for (unsigned int i = 0; i < m_throttles.size(); i++)
+        {
+            OutputThrottle *t = m_throttles[i].second;
+            OutputDrops &d = mymetrics->output_drops[i];
+            d.port_name = CORBA::string_dup(m_throttles[i].first.c_str());
+            d.sent = t->get_sent();
+            d.prescale_drop = t->get_prescale_drop();
+            d.rate_drop = t->get_rate_drop();
+            d.latest_drop = t->get_latest_drop();
+            d.full_drop = t->get_full_drop();
+        }
+        mymetrics->incomplete_events = 0;
+        mymetrics->late_fragments = 0;
+        if (m_merger)
+        {
+            mymetrics->incomplete_events = m_merger->get_incomplete();
+            mymetrics->late_fragments = m_merger->get_late();
+        }
+        mymetrics->compress_ratio = 0.0;
+        mymetrics->codec_byte_rate = 0.0;
+        if (m_codec_out_bytes > 0)
+        {
+            mymetrics->compress_ratio = (double)m_codec_in_bytes / m_codec_out_bytes;
+        }
+        if (m_codec_usec > 0)
+        {
+            mymetrics->codec_byte_rate = m_codec_in_bytes * 1.0e6 / m_codec_usec;
+        }
+
+        m_daq_service0.setMetrics(*mymetrics);
+
+        m_metrics_time = now;
+        m_metrics_event_num = m_totalEventNum;
+        m_metrics_byte_size = m_totalDataSize;
+        return 0;
+    }
+
+    /// live occupancy of the connector buffers of all the data ports
+    void set_port_buffer_metrics(PortBufferList &port_buffer)
+    {
+        CORBA::ULong n = 0;
+        port_buffer.length(0);
+        for (unsigned int i = 0; i < m_inports.size(); i++)
+        {
+            const std::vector<RTC::InPortConnector *> &conns = m_inports[i]->connectors();
+            for (unsigned int j = 0; j < conns.size(); j++)
+            {
+                add_port_buffer(port_buffer, n, m_inports[i]->getName(),
+                                conns[j]->getBuffer());
+            }
+        }
+        for (unsigned int i = 0; i < m_outports.size(); i++)
+        {
+            const std::vector<RTC::OutPortConnector *> &conns = m_outports[i]->connectors();
+            for (unsigned int j = 0; j < conns.size(); j++)
+            {
+                add_port_buffer(port_buffer, n, m_outports[i]->getName(),
+                                conns[j]->getBuffer());
+            }
+        }
+    }
+
+    void add_port_buffer(PortBufferList &port_buffer, CORBA::ULong &n,
+                         const char *port_name, RTC::CdrBufferBase *buffer)
+    {
+        if (buffer == 0)
+        {
+            return;
+        }
+        port_buffer.length(n + 1);
+        port_buffer[n].port_name = CORBA::string_dup(port_name);
+        port_buffer[n].readable = buffer->readable();
+        port_buffer[n].length = buffer->length();
+        n++;
+    }
+
+    int reset_metrics()
+    {
+        m_run_count = 0;
+        for (int i = 0; i < RUN_HIST_SIZE; i++)
+        {
+            m_run_hist[i] = 0;
+        }
+        m_inport_timeout = 0;
+        m_outport_timeout = 0;
+        m_seq_gap = 0;
+        m_seq_gap_frames = 0;
+        m_seq_gap_max = 0;
+        m_stall_count = 0;
+        m_stall_usec = 0;
+        m_drop_count = 0;
+        m_codec_in_bytes = 0;
+        m_codec_out_bytes = 0;
+        m_codec_usec = 0;
+        for (unsigned int i = 0; i < m_throttles.size(); i++)
+        {
+            m_throttles[i].second->reset_counters();
+        }
+        m_metrics_event_num = m_totalEventNum;
+        m_metrics_byte_size = m_totalDataSize;
+        clock_gettime(CLOCK_MONOTONIC, &m_metrics_time);
+        return 0;
+    }
+
     int set_status(CompStatus comp_status)
     {
         unique_ptr<Status> mystatus(new Status);
         mystatus->comp_name = CORBA::string_dup(m_comp_name.c_str());
-        mystatus->state = m_state;
+        mystatus->state = m_state_machine.state();
         ///mystatus->event_num = m_totalEventNum;
         mystatus->event_size = m_totalDataSize;
         mystatus->comp_status = comp_status;
@@ -695,8 +1599,8 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
 
   private:
     static constexpr int DAQ_CMD_SIZE = 12;
-    static constexpr int DAQ_STATE_SIZE = 6;
     static constexpr int DAQ_IDLE_TIME_USEC = 10000; // 10 m sec
+    static constexpr int DAQ_EVENT_WAIT_MAX_USEC = 500000; // 500 m sec
     static constexpr int STATUS_CYCLE_SEC = 3;       // default = 3
     static constexpr int CHECK_HB_CYCLE_SEC = 4;     // default = 3
     // static const int DAQ_HB_SIZE            =  5;
@@ -717,8 +1621,7 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
     unique_ptr<Timer> hb_timer{new Timer(CHECK_HB_CYCLE_SEC)};
 
     DAQCommand m_command;
-    DAQLifeCycleState m_state;
-    DAQLifeCycleState m_state_prev;
+    DaqStateMachine m_state_machine; // changed by set_state() only
 
     string m_err_message;
 
@@ -728,38 +1631,238 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
 
     bool m_debug;
     bool m_time;
-
-    typedef int (DAQMW::DaqComponentBase::*DAQFunc)();
-
-    DAQFunc m_daq_trans_func[DAQ_CMD_SIZE];
-    DAQFunc m_daq_do_func[DAQ_STATE_SIZE];
-    // DAQFunc m_daq_hb_func[DAQ_HB_SIZE];
-
+    bool m_event_driven;
+    bool m_integrity;
+    bool m_seq_tolerant;
+
+    DaqWorkerPool m_workers;
+    unsigned int m_worker_num;
+    unsigned int m_worker_window;
+    DaqWorkerPool::WorkFunc m_worker_func;
+    std::vector<unsigned char> m_worker_out;
+
+    unsigned int m_drain_max_events;
+    unsigned int m_drain_max_bytes;
+    unsigned int m_drain_max_usec;
+
+    Backpressure m_backpressure;
+    long long m_backpressure_wait_usec;
+    // OutPorts whose frame write_OutPort_flow() could not send yet
+    std::vector<const RTC::OutPort<RTC::TimedOctetSeq> *> m_stalled_ports;
+    unsigned long long m_out_seq_skip; // frames dropped, not numbered in footers
+
+    TimingRecorder m_timing;
+    string m_timing_path;
+    TimingRecorder::Format m_timing_format;
+
+    // hot path metrics (component thread only, see set_metrics())
+    unsigned long long m_run_count;
+    unsigned long long m_run_hist[RUN_HIST_SIZE];
+    unsigned long long m_inport_timeout;
+    unsigned long long m_outport_timeout;
+    unsigned long long m_seq_gap;
+    unsigned long long m_seq_gap_frames;
+    unsigned long long m_seq_gap_max;
+    unsigned long long m_stall_count;
+    unsigned long long m_stall_usec;
+    unsigned long long m_drop_count;
+    std::vector<std::pair<string, OutputThrottle *> > m_throttles;
+    EventMerger *m_merger;
+    unsigned long long m_codec_in_bytes;
+    unsigned long long m_codec_out_bytes;
+    unsigned long long m_codec_usec;
+    unsigned long long m_metrics_event_num;
+    unsigned long long m_metrics_byte_size;
+    struct timespec m_metrics_time;
+
+    long long m_trans_usec[DAQ_CMD_SIZE];
+
+    /// only commands of DAQ_TRANSITION_TABLE reach here (see set_state())
     int transAction(int command)
     {
-        return (this->*m_daq_trans_func[command])();
+        switch (command)
+        {
+        case CMD_CONFIGURE:
+            return daq_base_configure();
+        case CMD_START:
+            return daq_base_start();
+        case CMD_PAUSE:
+            return daq_pause();
+        case CMD_RESUME:
+            return daq_resume();
+        case CMD_STOP:
+            return daq_base_stop();
+        case CMD_UNCONFIGURE:
+            return daq_base_unconfigure();
+        default:
+            return 0;
+        }
     }
 
     void doAction(int state)
     {
-        (this->*m_daq_do_func[state])();
+        if (state == RUNNING)
+        {
+            daq_base_run();
+        }
+        else
+        {
+            daq_base_dummy();
+        }
     }
 
     int daq_base_dummy()
     {
         daq_dummy();
         set_status(COMP_WORKING);
-        usleep(DAQ_IDLE_TIME_USEC);
+        idle_wait();
         return 0;
     }
 
+    void idle_wait()
+    {
+        if (m_event_driven)
+        {
+            m_daq_service0.waitCommand(DAQ_EVENT_WAIT_MAX_USEC);
+        }
+        else
+        {
+            usleep(DAQ_IDLE_TIME_USEC);
+        }
+    }
+
+    int daq_base_run()
+    {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int ret = daq_run();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        unsigned long long usec = (end.tv_sec - start.tv_sec) * 1000000ULL
+                                  + (end.tv_nsec - start.tv_nsec) / 1000;
+        int bin = 0;
+        if (usec > 0)
+        {
+            bin = 64 - __builtin_clzll(usec);
+            if (bin >= RUN_HIST_SIZE)
+            {
+                bin = RUN_HIST_SIZE - 1;
+            }
+        }
+        m_run_hist[bin]++;
+        m_run_count++;
+        return ret;
+    }
+
     int daq_base_configure()
     {
         set_status(COMP_WORKING);
+        parse_base_params(m_daq_service0.getCompParams());
         daq_configure();
         return 0;
     }
 
+    /// params handled by the base class, the rest is left to daq_configure()
+    int parse_base_params(::NVList *list)
+    {
+        if (list == 0)
+        {
+            return 0;
+        }
+        int len = (*list).length();
+        for (int i = 0; i + 1 < len; i += 2)
+        {
+            string sname = (string)(*list)[i].value;
+            string svalue = (string)(*list)[i + 1].value;
+            if (sname == "integrity")
+            {
+                if (svalue == "crc32c")
+                {
+                    set_integrity_on();
+                }
+                else if (svalue == "none")
+                {
+                    set_integrity_off();
+                }
+                else
+                {
+                    cerr << "### ERROR: integrity: unknown value " << svalue
+                         << " (crc32c or none)" << '\n';
+                    fatal_error_report(FatalType::BAD_PARAMETER);
+                }
+            }
+            else if (sname == "sequenceCheck")
+            {
+                if (svalue == "strict")
+                {
+                    set_sequence_check_strict();
+                }
+                else if (svalue == "tolerant")
+                {
+                    set_sequence_check_tolerant();
+                }
+                else
+                {
+                    cerr << "### ERROR: sequenceCheck: unknown value " << svalue
+                         << " (strict or tolerant)" << '\n';
+                    fatal_error_report(FatalType::BAD_PARAMETER);
+                }
+            }
+            else if (sname == "backpressure")
+            {
+                if (svalue == "block")
+                {
+                    m_backpressure = BACKPRESSURE_BLOCK;
+                }
+                else if (svalue == "drop")
+                {
+                    m_backpressure = BACKPRESSURE_DROP;
+                }
+                else
+                {
+                    cerr << "### ERROR: backpressure: unknown value " << svalue
+                         << " (block or drop)" << '\n';
+                    fatal_error_report(FatalType::BAD_PARAMETER);
+                }
+            }
+            else if (sname == "backpressureWaitUsec")
+            {
+                int value = atoi(svalue.c_str());
+                if (value < 0)
+                {
+                    cerr << "### ERROR: " << sname << ": must be >= 0: " << svalue
+                         << '\n';
+                    fatal_error_report(FatalType::BAD_PARAMETER);
+                }
+                m_backpressure_wait_usec = value;
+            }
+            else if (sname == "drainEvents" || sname == "drainBytes"
+                     || sname == "drainUsec")
+            {
+                int value = atoi(svalue.c_str());
+                if (value < 0)
+                {
+                    cerr << "### ERROR: " << sname << ": must be >= 0: " << svalue
+                         << '\n';
+                    fatal_error_report(FatalType::BAD_PARAMETER);
+                }
+                if (sname == "drainEvents")
+                {
+                    m_drain_max_events = (value == 0) ? 1 : value;
+                }
+                else if (sname == "drainBytes")
+                {
+                    m_drain_max_bytes = value;
+                }
+                else
+                {
+                    m_drain_max_usec = value;
+                }
+            }
+        }
+        return 0;
+    }
+
     int daq_base_unconfigure()
     {
         m_totalDataSize = 0;
@@ -775,11 +1878,19 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
     int daq_base_start()
     {
         m_totalDataSize = 0;
+        m_totalEventNum = 0;
         m_loop = 0;
+        m_out_seq_skip = 0;
+        m_stalled_ports.clear();
+        reset_metrics();
         set_run_number();
         set_status(COMP_WORKING);
         m_has_printed_error_log = false;
         daq_start();
+        if (m_worker_num > 0)
+        {
+            m_workers.start(m_worker_num, m_worker_func, m_worker_window, m_loop);
+        }
         return 0;
     }
 
@@ -792,7 +1903,9 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
 
         m_err_message = "";
         set_status(COMP_WORKING);
+        m_workers.stop();
         daq_stop();
+        set_metrics();
 
         cerr << "event byte size = " << m_totalDataSize << '\n';
         return 0;
@@ -808,6 +1921,15 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
     int get_command()
     {
         m_command = m_daq_service0.getCommand();
+        if (m_time && m_command != CMD_NOP)
+        {
+            if (!m_timing.is_open())
+            {
+                open_timing();
+            }
+            m_timing.record(TIMING_CMD_PICKUP, m_command,
+                            m_daq_service0.getCommandElapsedUsec());
+        }
         if (m_debug)
         {
             cerr << "m_command=" << m_command << '\n';
@@ -824,123 +1946,59 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
         }
         return 0;
     }
-    int get_time_inline(int command)
-    {
-        constexpr char fname_inline[] = "s4i-file-inline";
-
-        TimeVal st;
-        struct timeval end_time;
-        struct timezone tz;
-        long result;
-
-        struct passwd *pw;
-        uid_t uid;
-
-        char date[128];
-        char fname[128];
 
-        // end time
-        gettimeofday(&end_time, &tz);
-
-        // start time
-        st = m_daq_service0.getTime();
-
-        // calc
-        result = (end_time.tv_sec - st.sec) * 1000000 + (end_time.tv_usec - st.usec);
-
-        if (result < 0)
+    int open_timing()
+    {
+        string path = m_timing_path;
+        if (path.empty())
         {
-            result = (st.sec - end_time.tv_sec) * 1000000 + (st.usec - end_time.tv_usec);
+            path = "/tmp/daqmw/timing." + m_comp_name;
+            path += (m_timing_format == TimingRecorder::BINARY) ? ".dat" : ".csv";
         }
-
-        uid = getuid();
-        if ((pw = getpwuid(uid)))
+        if (!m_timing.open(path, m_timing_format))
         {
-            sprintf(date, "/home/%s/DAQ-Middleware/csv/s4i/%s", pw->pw_name, fname_inline);
+            cerr << "### ERROR: " << m_comp_name << ": timing records disabled, "
+                 << "cannot write " << path << '\n';
+            m_time = false;
         }
-        sprintf(fname, "%s.csv", date);
-        ofstream csv_file(fname, ios::app);
+        return 0;
+    }
 
-        switch (command)
+    /**
+         *  Called after set_done().  Latency from the operator is measured
+         *  against the TimeVal sent by DaqOperator::set_time(), which is
+         *  wall clock time because the operator may run on another host.
+         */
+    int record_transition_timing(DAQCommand command, const struct timespec &start)
+    {
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        long long usec = (end.tv_sec - start.tv_sec) * 1000000LL
+                         + (end.tv_nsec - start.tv_nsec) / 1000;
+        m_trans_usec[command] = usec;
+        m_timing.record(TIMING_CMD_TRANSITION, command, usec);
+        if (m_debug)
         {
-        case CMD_CONFIGURE:
-            csv_file << "Configure," << result << '\n';
-            break;
-        case CMD_START:
-            csv_file << "Start," << result << '\n';
-            break;
-        case CMD_STOP:
-            csv_file << "Stop," << result << '\n';
-            break;
-        case CMD_UNCONFIGURE:
-            csv_file << "Unconfigure," << result << '\n';
-            break;
-        case CMD_PAUSE:
-            csv_file << "Pause," << result << '\n';
-            break;
-        case CMD_RESUME:
-            csv_file << "Resume," << result << '\n';
-            break;
-        case CMD_RESTART:
-            csv_file << "Restart," << result << '\n';
-            break;
+            cerr << "transition " << m_state_machine.prev_state()
+                 << " -> " << m_state_machine.state()
+                 << ": " << usec << " usec" << '\n';
         }
-        csv_file.close();
-
         return 0;
     }
-    int get_time_output(int command)
-    {
-        string fname_output = "s4i-output";
-
-        struct timeval end_time;
-        struct timezone tz;
-
-        struct passwd *pw;
-        uid_t uid;
-
-        char date[128];
-        char fname[128];
-
-        long gt[2];
 
-        /* end time */
-        gettimeofday(&end_time, &tz);
-        gt[0] = end_time.tv_sec;
-        gt[1] = end_time.tv_usec;
+    int record_command_timing(int command)
+    {
+        m_timing.record(TIMING_CMD_DONE, command);
 
-        uid = getuid();
-        if ((pw = getpwuid(uid)))
+        TimeVal st = m_daq_service0.getTime();
+        if (st.sec != 0 || st.usec != 0)
         {
-            sprintf(date, "/home/%s/DAQ-Middleware/csv/s4i/%s", pw->pw_name, fname_output.c_str());
+            struct timeval end_time;
+            gettimeofday(&end_time, 0);
+            long long result = (end_time.tv_sec - st.sec) * 1000000LL
+                               + (end_time.tv_usec - st.usec);
+            m_timing.record(TIMING_CMD_LATENCY, command, result);
         }
-        sprintf(fname, "%s.csv", date);
-        ofstream csv_file(fname, ios::app);
-        switch (command)
-        {
-        case CMD_CONFIGURE:
-            csv_file << "et,Configure," << gt[0] << ',' << gt[1] << '\n';
-            break;
-        case CMD_START:
-            csv_file << "et,Start," << gt[0] << ',' << gt[1] << '\n';
-            break;
-        case CMD_STOP:
-            csv_file << "et,Stop," << gt[0] << ',' << gt[1] << '\n';
-            break;
-        case CMD_UNCONFIGURE:
-            csv_file << "et,Unconfigure," << gt[0] << ',' << gt[1] << '\n';
-            break;
-        case CMD_PAUSE:
-            csv_file << "et,Pause," << gt[0] << ',' << gt[1] << '\n';
-            break;
-        case CMD_RESUME:
-            csv_file << "et,Resume," << gt[0] << ',' << gt[1] << '\n';
-            break;
-        case CMD_RESTART:
-            csv_file << "et,Restart," << gt[0] << ',' << gt[1] << '\n';
-            break;
-        }
-        csv_file.close();
         return 0;
     }
 
@@ -966,7 +2024,7 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
             set_status(COMP_FATAL);
             m_has_printed_error_log = true;
         }
-        usleep(DAQ_IDLE_TIME_USEC);
+        idle_wait();
         return 0;
     }
 
@@ -985,6 +2043,7 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
         {
             m_isTimerAlarm = true;
             set_status(COMP_WORKING);
+            set_metrics();
             status_timer->resetTimer();
         }
         return 0;
@@ -992,42 +2051,19 @@ class DaqComponentBase : public RTC::DataFlowComponentBase
 
     bool set_state(DAQCommand command)
     {
-        bool ret = true;
         /// new command has come, chage new state
-        switch (command)
+        const DaqTransition *t = m_state_machine.fire(command);
+        if (t == 0)
+        {
+            cerr << "### ERROR: command " << command << " is illegal in state "
+                 << m_state_machine.state() << '\n';
+            return false;
+        }
+        if (t->trans_lock)
         {
-        case CMD_CONFIGURE:
-            m_state_prev = LOADED;
-            m_state = CONFIGURED;
-            break;
-        case CMD_START:
-            m_state_prev = CONFIGURED;
-            m_state = RUNNING;
-            break;
-        case CMD_PAUSE:
-            m_state_prev = RUNNING;
-            m_state = PAUSED;
-            set_trans_lock();
-            break;
-        case CMD_RESUME:
-            m_state_prev = PAUSED;
-            m_state = RUNNING;
-            break;
-        case CMD_STOP:
-            m_state_prev = RUNNING;
-            m_state = CONFIGURED;
             set_trans_lock();
-            break;
-        case CMD_UNCONFIGURE:
-            m_state_prev = RUNNING;
-            m_state = LOADED;
-            break;
-        default:
-            //status = false;
-            ret = false;
-            break;
         }
-        return ret;
+        return true;
     }
 }; /// class
 } // namespace DAQMW
@@ -0,0 +1,170 @@
+// -*- C++ -*-
+/*!
+ * @file DaqStateMachine.h
+ * @brief Transition table of the DAQ lifecycle
+ *
+ */
+
+#ifndef DAQSTATEMACHINE_H
+#define DAQSTATEMACHINE_H
+
+#include "DAQService.hh"
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/**
+ *  One legal transition of the DAQ lifecycle.
+ *  trans_lock: the command waits for daq_run() of the from state to
+ *  release the transition lock (set_trans_unlock()) before the
+ *  transition action is called.
+ *
+ *               CONFIGURE          START
+ *      LOADED  ----------> CONFIGURED -----> RUNNING <--> PAUSED
+ *              <----------            <-----      PAUSE/RESUME
+ *               UNCONFIGURE            STOP
+ */
+struct DaqTransition
+{
+    DAQCommand command;
+    DAQLifeCycleState from;
+    DAQLifeCycleState to;
+    bool trans_lock;
+};
+
+static constexpr DaqTransition DAQ_TRANSITION_TABLE[] = {
+    {CMD_CONFIGURE,   LOADED,     CONFIGURED, false},
+    {CMD_START,       CONFIGURED, RUNNING,    false},
+    {CMD_STOP,        RUNNING,    CONFIGURED, true},
+    {CMD_UNCONFIGURE, CONFIGURED, LOADED,     false},
+    {CMD_PAUSE,       RUNNING,    PAUSED,     true},
+    {CMD_RESUME,      PAUSED,     RUNNING,    false},
+};
+
+static constexpr int DAQ_TRANSITION_NUM =
+    sizeof(DAQ_TRANSITION_TABLE) / sizeof(DAQ_TRANSITION_TABLE[0]);
+
+/// index of the transition in DAQ_TRANSITION_TABLE, -1 if illegal
+constexpr int daq_find_transition(DAQLifeCycleState from, DAQCommand command)
+{
+    for (int i = 0; i < DAQ_TRANSITION_NUM; i++)
+    {
+        if (DAQ_TRANSITION_TABLE[i].from == from
+            && DAQ_TRANSITION_TABLE[i].command == command)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+constexpr bool daq_is_legal_transition(DAQLifeCycleState from, DAQCommand command)
+{
+    return daq_find_transition(from, command) >= 0;
+}
+
+/**
+ *  Sanity of the table itself:
+ *  - at most one transition for a state and a command
+ *  - a transition changes the state
+ *  - only RUNNING has a daq_run() that can release the transition lock
+ */
+constexpr bool daq_transition_table_is_valid()
+{
+    for (int i = 0; i < DAQ_TRANSITION_NUM; i++)
+    {
+        const DaqTransition &t = DAQ_TRANSITION_TABLE[i];
+        if (daq_find_transition(t.from, t.command) != i)
+        {
+            return false;
+        }
+        if (t.from == t.to)
+        {
+            return false;
+        }
+        if (t.trans_lock && t.from != RUNNING)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(daq_transition_table_is_valid(), "DAQ_TRANSITION_TABLE is inconsistent");
+
+/**
+ *  Compile time lookup.  An illegal pair does not compile:
+ *
+ *    static_assert(DaqTransitionOf<RUNNING, CMD_STOP>::to == CONFIGURED, "");
+ *    DaqTransitionOf<LOADED, CMD_START>::to;  // error: illegal transition
+ */
+template <DAQLifeCycleState From, DAQCommand Command>
+struct DaqTransitionOf
+{
+    static_assert(daq_is_legal_transition(From, Command),
+                  "illegal DAQ lifecycle transition");
+    static constexpr int index = daq_find_transition(From, Command);
+    static constexpr DAQLifeCycleState to = DAQ_TRANSITION_TABLE[index < 0 ? 0 : index].to;
+    static constexpr bool trans_lock = DAQ_TRANSITION_TABLE[index < 0 ? 0 : index].trans_lock;
+};
+
+/// run time lookup, 0 if illegal
+inline const DaqTransition *daq_transition(DAQLifeCycleState from, DAQCommand command)
+{
+    int i = daq_find_transition(from, command);
+    return i < 0 ? 0 : &DAQ_TRANSITION_TABLE[i];
+}
+
+/*!
+ * @class DaqStateMachine
+ * @brief current and previous lifecycle state driven by commands
+ *
+ * An illegal command leaves the states unchanged.
+ */
+class DaqStateMachine
+{
+  public:
+    DaqStateMachine()
+        : m_state(LOADED), m_state_prev(LOADED)
+    {
+    }
+
+    /// the transition taken, 0 if the command is illegal in the current state
+    const DaqTransition *fire(DAQCommand command)
+    {
+        const DaqTransition *t = daq_transition(m_state, command);
+        if (t)
+        {
+            m_state_prev = t->from;
+            m_state = t->to;
+        }
+        return t;
+    }
+
+    DAQLifeCycleState state() const
+    {
+        return m_state;
+    }
+
+    DAQLifeCycleState prev_state() const
+    {
+        return m_state_prev;
+    }
+
+    void reset()
+    {
+        m_state = LOADED;
+        m_state_prev = LOADED;
+    }
+
+  private:
+    DAQLifeCycleState m_state;
+    DAQLifeCycleState m_state_prev;
+};
+
+} // namespace DAQMW
+
+#endif // DAQSTATEMACHINE_H
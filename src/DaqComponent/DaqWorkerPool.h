@@ -0,0 +1,254 @@
+// -*- C++ -*-
+/*!
+ * @file DaqWorkerPool.h
+ * @brief Worker threads for daq_run() with ordered output
+ *
+ */
+
+#ifndef DAQWORKERPOOL_H
+#define DAQWORKERPOOL_H
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/*!
+ * @class DaqWorkerPool
+ * @brief runs a work function on N threads and returns results in order
+ *
+ * The component thread submits the event data of each received frame;
+ * the pool numbers the frames in submission order starting at first_seq.
+ * Worker threads run the work function on the frames in any order;
+ * collect() hands the results back strictly in that order (reorder
+ * buffer), so the output stream is the same as with one thread.
+ *
+ *   pool.start(4, work_func, 0);
+ *   pool.submit(payload, payload_byte_size);       // false: window full
+ *   if (pool.collect(out, &seq, &ret)) { ... }     // false: not ready
+ *   pool.stop();
+ *
+ * The work function writes its result into out (resized as needed) and
+ * returns the result byte size (at most out.size()), or a negative value
+ * on error.  It is called from worker threads and must not touch
+ * component members without its own locking.
+ * At most window frames are in flight.  Buffers are kept in the slots
+ * and reused, so the steady state does not allocate.
+ */
+class DaqWorkerPool
+{
+  public:
+    typedef std::function<int(const unsigned char *in, unsigned int in_byte_size,
+                              std::vector<unsigned char> &out)> WorkFunc;
+
+    DaqWorkerPool()
+        : m_running(false), m_next_submit(0), m_next_collect(0)
+    {
+    }
+
+    virtual ~DaqWorkerPool()
+    {
+        stop();
+    }
+
+    /// window 0: 4 frames per worker
+    int start(unsigned int worker_num, WorkFunc func, unsigned int window,
+              unsigned long long first_seq = 0)
+    {
+        stop();
+        if (worker_num == 0)
+        {
+            return -1;
+        }
+        if (window == 0)
+        {
+            window = worker_num * WINDOW_PER_WORKER;
+        }
+        m_func = func;
+        m_slots.resize(window);
+        for (unsigned int i = 0; i < m_slots.size(); i++)
+        {
+            m_slots[i].state = SLOT_FREE;
+        }
+        m_queue.clear();
+        m_next_submit = first_seq;
+        m_next_collect = first_seq;
+        m_running = true;
+        for (unsigned int i = 0; i < worker_num; i++)
+        {
+            m_threads.push_back(std::thread(&DaqWorkerPool::work_loop, this));
+        }
+        return 0;
+    }
+
+    /// Frames still in flight are discarded.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running)
+            {
+                return;
+            }
+            m_running = false;
+        }
+        m_cond.notify_all();
+        for (unsigned int i = 0; i < m_threads.size(); i++)
+        {
+            m_threads[i].join();
+        }
+        m_threads.clear();
+    }
+
+    bool is_running() const
+    {
+        return !m_threads.empty();
+    }
+
+    unsigned int worker_num() const
+    {
+        return m_threads.size();
+    }
+
+    /**
+         *  Queue the event data of the next frame.  Returns false if the
+         *  window is full; submit the same frame again later.
+         */
+    bool submit(const unsigned char *data, unsigned int byte_size)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        unsigned long long seq = m_next_submit;
+        unsigned int idx = seq % m_slots.size();
+        Slot &slot = m_slots[idx];
+        if (slot.state != SLOT_FREE)
+        {
+            return false;
+        }
+        lock.unlock();
+        // the slot is free, no worker touches it
+        slot.in.resize(byte_size);
+        if (byte_size > 0)
+        {
+            memcpy(&slot.in[0], data, byte_size);
+        }
+        slot.seq = seq;
+        lock.lock();
+        slot.state = SLOT_QUEUED;
+        m_queue.push_back(idx);
+        m_next_submit++;
+        lock.unlock();
+        m_cond.notify_one();
+        return true;
+    }
+
+    /**
+         *  Take the result of the oldest frame if it is done.
+         *  out is swapped with the slot buffer.  ret is the return value
+         *  of the work function.
+         */
+    bool collect(std::vector<unsigned char> &out, unsigned long long *seq, int *ret)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_next_collect == m_next_submit)
+        {
+            return false;
+        }
+        Slot &slot = m_slots[m_next_collect % m_slots.size()];
+        if (slot.state != SLOT_DONE)
+        {
+            return false;
+        }
+        out.swap(slot.out);
+        *seq = slot.seq;
+        *ret = slot.ret;
+        slot.state = SLOT_FREE;
+        m_next_collect++;
+        return true;
+    }
+
+    /// number of frames submitted and not yet collected
+    unsigned int in_flight()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_next_submit - m_next_collect;
+    }
+
+    bool is_idle()
+    {
+        return in_flight() == 0;
+    }
+
+  private:
+    static const unsigned int WINDOW_PER_WORKER = 4;
+
+    enum SlotState
+    {
+        SLOT_FREE,
+        SLOT_QUEUED,
+        SLOT_DONE
+    };
+
+    struct Slot
+    {
+        std::vector<unsigned char> in;
+        std::vector<unsigned char> out;
+        unsigned long long seq;
+        int ret;
+        int state;
+    };
+
+    void work_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            while (m_running && m_queue.empty())
+            {
+                m_cond.wait(lock);
+            }
+            if (!m_running)
+            {
+                return;
+            }
+            unsigned int idx = m_queue.front();
+            m_queue.pop_front();
+            Slot &slot = m_slots[idx];
+            lock.unlock();
+            int ret = m_func(slot.in.empty() ? 0 : &slot.in[0], slot.in.size(), slot.out);
+            if (ret >= 0 && (unsigned int)ret > slot.out.size())
+            {
+                ret = -1;
+            }
+            else if (ret >= 0)
+            {
+                slot.out.resize(ret);
+            }
+            lock.lock();
+            slot.ret = ret;
+            slot.state = SLOT_DONE;
+        }
+    }
+
+    WorkFunc m_func;
+    std::vector<Slot> m_slots;
+    std::deque<unsigned int> m_queue;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_running;
+    unsigned long long m_next_submit;
+    unsigned long long m_next_collect;
+};
+
+} // namespace DAQMW
+
+#endif // DAQWORKERPOOL_H
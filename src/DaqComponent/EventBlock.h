@@ -0,0 +1,369 @@
+// -*- C++ -*-
+/*!
+ * @file EventBlock.h
+ * @brief Multi-event block format for data ports
+ *
+ */
+
+#ifndef EVENTBLOCK_H
+#define EVENTBLOCK_H
+
+#include <vector>
+#include <time.h>
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/**
+ *  An event block packs N events into the payload of one data port frame
+ *  so that one OutPort::write() carries many small events.
+ *
+ *  Header data(8bytes)
+ *  Event data1
+ *  ...
+ *  Event dataN
+ *  Index: size of event1 (4bytes) ... size of eventN (4bytes)
+ *  Event count N (4bytes)
+ *  Footer data(8bytes)
+ *
+ *  All index words are big endian like the header and footer.  The index
+ *  is placed after the events so that events can be written into the
+ *  OutPort buffer as they arrive.  Size in the header is the whole block
+ *  payload (events + index + count), so that a block is a valid frame for
+ *  check_header_footer().  The sequence number in the footer counts
+ *  blocks, not events.
+ */
+static const unsigned int EVENT_BLOCK_WORD_SIZE = 4;
+
+/**
+ *  Flush policy of the sender.  A block is flushed when one of the limits
+ *  is reached.  0 disables a limit.
+ *    max_events: number of events in a block
+ *    max_bytes:  byte size of events in a block (without index)
+ *    max_usec:   time since the first event of a block was added
+ */
+struct EventBlockPolicy
+{
+    unsigned int max_events;
+    unsigned int max_bytes;
+    unsigned int max_usec;
+};
+
+/*!
+ * @class EventBlockWriter
+ * @brief keeps event sizes and flush policy of the block being built
+ *
+ * The event data itself is written into the OutPort buffer by
+ * DaqComponentBase::reserve_block_event()/commit_block_event() or
+ * add_block_event(), and the block is closed by commit_block().
+ */
+class EventBlockWriter
+{
+  public:
+    EventBlockWriter()
+        : m_event_byte_size(0)
+    {
+        m_policy.max_events = 0;
+        m_policy.max_bytes = 0;
+        m_policy.max_usec = 0;
+        m_start.tv_sec = 0;
+        m_start.tv_nsec = 0;
+    }
+
+    virtual ~EventBlockWriter()
+    {
+    }
+
+    void set_policy(const EventBlockPolicy &policy)
+    {
+        m_policy = policy;
+        if (m_policy.max_events > 0)
+        {
+            m_sizes.reserve(m_policy.max_events);
+        }
+    }
+
+    const EventBlockPolicy &get_policy() const
+    {
+        return m_policy;
+    }
+
+    void reset()
+    {
+        m_sizes.clear();
+        m_event_byte_size = 0;
+    }
+
+    void add(unsigned int event_byte_size)
+    {
+        if (m_sizes.empty())
+        {
+            clock_gettime(CLOCK_MONOTONIC, &m_start);
+        }
+        m_sizes.push_back(event_byte_size);
+        m_event_byte_size += event_byte_size;
+    }
+
+    unsigned int event_num() const
+    {
+        return m_sizes.size();
+    }
+
+    /// byte size of events in the block (without index)
+    unsigned int event_byte_size() const
+    {
+        return m_event_byte_size;
+    }
+
+    /// byte size of index and event count
+    unsigned int index_byte_size() const
+    {
+        return (m_sizes.size() + 1) * EVENT_BLOCK_WORD_SIZE;
+    }
+
+    /// byte size of the whole block payload
+    unsigned int block_byte_size() const
+    {
+        return m_event_byte_size + index_byte_size();
+    }
+
+    /**
+     *  Payload byte size to reserve before adding an event of at most
+     *  max_event_byte_size: with max_bytes (and max_events) set, enough
+     *  for the rest of the block, which may pass max_bytes by one event,
+     *  so the OutPort buffer is sized once per block.
+     */
+    unsigned int reserve_byte_size(unsigned int max_event_byte_size) const
+    {
+        unsigned int events = m_event_byte_size + max_event_byte_size;
+        if (m_policy.max_bytes > 0 && m_policy.max_bytes + max_event_byte_size > events)
+        {
+            events = m_policy.max_bytes + max_event_byte_size;
+        }
+        unsigned int index_num = m_sizes.size() + 1;
+        if (m_policy.max_events > index_num)
+        {
+            index_num = m_policy.max_events;
+        }
+        return events + (index_num + 1) * EVENT_BLOCK_WORD_SIZE;
+    }
+
+    bool is_full() const
+    {
+        if (m_policy.max_events > 0 && m_sizes.size() >= m_policy.max_events)
+        {
+            return true;
+        }
+        if (m_policy.max_bytes > 0 && m_event_byte_size >= m_policy.max_bytes)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    bool is_expired() const
+    {
+        if (m_policy.max_usec == 0 || m_sizes.empty())
+        {
+            return false;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long elapsed_usec = (now.tv_sec - m_start.tv_sec) * 1000000LL
+                                 + (now.tv_nsec - m_start.tv_nsec) / 1000;
+        return elapsed_usec >= m_policy.max_usec;
+    }
+
+    /// true if the block has events and one of the policy limits is reached
+    bool flush_due() const
+    {
+        if (m_sizes.empty())
+        {
+            return false;
+        }
+        return is_full() || is_expired();
+    }
+
+    /// write index and event count (index_byte_size() bytes) to index
+    void write_index(unsigned char *index) const
+    {
+        unsigned int pos = 0;
+        for (unsigned int i = 0; i < m_sizes.size(); i++)
+        {
+            put_word(&index[pos], m_sizes[i]);
+            pos += EVENT_BLOCK_WORD_SIZE;
+        }
+        put_word(&index[pos], m_sizes.size());
+    }
+
+    static void put_word(unsigned char *p, unsigned int val)
+    {
+        p[0] = (val & 0xff000000) >> 24;
+        p[1] = (val & 0x00ff0000) >> 16;
+        p[2] = (val & 0x0000ff00) >> 8;
+        p[3] = (val & 0x000000ff);
+    }
+
+    static unsigned int get_word(const unsigned char *p)
+    {
+        return (p[0] << 24) + (p[1] << 16) + (p[2] << 8) + p[3];
+    }
+
+  private:
+    EventBlockPolicy m_policy;
+    std::vector<unsigned int> m_sizes;
+    unsigned int m_event_byte_size;
+    struct timespec m_start;
+};
+
+/*!
+ * @class EventBlockReader
+ * @brief iterates over events in a received block payload
+ *
+ *   EventBlockReader block(&m_in_data.data[HEADER_BYTE_SIZE],
+ *                          get_event_size(recv_byte_size));
+ *   for (EventBlockReader::iterator it = block.begin();
+ *        it != block.end(); ++it) {
+ *       analyze(it->data, it->size);
+ *   }
+ *
+ * The payload must have been validated by is_valid() (or by
+ * DaqComponentBase::check_block_header_footer()) before iterating.
+ */
+class EventBlockReader
+{
+  public:
+    struct Event
+    {
+        const unsigned char *data;
+        unsigned int size;
+    };
+
+    class iterator
+    {
+      public:
+        iterator(const unsigned char *data, const unsigned char *index,
+                 unsigned int pos)
+            : m_index(index), m_pos(pos)
+        {
+            m_event.data = data;
+            m_event.size = 0;
+            load();
+        }
+
+        const Event &operator*() const
+        {
+            return m_event;
+        }
+
+        const Event *operator->() const
+        {
+            return &m_event;
+        }
+
+        iterator &operator++()
+        {
+            m_event.data += m_event.size;
+            m_pos++;
+            load();
+            return *this;
+        }
+
+        bool operator==(const iterator &other) const
+        {
+            return m_pos == other.m_pos;
+        }
+
+        bool operator!=(const iterator &other) const
+        {
+            return m_pos != other.m_pos;
+        }
+
+      private:
+        void load()
+        {
+            if (m_index)
+            {
+                m_event.size =
+                    EventBlockWriter::get_word(&m_index[m_pos * EVENT_BLOCK_WORD_SIZE]);
+            }
+        }
+
+        const unsigned char *m_index;
+        unsigned int m_pos;
+        Event m_event;
+    };
+
+    EventBlockReader(const unsigned char *payload, unsigned int payload_byte_size)
+        : m_payload(payload), m_payload_byte_size(payload_byte_size),
+          m_index(0), m_event_num(0), m_valid(false)
+    {
+        parse();
+    }
+
+    virtual ~EventBlockReader()
+    {
+    }
+
+    /// true if event sizes in the index add up to the payload size
+    bool is_valid() const
+    {
+        return m_valid;
+    }
+
+    unsigned int event_num() const
+    {
+        return m_event_num;
+    }
+
+    iterator begin() const
+    {
+        return iterator(m_payload, m_valid ? m_index : 0, 0);
+    }
+
+    iterator end() const
+    {
+        return iterator(m_payload, 0, m_event_num);
+    }
+
+  private:
+    void parse()
+    {
+        if (m_payload_byte_size < EVENT_BLOCK_WORD_SIZE)
+        {
+            return;
+        }
+        unsigned int count_pos = m_payload_byte_size - EVENT_BLOCK_WORD_SIZE;
+        unsigned int event_num = EventBlockWriter::get_word(&m_payload[count_pos]);
+        if (event_num > count_pos / EVENT_BLOCK_WORD_SIZE)
+        {
+            return;
+        }
+        unsigned int index_pos = count_pos - event_num * EVENT_BLOCK_WORD_SIZE;
+        unsigned long long sum = 0;
+        for (unsigned int i = 0; i < event_num; i++)
+        {
+            sum += EventBlockWriter::get_word(&m_payload[index_pos + i * EVENT_BLOCK_WORD_SIZE]);
+        }
+        if (sum != index_pos)
+        {
+            return;
+        }
+        m_index = &m_payload[index_pos];
+        m_event_num = event_num;
+        m_valid = true;
+    }
+
+    const unsigned char *m_payload;
+    unsigned int m_payload_byte_size;
+    const unsigned char *m_index;
+    unsigned int m_event_num;
+    bool m_valid;
+};
+
+} // namespace DAQMW
+
+#endif // EVENTBLOCK_H
@@ -0,0 +1,380 @@
+// -*- C++ -*-
+/*!
+ * @file EventMerger.h
+ * @brief Merge event fragments of N inputs by event (trigger) number
+ *
+ */
+
+#ifndef EVENTMERGER_H
+#define EVENTMERGER_H
+
+#include <functional>
+#include <queue>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include <time.h>
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/*!
+ * @class EventMerger
+ * @brief builds events from one fragment per input, in event number order
+ *
+ * Each input (reader) sends one fragment per event.  Fragments are
+ * collected per event number; the event numbers of the events being
+ * built are kept in a min-heap, so the next event to send is always the
+ * one with the smallest number.  The smallest event is ready when it
+ * has a fragment of every input, or when timeout_usec passed since its
+ * first fragment arrived (incomplete event), or when more than
+ * max_pending events are being built.  Events are never sent out of
+ * order: a complete event waits behind an older incomplete one.
+ *
+ *   merger.init(input_num, timeout_usec);
+ *   merger.add(input, event_number, fragment, fragment_byte_size);
+ *   while (const EventMerger::Event *ev = merger.ready()) {
+ *       for (i = 0; i < input_num; i++) ev->fragment(i) ...
+ *       merger.pop();
+ *   }
+ *
+ * A fragment of an event already sent (late) or a second fragment of
+ * the same input (duplicate) is counted and dropped.  Fragment data is
+ * copied; event buffers are reused so that steady state does not
+ * allocate.
+ */
+class EventMerger
+{
+  public:
+    class Event
+    {
+      public:
+        uint64_t number() const
+        {
+            return m_number;
+        }
+
+        bool is_complete() const
+        {
+            return m_fragment_num == m_sizes.size();
+        }
+
+        /// number of inputs which sent a fragment
+        unsigned int fragment_num() const
+        {
+            return m_fragment_num;
+        }
+
+        bool has_fragment(unsigned int input) const
+        {
+            return m_present[input];
+        }
+
+        const unsigned char *fragment(unsigned int input) const
+        {
+            return m_data[input].data();
+        }
+
+        /// 0 if the input sent no fragment
+        unsigned int fragment_byte_size(unsigned int input) const
+        {
+            return m_sizes[input];
+        }
+
+        /// sum of the fragment byte sizes
+        unsigned int byte_size() const
+        {
+            return m_byte_size;
+        }
+
+      private:
+        friend class EventMerger;
+
+        void reset(unsigned int input_num)
+        {
+            m_data.resize(input_num);
+            m_sizes.assign(input_num, 0);
+            m_present.assign(input_num, false);
+            m_fragment_num = 0;
+            m_byte_size = 0;
+        }
+
+        uint64_t m_number;
+        struct timespec m_first;
+        unsigned int m_fragment_num;
+        unsigned int m_byte_size;
+        std::vector<std::vector<unsigned char> > m_data;
+        std::vector<unsigned int> m_sizes;
+        std::vector<bool> m_present;
+    };
+
+    static const unsigned int DEFAULT_MAX_PENDING = 4096;
+
+    enum AddStatus
+    {
+        ADD_OK = 0,
+        ADD_LATE = -1,      // event already sent
+        ADD_DUPLICATE = -2, // input already sent a fragment of the event
+        ADD_BAD_INPUT = -3
+    };
+
+    EventMerger()
+        : m_input_num(0), m_timeout_usec(0), m_max_pending(DEFAULT_MAX_PENDING),
+          m_sent_any(false), m_last_sent(0), m_extend_any(false), m_extend_ref(0)
+    {
+        reset_counters();
+    }
+
+    virtual ~EventMerger()
+    {
+        clear();
+        for (unsigned int i = 0; i < m_free.size(); i++)
+        {
+            delete m_free[i];
+        }
+    }
+
+    /// timeout_usec 0: wait for all fragments (max_pending still applies)
+    void init(unsigned int input_num, unsigned int timeout_usec,
+              unsigned int max_pending = DEFAULT_MAX_PENDING)
+    {
+        clear();
+        m_input_num = input_num;
+        m_timeout_usec = timeout_usec;
+        m_max_pending = (max_pending == 0) ? 1 : max_pending;
+        m_sent_any = false;
+        m_last_sent = 0;
+        m_extend_any = false;
+        m_extend_ref = 0;
+        reset_counters();
+    }
+
+    /**
+     *  Extend an event number of the given bit width (a 32-bit footer
+     *  sequence number, a trigger counter) which wraps around to 64 bits.
+     *  Serial number arithmetic against the largest number extended so
+     *  far: a number less than half the range ahead of it is later, one
+     *  behind it is earlier (a late fragment).  So numbers keep growing
+     *  across a wrap and add() does not take every fragment after the
+     *  wrap for a late one.  A number before the first one extended, by
+     *  more than the numbers seen, becomes 0.
+     */
+    uint64_t extend_number(uint64_t number, unsigned int bits)
+    {
+        if (bits >= 64)
+        {
+            return number;
+        }
+        uint64_t range = (uint64_t)1 << bits;
+        number &= range - 1;
+        if (!m_extend_any)
+        {
+            m_extend_any = true;
+            m_extend_ref = number;
+            return number;
+        }
+        uint64_t diff = (number - m_extend_ref) & (range - 1);
+        if (diff < range / 2)
+        {
+            m_extend_ref += diff;
+            return m_extend_ref;
+        }
+        uint64_t back = range - diff;
+        return (back > m_extend_ref) ? 0 : m_extend_ref - back;
+    }
+
+    int add(unsigned int input, uint64_t number,
+            const unsigned char *data, unsigned int byte_size)
+    {
+        if (input >= m_input_num)
+        {
+            return ADD_BAD_INPUT;
+        }
+        if (m_sent_any && number <= m_last_sent)
+        {
+            m_late++;
+            return ADD_LATE;
+        }
+
+        Event *ev;
+        std::unordered_map<uint64_t, Event *>::iterator it = m_events.find(number);
+        if (it == m_events.end())
+        {
+            ev = new_event();
+            ev->m_number = number;
+            clock_gettime(CLOCK_MONOTONIC, &ev->m_first);
+            m_events[number] = ev;
+            m_heap.push(number);
+        }
+        else
+        {
+            ev = it->second;
+        }
+        if (ev->m_present[input])
+        {
+            m_duplicate++;
+            return ADD_DUPLICATE;
+        }
+        ev->m_data[input].assign(data, data + byte_size);
+        ev->m_sizes[input] = byte_size;
+        ev->m_present[input] = true;
+        ev->m_fragment_num++;
+        ev->m_byte_size += byte_size;
+        return ADD_OK;
+    }
+
+    /// the smallest event if it is complete or timed out, else 0
+    const Event *ready()
+    {
+        if (m_heap.empty())
+        {
+            return 0;
+        }
+        Event *ev = m_events[m_heap.top()];
+        if (ev->is_complete() || m_heap.size() > m_max_pending || is_expired(ev))
+        {
+            return ev;
+        }
+        return 0;
+    }
+
+    /// the smallest event regardless of completeness (end of run), or 0
+    const Event *front()
+    {
+        if (m_heap.empty())
+        {
+            return 0;
+        }
+        return m_events[m_heap.top()];
+    }
+
+    /// the event of ready() or front() was sent
+    void pop()
+    {
+        if (m_heap.empty())
+        {
+            return;
+        }
+        uint64_t number = m_heap.top();
+        m_heap.pop();
+        std::unordered_map<uint64_t, Event *>::iterator it = m_events.find(number);
+        Event *ev = it->second;
+        m_events.erase(it);
+        if (ev->is_complete())
+        {
+            m_complete++;
+        }
+        else
+        {
+            m_incomplete++;
+        }
+        m_sent_any = true;
+        m_last_sent = number;
+        m_free.push_back(ev);
+    }
+
+    /// number of events being built
+    unsigned int pending() const
+    {
+        return m_heap.size();
+    }
+
+    unsigned int input_num() const
+    {
+        return m_input_num;
+    }
+
+    void reset_counters()
+    {
+        m_complete = 0;
+        m_incomplete = 0;
+        m_late = 0;
+        m_duplicate = 0;
+    }
+
+    unsigned long long get_complete() const
+    {
+        return m_complete;
+    }
+
+    unsigned long long get_incomplete() const
+    {
+        return m_incomplete;
+    }
+
+    unsigned long long get_late() const
+    {
+        return m_late;
+    }
+
+    unsigned long long get_duplicate() const
+    {
+        return m_duplicate;
+    }
+
+  private:
+    Event *new_event()
+    {
+        Event *ev;
+        if (m_free.empty())
+        {
+            ev = new Event;
+        }
+        else
+        {
+            ev = m_free.back();
+            m_free.pop_back();
+        }
+        ev->reset(m_input_num);
+        return ev;
+    }
+
+    bool is_expired(const Event *ev) const
+    {
+        if (m_timeout_usec == 0)
+        {
+            return false;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long elapsed_usec = (now.tv_sec - ev->m_first.tv_sec) * 1000000LL
+                                 + (now.tv_nsec - ev->m_first.tv_nsec) / 1000;
+        return elapsed_usec >= m_timeout_usec;
+    }
+
+    void clear()
+    {
+        std::unordered_map<uint64_t, Event *>::iterator it;
+        for (it = m_events.begin(); it != m_events.end(); ++it)
+        {
+            m_free.push_back(it->second);
+        }
+        m_events.clear();
+        m_heap = std::priority_queue<uint64_t, std::vector<uint64_t>,
+                                     std::greater<uint64_t> >();
+    }
+
+    unsigned int m_input_num;
+    unsigned int m_timeout_usec;
+    unsigned int m_max_pending;
+    bool m_sent_any;
+    uint64_t m_last_sent;
+    bool m_extend_any;
+    uint64_t m_extend_ref; // largest number returned by extend_number()
+
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t> > m_heap;
+    std::unordered_map<uint64_t, Event *> m_events;
+    std::vector<Event *> m_free;
+
+    unsigned long long m_complete;
+    unsigned long long m_incomplete;
+    unsigned long long m_late;
+    unsigned long long m_duplicate;
+};
+
+} // namespace DAQMW
+
+#endif // EVENTMERGER_H
@@ -0,0 +1,272 @@
+// -*- C++ -*-
+/*!
+ * @file EventScan.h
+ * @brief Batch validator for concatenated frames
+ *
+ */
+
+#ifndef EVENTSCAN_H
+#define EVENTSCAN_H
+
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/**
+ *  Scan a buffer of concatenated frames
+ *  (Header(8bytes) + Event data + Footer(8bytes), see DaqComponentBase.h)
+ *  such as the payload of a replayed data file, and validate all of them
+ *  in one call.
+ *
+ *    EventScanResult res;
+ *    std::vector<unsigned int> offsets;
+ *    scan_frames(buf, len, &offsets, true, 0, &res);
+ *    if (res.error != SCAN_OK) {
+ *        cerr << scan_error_string(res.error) << " at " << res.error_offset;
+ *    }
+ *
+ *  offsets receives the offset of each valid frame header.  Nothing is
+ *  printed; the first failure is reported in EventScanResult.
+ *  Header and footer magic bytes and the footer sequence number are
+ *  compared together with one SSE2 compare when available
+ *  (scan_frames_scalar() is the portable fallback).  Sizes and sequence
+ *  numbers are decoded with bswap.
+ */
+enum EventScanError
+{
+    SCAN_OK = 0,
+    SCAN_TRUNCATED,         // frame runs past the end of the buffer
+    SCAN_BAD_HEADER_MAGIC,
+    SCAN_BAD_FOOTER_MAGIC,
+    SCAN_SEQ_MISMATCH
+};
+
+struct EventScanResult
+{
+    unsigned int event_num;    // number of valid frames
+    unsigned int byte_size;    // bytes of valid frames from the buffer top
+    int error;                 // EventScanError
+    unsigned int error_offset; // offset of the first invalid frame
+    unsigned int expected_seq; // for SCAN_SEQ_MISMATCH
+    unsigned int found_seq;
+};
+
+static const unsigned int SCAN_HEADER_BYTE_SIZE = 8;
+static const unsigned int SCAN_FOOTER_BYTE_SIZE = 8;
+static const unsigned char SCAN_HEADER_MAGIC = 0xe7;
+static const unsigned char SCAN_FOOTER_MAGIC = 0xcc;
+
+inline const char *scan_error_string(int error)
+{
+    switch (error)
+    {
+    case SCAN_OK:
+        return "OK";
+    case SCAN_TRUNCATED:
+        return "truncated frame";
+    case SCAN_BAD_HEADER_MAGIC:
+        return "bad header magic";
+    case SCAN_BAD_FOOTER_MAGIC:
+        return "bad footer magic";
+    case SCAN_SEQ_MISMATCH:
+        return "sequence number mismatch";
+    }
+    return "unknown error";
+}
+
+/// big endian 32bit word at p
+inline uint32_t scan_get_be32(const unsigned char *p)
+{
+    uint32_t val;
+    memcpy(&val, p, sizeof(val));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    val = __builtin_bswap32(val);
+#endif
+    return val;
+}
+
+inline void scan_init_result(EventScanResult *res)
+{
+    res->event_num = 0;
+    res->byte_size = 0;
+    res->error = SCAN_OK;
+    res->error_offset = 0;
+    res->expected_seq = 0;
+    res->found_seq = 0;
+}
+
+inline void scan_set_error(EventScanResult *res, int error,
+                           unsigned int offset)
+{
+    res->error = error;
+    res->error_offset = offset;
+}
+
+/**
+ *  Portable version of scan_frames().
+ */
+inline int scan_frames_scalar(const unsigned char *buf, unsigned int len,
+                              std::vector<unsigned int> *offsets,
+                              bool check_seq, unsigned int first_seq,
+                              EventScanResult *res)
+{
+    scan_init_result(res);
+    unsigned int pos = 0;
+    unsigned int seq = first_seq;
+
+    while (pos < len)
+    {
+        if (len - pos < SCAN_HEADER_BYTE_SIZE + SCAN_FOOTER_BYTE_SIZE)
+        {
+            scan_set_error(res, SCAN_TRUNCATED, pos);
+            break;
+        }
+        const unsigned char *header = &buf[pos];
+        if (header[0] != SCAN_HEADER_MAGIC || header[1] != SCAN_HEADER_MAGIC)
+        {
+            scan_set_error(res, SCAN_BAD_HEADER_MAGIC, pos);
+            break;
+        }
+        uint32_t size = scan_get_be32(&header[4]);
+        if (size > len - pos - SCAN_HEADER_BYTE_SIZE - SCAN_FOOTER_BYTE_SIZE)
+        {
+            scan_set_error(res, SCAN_TRUNCATED, pos);
+            break;
+        }
+        const unsigned char *footer = &buf[pos + SCAN_HEADER_BYTE_SIZE + size];
+        if (footer[0] != SCAN_FOOTER_MAGIC || footer[1] != SCAN_FOOTER_MAGIC)
+        {
+            scan_set_error(res, SCAN_BAD_FOOTER_MAGIC, pos);
+            break;
+        }
+        if (check_seq)
+        {
+            uint32_t found = scan_get_be32(&footer[4]);
+            if (found != seq)
+            {
+                scan_set_error(res, SCAN_SEQ_MISMATCH, pos);
+                res->expected_seq = seq;
+                res->found_seq = found;
+                break;
+            }
+        }
+        if (offsets)
+        {
+            offsets->push_back(pos);
+        }
+        seq++;
+        res->event_num++;
+        pos += SCAN_HEADER_BYTE_SIZE + size + SCAN_FOOTER_BYTE_SIZE;
+        res->byte_size = pos;
+    }
+    return res->error;
+}
+
+#if defined(__SSE2__)
+/**
+ *  SSE2 version: header and footer of a frame are loaded into one 128bit
+ *  register and the magic bytes (and the sequence number) are checked by
+ *  one byte compare and movemask.  The movemask bits tell which part
+ *  failed.
+ */
+inline int scan_frames(const unsigned char *buf, unsigned int len,
+                       std::vector<unsigned int> *offsets,
+                       bool check_seq, unsigned int first_seq,
+                       EventScanResult *res)
+{
+    scan_init_result(res);
+    unsigned int pos = 0;
+    unsigned int seq = first_seq;
+
+    // bytes 0,1 (header magic) and 8,9 (footer magic) always compared,
+    // bytes 12..15 (footer sequence number) only with check_seq
+    const int magic_mask = 0x0303;
+    const int seq_mask = 0xf000;
+    const int mask = check_seq ? (magic_mask | seq_mask) : magic_mask;
+    const int header_magic = SCAN_HEADER_MAGIC | (SCAN_HEADER_MAGIC << 8);
+    const int footer_magic = SCAN_FOOTER_MAGIC | (SCAN_FOOTER_MAGIC << 8);
+
+    while (pos < len)
+    {
+        if (len - pos < SCAN_HEADER_BYTE_SIZE + SCAN_FOOTER_BYTE_SIZE)
+        {
+            scan_set_error(res, SCAN_TRUNCATED, pos);
+            break;
+        }
+        const unsigned char *header = &buf[pos];
+        uint32_t size = scan_get_be32(&header[4]);
+        if (size > len - pos - SCAN_HEADER_BYTE_SIZE - SCAN_FOOTER_BYTE_SIZE)
+        {
+            if (header[0] != SCAN_HEADER_MAGIC || header[1] != SCAN_HEADER_MAGIC)
+            {
+                scan_set_error(res, SCAN_BAD_HEADER_MAGIC, pos);
+            }
+            else
+            {
+                scan_set_error(res, SCAN_TRUNCATED, pos);
+            }
+            break;
+        }
+        const unsigned char *footer = &buf[pos + SCAN_HEADER_BYTE_SIZE + size];
+
+        int64_t h, f;
+        memcpy(&h, header, sizeof(h));
+        memcpy(&f, footer, sizeof(f));
+        __m128i frame = _mm_set_epi64x(f, h);
+        // x86 is little endian: footer bytes 12..15 hold bswap(seq)
+        __m128i expect = _mm_set_epi32((int)__builtin_bswap32(seq), footer_magic,
+                                       0, header_magic);
+        int eq = _mm_movemask_epi8(_mm_cmpeq_epi8(frame, expect));
+
+        if ((eq & mask) != mask)
+        {
+            if ((eq & 0x0003) != 0x0003)
+            {
+                scan_set_error(res, SCAN_BAD_HEADER_MAGIC, pos);
+            }
+            else if ((eq & 0x0300) != 0x0300)
+            {
+                scan_set_error(res, SCAN_BAD_FOOTER_MAGIC, pos);
+            }
+            else
+            {
+                scan_set_error(res, SCAN_SEQ_MISMATCH, pos);
+                res->expected_seq = seq;
+                res->found_seq = scan_get_be32(&footer[4]);
+            }
+            break;
+        }
+        if (offsets)
+        {
+            offsets->push_back(pos);
+        }
+        seq++;
+        res->event_num++;
+        pos += SCAN_HEADER_BYTE_SIZE + size + SCAN_FOOTER_BYTE_SIZE;
+        res->byte_size = pos;
+    }
+    return res->error;
+}
+#else
+inline int scan_frames(const unsigned char *buf, unsigned int len,
+                       std::vector<unsigned int> *offsets,
+                       bool check_seq, unsigned int first_seq,
+                       EventScanResult *res)
+{
+    return scan_frames_scalar(buf, len, offsets, check_seq, first_seq, res);
+}
+#endif
+
+} // namespace DAQMW
+
+#endif // EVENTSCAN_H
@@ -0,0 +1,248 @@
+// -*- C++ -*-
+/*!
+ * @file OutputThrottle.h
+ * @brief Prescale, rate limit and latest only sampling of a best effort output
+ *
+ */
+
+#ifndef OUTPUTTHROTTLE_H
+#define OUTPUTTHROTTLE_H
+
+#include <cstdlib>
+#include <string>
+#include <time.h>
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/*!
+ * @class OutputThrottle
+ * @brief decides which frames a best effort output (monitor) gets
+ *
+ * For each new frame the component asks offer(); only frames it accepts
+ * are copied and written to the output, so a slow monitor costs the
+ * reliable path nothing for the frames it does not get.
+ *
+ *   prescale N     1 frame in N (1: every frame)
+ *   rate R, burst  token bucket, at most R frames/s on average and
+ *                  burst frames back to back (R 0: no limit)
+ *   latest only    a frame the output could not take is kept and written
+ *                  again later, a newer frame replaces it (superseded())
+ *                  instead of waiting; without it the frame is dropped
+ *                  (write_failed())
+ *
+ *   if (throttle.offer()) {
+ *       if (pending) throttle.superseded();
+ *       copy the frame, pending = true;
+ *   }
+ *   if (pending) {
+ *       if (write ok)                     { throttle.sent(); pending = false; }
+ *       else if (!throttle.latest_only()) { throttle.write_failed(); pending = false; }
+ *   }
+ *
+ * Register the throttle with DaqComponentBase::register_output_throttle()
+ * to have the counters in the metrics (outputDrops of the status log).
+ */
+class OutputThrottle
+{
+  public:
+    OutputThrottle()
+        : m_prescale(1), m_rate(0.0), m_burst(1.0), m_latest_only(false),
+          m_count(0), m_tokens(1.0)
+    {
+        m_last.tv_sec = 0;
+        m_last.tv_nsec = 0;
+        reset_counters();
+    }
+
+    virtual ~OutputThrottle()
+    {
+    }
+
+    void set_prescale(unsigned int prescale)
+    {
+        m_prescale = (prescale == 0) ? 1 : prescale;
+        m_count = 0;
+    }
+
+    /// events_per_sec 0: no rate limit.  burst is at least 1 frame.
+    void set_rate(double events_per_sec, double burst = 1.0)
+    {
+        m_rate = (events_per_sec > 0.0) ? events_per_sec : 0.0;
+        m_burst = (burst >= 1.0) ? burst : 1.0;
+        m_tokens = m_burst;
+        clock_gettime(CLOCK_MONOTONIC, &m_last);
+    }
+
+    void set_latest_only(bool on)
+    {
+        m_latest_only = on;
+    }
+
+    bool latest_only() const
+    {
+        return m_latest_only;
+    }
+
+    /**
+     *  Component parameter <prefix>Prescale, <prefix>Rate,
+     *  <prefix>Burst or <prefix>Mode (latest or drop), name is the
+     *  part after the prefix.  Returns 1 if set, 0 if name is not a
+     *  throttle parameter and -1 for a bad value.
+     */
+    int set_param(const std::string &name, const std::string &value)
+    {
+        if (name == "Prescale")
+        {
+            int prescale = atoi(value.c_str());
+            if (prescale < 1)
+            {
+                return -1;
+            }
+            set_prescale(prescale);
+        }
+        else if (name == "Rate")
+        {
+            double rate = atof(value.c_str());
+            if (rate < 0.0)
+            {
+                return -1;
+            }
+            set_rate(rate, m_burst);
+        }
+        else if (name == "Burst")
+        {
+            double burst = atof(value.c_str());
+            if (burst < 1.0)
+            {
+                return -1;
+            }
+            set_rate(m_rate, burst);
+        }
+        else if (name == "Mode")
+        {
+            if (value == "latest")
+            {
+                set_latest_only(true);
+            }
+            else if (value == "drop")
+            {
+                set_latest_only(false);
+            }
+            else
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            return 0;
+        }
+        return 1;
+    }
+
+    /// a new frame: true if the output should get it
+    bool offer()
+    {
+        if (++m_count < m_prescale)
+        {
+            m_prescale_drop++;
+            return false;
+        }
+        m_count = 0;
+        if (m_rate > 0.0)
+        {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            double elapsed = (now.tv_sec - m_last.tv_sec)
+                             + (now.tv_nsec - m_last.tv_nsec) * 1.0e-9;
+            m_last = now;
+            m_tokens += elapsed * m_rate;
+            if (m_tokens > m_burst)
+            {
+                m_tokens = m_burst;
+            }
+            if (m_tokens < 1.0)
+            {
+                m_rate_drop++;
+                return false;
+            }
+            m_tokens -= 1.0;
+        }
+        return true;
+    }
+
+    void sent()
+    {
+        m_sent++;
+    }
+
+    /// latest only: the pending frame was replaced by a newer one
+    void superseded()
+    {
+        m_latest_drop++;
+    }
+
+    /// the output could not take the frame and it is not kept
+    void write_failed()
+    {
+        m_full_drop++;
+    }
+
+    void reset_counters()
+    {
+        m_sent = 0;
+        m_prescale_drop = 0;
+        m_rate_drop = 0;
+        m_latest_drop = 0;
+        m_full_drop = 0;
+    }
+
+    unsigned long long get_sent() const
+    {
+        return m_sent;
+    }
+
+    unsigned long long get_prescale_drop() const
+    {
+        return m_prescale_drop;
+    }
+
+    unsigned long long get_rate_drop() const
+    {
+        return m_rate_drop;
+    }
+
+    unsigned long long get_latest_drop() const
+    {
+        return m_latest_drop;
+    }
+
+    unsigned long long get_full_drop() const
+    {
+        return m_full_drop;
+    }
+
+  private:
+    unsigned int m_prescale;
+    double m_rate;
+    double m_burst;
+    bool m_latest_only;
+
+    unsigned int m_count;
+    double m_tokens;
+    struct timespec m_last;
+
+    unsigned long long m_sent;
+    unsigned long long m_prescale_drop;
+    unsigned long long m_rate_drop;
+    unsigned long long m_latest_drop;
+    unsigned long long m_full_drop;
+};
+
+} // namespace DAQMW
+
+#endif // OUTPUTTHROTTLE_H
@@ -0,0 +1,483 @@
+// -*- C++ -*-
+/*!
+ * @file ShmRing.h
+ * @brief Single producer single consumer ring buffer in /dev/shm
+ *
+ */
+
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/*!
+ * @class ShmRing
+ * @brief variable length record ring shared by two processes
+ *
+ * One process creates the ring (create()), the other attaches to it by
+ * name (open()).  Exactly one process pushes and one process pops.
+ *
+ *   producer                              consumer
+ *   ring.open(name);                      ring.create(name, size, records);
+ *   while (!ring.push(data, len)) {       const unsigned char *p;
+ *       ring.wait_space(len, usec);       while ((p = ring.peek(&len))) {
+ *   }                                         use(p, len);
+ *                                             ring.release();
+ *                                         }
+ *                                         ring.wait_data(usec);
+ *
+ * peek() returns a pointer into the shared memory, the record is not
+ * copied.  It stays valid until release(); the producer may overwrite
+ * it right after, so data used later must be copied first.  Records
+ * are 8 byte aligned: a 8 byte size word followed by the data.  A record
+ * never wraps; if it does not fit before the end of the ring a wrap
+ * marker is written and the record starts at offset 0, so the largest
+ * record is half of the ring size.  The ring also holds at most
+ * max_records records (0: as many as fit).
+ *
+ * head and tail are free running byte counters in the shared header,
+ * written by one side each (std::atomic<uint64_t> is lock-free and
+ * address-free, so it works across processes).  A side with nothing to
+ * do sleeps on a futex in the shared header (wait_data(), wait_space())
+ * and the other side wakes it only if it is sleeping.
+ */
+class ShmRing
+{
+  public:
+    ShmRing()
+        : m_hdr(0), m_data(0), m_map_byte_size(0), m_owner(false)
+    {
+    }
+
+    virtual ~ShmRing()
+    {
+        close();
+    }
+
+    /**
+         *  Create and map the ring.  byte_size is rounded up to a power
+         *  of 2.  A stale segment of the same name is replaced.
+         */
+    bool create(const std::string &name, uint64_t byte_size, uint64_t max_records = 0)
+    {
+        close();
+        uint64_t capacity = MIN_BYTE_SIZE;
+        while (capacity < byte_size)
+        {
+            capacity <<= 1;
+        }
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+        {
+            std::cerr << "### ERROR: ShmRing: shm_open " << name << ": "
+                      << strerror(errno) << '\n';
+            return false;
+        }
+        size_t map_byte_size = sizeof(Header) + capacity;
+        if (ftruncate(fd, map_byte_size) < 0)
+        {
+            std::cerr << "### ERROR: ShmRing: ftruncate " << name << ": "
+                      << strerror(errno) << '\n';
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        if (!map(fd, map_byte_size))
+        {
+            shm_unlink(name.c_str());
+            return false;
+        }
+        m_hdr->capacity = capacity;
+        m_hdr->max_records = max_records;
+        m_hdr->head.store(0, std::memory_order_relaxed);
+        m_hdr->tail.store(0, std::memory_order_relaxed);
+        m_hdr->records_in.store(0, std::memory_order_relaxed);
+        m_hdr->records_out.store(0, std::memory_order_relaxed);
+        m_hdr->data_seq.store(0, std::memory_order_relaxed);
+        m_hdr->space_seq.store(0, std::memory_order_relaxed);
+        m_hdr->consumer_waiting.store(0, std::memory_order_relaxed);
+        m_hdr->producer_waiting.store(0, std::memory_order_relaxed);
+        m_hdr->producer_attached.store(0, std::memory_order_relaxed);
+        m_hdr->consumer_closed.store(0, std::memory_order_relaxed);
+        m_hdr->magic.store(MAGIC, std::memory_order_release);
+        m_name = name;
+        m_owner = true;
+        return true;
+    }
+
+    /// Attach to a ring created by the other process.
+    bool open(const std::string &name)
+    {
+        close();
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0)
+        {
+            std::cerr << "### ERROR: ShmRing: shm_open " << name << ": "
+                      << strerror(errno) << '\n';
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(Header))
+        {
+            std::cerr << "### ERROR: ShmRing: bad segment " << name << '\n';
+            ::close(fd);
+            return false;
+        }
+        if (!map(fd, st.st_size))
+        {
+            return false;
+        }
+        if (m_hdr->magic.load(std::memory_order_acquire) != MAGIC
+            || sizeof(Header) + m_hdr->capacity != m_map_byte_size)
+        {
+            std::cerr << "### ERROR: ShmRing: not a ring " << name << '\n';
+            close();
+            return false;
+        }
+        m_hdr->producer_attached.store(1, std::memory_order_release);
+        m_name = name;
+        m_owner = false;
+        return true;
+    }
+
+    /// Unmap.  The creator also removes the name from /dev/shm.
+    void close()
+    {
+        if (m_hdr == 0)
+        {
+            return;
+        }
+        if (m_owner)
+        {
+            m_hdr->consumer_closed.store(1, std::memory_order_release);
+            notify(m_hdr->space_seq, m_hdr->producer_waiting);
+            shm_unlink(m_name.c_str());
+        }
+        munmap(m_hdr, m_map_byte_size);
+        m_hdr = 0;
+        m_data = 0;
+        m_map_byte_size = 0;
+        m_owner = false;
+    }
+
+    bool is_open() const
+    {
+        return m_hdr != 0;
+    }
+
+    const std::string &name() const
+    {
+        return m_name;
+    }
+
+    uint64_t capacity() const
+    {
+        return m_hdr ? m_hdr->capacity : 0;
+    }
+
+    uint64_t max_record_byte_size() const
+    {
+        return capacity() / 2 - RECORD_HEADER_BYTE_SIZE;
+    }
+
+    /// true if the consumer has closed the ring
+    bool is_closed() const
+    {
+        return m_hdr == 0 || m_hdr->consumer_closed.load(std::memory_order_acquire);
+    }
+
+    /**
+         *  Producer: reserve space for a record of byte_size bytes.
+         *  Returns 0 if the ring is full (or the record is too large).
+         *  Write the data and call commit().
+         */
+    unsigned char *reserve(uint64_t byte_size)
+    {
+        if (!has_space(byte_size))
+        {
+            return 0;
+        }
+        uint64_t need = RECORD_HEADER_BYTE_SIZE + align(byte_size);
+        uint64_t head = m_hdr->head.load(std::memory_order_relaxed);
+        uint64_t pos = head & (m_hdr->capacity - 1);
+        uint64_t to_end = m_hdr->capacity - pos;
+        if (to_end < need)
+        {
+            put_record_header(pos, WRAP_MARK);
+            m_reserved_pos = head + to_end;
+        }
+        else
+        {
+            m_reserved_pos = head;
+        }
+        return &m_data[(m_reserved_pos & (m_hdr->capacity - 1)) + RECORD_HEADER_BYTE_SIZE];
+    }
+
+    void commit(uint64_t byte_size)
+    {
+        put_record_header(m_reserved_pos & (m_hdr->capacity - 1), byte_size);
+        m_hdr->records_in.store(m_hdr->records_in.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+        m_hdr->head.store(m_reserved_pos + RECORD_HEADER_BYTE_SIZE + align(byte_size),
+                          std::memory_order_release);
+        notify(m_hdr->data_seq, m_hdr->consumer_waiting);
+    }
+
+    /// Producer: true if reserve(byte_size) would succeed now.
+    bool has_space(uint64_t byte_size) const
+    {
+        if (byte_size > max_record_byte_size())
+        {
+            return false;
+        }
+        if (m_hdr->max_records > 0
+            && m_hdr->records_in.load(std::memory_order_relaxed)
+                   - m_hdr->records_out.load(std::memory_order_acquire)
+                   >= m_hdr->max_records)
+        {
+            return false;
+        }
+        uint64_t need = RECORD_HEADER_BYTE_SIZE + align(byte_size);
+        uint64_t head = m_hdr->head.load(std::memory_order_relaxed);
+        uint64_t tail = m_hdr->tail.load(std::memory_order_acquire);
+        uint64_t to_end = m_hdr->capacity - (head & (m_hdr->capacity - 1));
+        uint64_t total = need;
+        if (to_end < need)
+        {
+            total += to_end; // wrap marker and padding
+        }
+        return m_hdr->capacity - (head - tail) >= total;
+    }
+
+    /**
+         *  Producer: sleep until has_space(byte_size), the consumer closed
+         *  the ring or timeout_usec passed.  false if there is no space.
+         */
+    bool wait_space(uint64_t byte_size, long long timeout_usec)
+    {
+        return wait(m_hdr->space_seq, m_hdr->producer_waiting, timeout_usec,
+                    [this, byte_size] { return has_space(byte_size) || is_closed(); })
+               && has_space(byte_size);
+    }
+
+    /// Producer: copy one record in.  false if the ring is full.
+    bool push(const void *data, uint64_t byte_size)
+    {
+        unsigned char *p = reserve(byte_size);
+        if (p == 0)
+        {
+            return false;
+        }
+        memcpy(p, data, byte_size);
+        commit(byte_size);
+        return true;
+    }
+
+    /**
+         *  Consumer: pointer to the oldest record in the shared memory,
+         *  0 if the ring is empty.  The record stays valid until release().
+         */
+    const unsigned char *peek(uint64_t *byte_size)
+    {
+        uint64_t tail = m_hdr->tail.load(std::memory_order_relaxed);
+        uint64_t head = m_hdr->head.load(std::memory_order_acquire);
+        if (tail == head)
+        {
+            return 0;
+        }
+        uint64_t pos = tail & (m_hdr->capacity - 1);
+        uint64_t size = get_record_header(pos);
+        if (size == WRAP_MARK)
+        {
+            tail += m_hdr->capacity - pos;
+            m_hdr->tail.store(tail, std::memory_order_release);
+            notify(m_hdr->space_seq, m_hdr->producer_waiting);
+            if (tail == head)
+            {
+                return 0;
+            }
+            pos = 0;
+            size = get_record_header(pos);
+        }
+        m_peek_size = size;
+        *byte_size = size;
+        return &m_data[pos + RECORD_HEADER_BYTE_SIZE];
+    }
+
+    /// Consumer: drop the record returned by peek().
+    void release()
+    {
+        uint64_t tail = m_hdr->tail.load(std::memory_order_relaxed);
+        m_hdr->records_out.store(m_hdr->records_out.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_relaxed);
+        m_hdr->tail.store(tail + RECORD_HEADER_BYTE_SIZE + align(m_peek_size),
+                          std::memory_order_release);
+        notify(m_hdr->space_seq, m_hdr->producer_waiting);
+    }
+
+    /**
+         *  Consumer: sleep until a record is there or timeout_usec
+         *  passed.  false if the ring is still empty.
+         */
+    bool wait_data(long long timeout_usec)
+    {
+        return wait(m_hdr->data_seq, m_hdr->consumer_waiting, timeout_usec,
+                    [this] { return !empty(); });
+    }
+
+    bool empty() const
+    {
+        return m_hdr->head.load(std::memory_order_acquire)
+               == m_hdr->tail.load(std::memory_order_relaxed);
+    }
+
+    /// Sleep while waiting for something the ring cannot signal (a full
+    /// InPort buffer): spin briefly, then sleep up to MAX_SLEEP_USEC.
+    /// idle counts the polls without progress.
+    static void backoff(unsigned int idle)
+    {
+        if (idle < SPIN_COUNT)
+        {
+            return;
+        }
+        unsigned int usec = (idle - SPIN_COUNT + 1) * 2;
+        if (usec > MAX_SLEEP_USEC)
+        {
+            usec = MAX_SLEEP_USEC;
+        }
+        struct timespec ts;
+        ts.tv_sec = 0;
+        ts.tv_nsec = usec * 1000;
+        nanosleep(&ts, 0);
+    }
+
+    static const unsigned int SPIN_COUNT = 64;
+    static const unsigned int MAX_SLEEP_USEC = 1000;
+
+  private:
+    static const uint32_t MAGIC = 0x44415152; // "DAQR"
+    static const uint64_t MIN_BYTE_SIZE = 4096;
+    static const uint64_t RECORD_HEADER_BYTE_SIZE = 8;
+    static const uint64_t WRAP_MARK = 0xffffffffULL;
+
+    struct Header
+    {
+        std::atomic<uint32_t> magic;
+        std::atomic<uint32_t> producer_attached;
+        std::atomic<uint32_t> consumer_closed;
+        uint64_t capacity;
+        uint64_t max_records;
+        // written by the producer
+        alignas(64) std::atomic<uint64_t> head;
+        std::atomic<uint64_t> records_in;
+        std::atomic<uint32_t> data_seq;         // futex: a record was committed
+        std::atomic<uint32_t> consumer_waiting;
+        // written by the consumer
+        alignas(64) std::atomic<uint64_t> tail;
+        std::atomic<uint64_t> records_out;
+        std::atomic<uint32_t> space_seq;        // futex: a record was released
+        std::atomic<uint32_t> producer_waiting;
+    };
+
+    /// Wake the other side if it sleeps on seq.
+    static void notify(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiting)
+    {
+        seq.fetch_add(1, std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_seq_cst))
+        {
+            syscall(SYS_futex, (uint32_t *)&seq, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+        }
+    }
+
+    /// Sleep on seq unless ready().  A notify() after seq was read makes
+    /// FUTEX_WAIT return at once, so no wakeup is lost.
+    template <class Ready>
+    static bool wait(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiting,
+                     long long timeout_usec, Ready ready)
+    {
+        uint32_t value = seq.load(std::memory_order_seq_cst);
+        if (ready())
+        {
+            return true;
+        }
+        if (timeout_usec <= 0)
+        {
+            return false;
+        }
+        waiting.store(1, std::memory_order_seq_cst);
+        if (!ready())
+        {
+            struct timespec ts;
+            ts.tv_sec = timeout_usec / 1000000;
+            ts.tv_nsec = (timeout_usec % 1000000) * 1000;
+            syscall(SYS_futex, (uint32_t *)&seq, FUTEX_WAIT, value, &ts, 0, 0);
+        }
+        waiting.store(0, std::memory_order_relaxed);
+        return ready();
+    }
+
+    static uint64_t align(uint64_t byte_size)
+    {
+        return (byte_size + 7) & ~(uint64_t)7;
+    }
+
+    bool map(int fd, size_t map_byte_size)
+    {
+        void *p = mmap(0, map_byte_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+        {
+            std::cerr << "### ERROR: ShmRing: mmap: " << strerror(errno) << '\n';
+            return false;
+        }
+        m_hdr = (Header *)p;
+        m_data = (unsigned char *)p + sizeof(Header);
+        m_map_byte_size = map_byte_size;
+        return true;
+    }
+
+    void put_record_header(uint64_t pos, uint64_t byte_size)
+    {
+        uint64_t word = byte_size;
+        memcpy(&m_data[pos], &word, sizeof(word));
+    }
+
+    uint64_t get_record_header(uint64_t pos) const
+    {
+        uint64_t word;
+        memcpy(&word, &m_data[pos], sizeof(word));
+        return word;
+    }
+
+    Header *m_hdr;
+    unsigned char *m_data;
+    size_t m_map_byte_size;
+    bool m_owner;
+    std::string m_name;
+    uint64_t m_reserved_pos;
+    uint64_t m_peek_size;
+};
+
+} // namespace DAQMW
+
+#endif // SHMRING_H
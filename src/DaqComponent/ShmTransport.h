@@ -0,0 +1,337 @@
+// -*- C++ -*-
+/*!
+ * @file ShmTransport.h
+ * @brief Shared memory data port transport for components on one host
+ *
+ */
+
+#ifndef SHMTRANSPORT_H
+#define SHMTRANSPORT_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+#include <coil/Factory.h>
+#include <rtm/CORBA_SeqUtil.h>
+#include <rtm/InPortConnector.h>
+#include <rtm/InPortConsumer.h>
+#include <rtm/InPortProvider.h>
+#include <rtm/NVUtil.h>
+
+#include "ShmRing.h"
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/**
+ *  OpenRTM interface type of the shared memory transport.
+ *  DaqOperator selects it for an InPort with transport="shm" in the
+ *  configuration file:
+ *
+ *    <inPort from="SampleReader0:samplereader_out" transport="shm">dispatcher_in</inPort>
+ *
+ *  Each connection is one ShmRing in /dev/shm created by the InPort side
+ *  and attached by the OutPort side.  The OutPort writes the marshalled
+ *  data into the ring and a thread of the InPort side copies each record
+ *  into a stream owned by the InPort buffer, so a record costs two
+ *  memcpy and no CORBA call.  The ring holds buffer_length records
+ *  (SHM_SLOT_BYTE_SIZE bytes each on average).  InPort/OutPort status is
+ *  the same as with corba_cdr: a full ring makes OutPort::write() wait up
+ *  to buffer_write_timeout and fail with SEND_TIMEOUT (SEND_FULL if the
+ *  full policy is not block), a full InPort buffer keeps the record in
+ *  the ring.
+ */
+static const char *const SHM_INTERFACE_TYPE = "shm_ring";
+static const char *const SHM_PROP_NAME = "dataport.shm_ring.name";
+static const uint64_t SHM_SLOT_BYTE_SIZE = 1024 * 1024;
+static const uint64_t SHM_MIN_RING_BYTE_SIZE = 8 * 1024 * 1024;
+static const uint64_t SHM_MAX_RING_BYTE_SIZE = 1024 * 1024 * 1024;
+static const unsigned int SHM_DEFAULT_BUFFER_LENGTH = 8; // as OpenRTM
+static const long long SHM_RECEIVE_WAIT_USEC = 100000;
+
+/*!
+ * @class ShmInPortProvider
+ * @brief InPort side of the shared memory transport
+ */
+class ShmInPortProvider
+    : public RTC::InPortProvider
+{
+  public:
+    ShmInPortProvider()
+        : m_buffer(0), m_connector(0), m_running(true)
+    {
+        setInterfaceType(SHM_INTERFACE_TYPE);
+        setDataFlowType("push");
+        setSubscriptionType("flush,new,periodic");
+    }
+
+    virtual ~ShmInPortProvider()
+    {
+        m_running = false;
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        m_ring.close();
+    }
+
+    /**
+     *  Called with the connector profile when the connection is made:
+     *  create the ring for the buffer length of the connection and
+     *  publish its name.
+     */
+    virtual bool publishInterface(SDOPackage::NVList &properties)
+    {
+        if (!m_ring.is_open())
+        {
+            unsigned int buffer_length = get_buffer_length(properties);
+            uint64_t byte_size = buffer_length * SHM_SLOT_BYTE_SIZE;
+            if (byte_size < SHM_MIN_RING_BYTE_SIZE)
+            {
+                byte_size = SHM_MIN_RING_BYTE_SIZE;
+            }
+            if (byte_size > SHM_MAX_RING_BYTE_SIZE)
+            {
+                byte_size = SHM_MAX_RING_BYTE_SIZE;
+            }
+            static std::atomic<unsigned int> s_count(0);
+            char name[64];
+            snprintf(name, sizeof(name), "/daqmw_%d_%u", getpid(), s_count++);
+            if (!m_ring.create(name, byte_size, buffer_length))
+            {
+                return false;
+            }
+            CORBA_SeqUtil::push_back(m_properties,
+                                     NVUtil::newNV(SHM_PROP_NAME, name));
+            m_thread = std::thread(&ShmInPortProvider::receive_loop, this);
+        }
+        return RTC::InPortProvider::publishInterface(properties);
+    }
+
+    virtual void init(coil::Properties &prop)
+    {
+    }
+
+    virtual void setBuffer(RTC::CdrBufferBase *buffer)
+    {
+        m_buffer = buffer;
+    }
+
+    virtual void setListener(RTC::ConnectorInfo &info,
+                             RTC::ConnectorListeners *listeners)
+    {
+    }
+
+    virtual void setConnector(RTC::InPortConnector *connector)
+    {
+        m_connector.store(connector);
+    }
+
+  private:
+    static unsigned int get_buffer_length(const SDOPackage::NVList &properties)
+    {
+        const char *keys[] = {"dataport.inport.buffer.length", "dataport.buffer.length"};
+        for (unsigned int i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+        {
+            std::string value = NVUtil::toString(properties, keys[i]);
+            if (!value.empty() && atoi(value.c_str()) > 0)
+            {
+                return atoi(value.c_str());
+            }
+        }
+        return SHM_DEFAULT_BUFFER_LENGTH;
+    }
+
+    void receive_loop()
+    {
+        // copy of the oldest record, not yet taken by the InPort buffer
+        std::unique_ptr<cdrMemoryStream> pending;
+        unsigned int idle = 0;
+        while (m_running)
+        {
+            RTC::InPortConnector *connector = m_connector.load();
+            if (connector == 0)
+            {
+                usleep(1000); // not connected yet
+                continue;
+            }
+            if (!pending)
+            {
+                uint64_t byte_size;
+                const unsigned char *record = m_ring.peek(&byte_size);
+                if (record == 0)
+                {
+                    m_ring.wait_data(SHM_RECEIVE_WAIT_USEC);
+                    continue;
+                }
+                // The InPort buffer keeps the stream until InPort::read(),
+                // the record may be overwritten as soon as it is released.
+                pending.reset(new cdrMemoryStream(byte_size));
+                pending->put_octet_array((const CORBA::Octet *)record, byte_size);
+            }
+            RTC::DataPortStatus::Enum ret = connector->write(*pending);
+            if (ret == RTC::DataPortStatus::BUFFER_FULL
+                || ret == RTC::DataPortStatus::BUFFER_TIMEOUT)
+            {
+                // keep the record, the OutPort side sees the ring fill up
+                ShmRing::backoff(idle++);
+                continue;
+            }
+            pending.reset();
+            m_ring.release();
+            idle = 0;
+        }
+    }
+
+    ShmRing m_ring;
+    RTC::CdrBufferBase *m_buffer;
+    std::atomic<RTC::InPortConnector *> m_connector;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+};
+
+/*!
+ * @class ShmInPortConsumer
+ * @brief OutPort side of the shared memory transport
+ */
+class ShmInPortConsumer
+    : public RTC::InPortConsumer
+{
+  public:
+    ShmInPortConsumer()
+        : m_write_timeout_usec(5000), m_block(true)
+    {
+    }
+
+    virtual ~ShmInPortConsumer()
+    {
+        m_ring.close();
+    }
+
+    virtual void init(coil::Properties &prop)
+    {
+    }
+
+    virtual ReturnCode put(const cdrMemoryStream &data)
+    {
+        if (!m_ring.is_open() || m_ring.is_closed())
+        {
+            return RTC::DataPortStatus::CONNECTION_LOST;
+        }
+        uint64_t byte_size = data.bufSize();
+        if (byte_size > m_ring.max_record_byte_size())
+        {
+            std::cerr << "### ERROR: ShmInPortConsumer: data byte size " << byte_size
+                      << " exceeds " << m_ring.max_record_byte_size() << '\n';
+            return RTC::DataPortStatus::PORT_ERROR;
+        }
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        while (!m_ring.push(data.bufPtr(), byte_size))
+        {
+            if (!m_block)
+            {
+                return RTC::DataPortStatus::SEND_FULL;
+            }
+            if (m_ring.is_closed())
+            {
+                return RTC::DataPortStatus::CONNECTION_LOST;
+            }
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long elapsed_usec = (now.tv_sec - start.tv_sec) * 1000000LL
+                                     + (now.tv_nsec - start.tv_nsec) / 1000;
+            if (elapsed_usec >= m_write_timeout_usec)
+            {
+                return RTC::DataPortStatus::SEND_TIMEOUT;
+            }
+            // woken by the consumer releasing a record or closing
+            m_ring.wait_space(byte_size, m_write_timeout_usec - elapsed_usec);
+        }
+        return RTC::DataPortStatus::PORT_OK;
+    }
+
+    virtual void publishInterfaceProfile(SDOPackage::NVList &properties)
+    {
+    }
+
+    virtual bool subscribeInterface(const SDOPackage::NVList &properties)
+    {
+        CORBA::Long index = NVUtil::find_index(properties, SHM_PROP_NAME);
+        if (index < 0)
+        {
+            std::cerr << "### ERROR: ShmInPortConsumer: " << SHM_PROP_NAME
+                      << " not found" << '\n';
+            return false;
+        }
+        const char *name;
+        if (!(properties[index].value >>= name))
+        {
+            return false;
+        }
+        if (!m_ring.open(name))
+        {
+            return false;
+        }
+
+        // same buffer policy as the InPort buffer of corba_cdr
+        std::string policy = NVUtil::toString(properties,
+                                              "dataport.inport.buffer.write.full_policy");
+        m_block = (policy.empty() || policy == "block");
+        std::string timeout = NVUtil::toString(properties,
+                                               "dataport.inport.buffer.write.timeout");
+        if (!timeout.empty())
+        {
+            m_write_timeout_usec = (long long)(atof(timeout.c_str()) * 1000000.0);
+        }
+        return true;
+    }
+
+    virtual void unsubscribeInterface(const SDOPackage::NVList &properties)
+    {
+        m_ring.close();
+    }
+
+  private:
+    ShmRing m_ring;
+    long long m_write_timeout_usec;
+    bool m_block;
+};
+
+/**
+ *  Register the shared memory transport to OpenRTM.  Called by the
+ *  DaqComponentBase constructor before the component registers its
+ *  ports, so every DAQ-Component accepts transport="shm".
+ */
+inline void ShmTransportInit()
+{
+    RTC::InPortProviderFactory &provider_factory = RTC::InPortProviderFactory::instance();
+    if (!provider_factory.hasFactory(SHM_INTERFACE_TYPE))
+    {
+        provider_factory.addFactory(SHM_INTERFACE_TYPE,
+                                    ::coil::Creator<RTC::InPortProvider, ShmInPortProvider>,
+                                    ::coil::Destructor<RTC::InPortProvider, ShmInPortProvider>);
+    }
+    RTC::InPortConsumerFactory &consumer_factory = RTC::InPortConsumerFactory::instance();
+    if (!consumer_factory.hasFactory(SHM_INTERFACE_TYPE))
+    {
+        consumer_factory.addFactory(SHM_INTERFACE_TYPE,
+                                    ::coil::Creator<RTC::InPortConsumer, ShmInPortConsumer>,
+                                    ::coil::Destructor<RTC::InPortConsumer, ShmInPortConsumer>);
+    }
+}
+
+} // namespace DAQMW
+
+#endif // SHMTRANSPORT_H
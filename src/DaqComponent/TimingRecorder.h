@@ -0,0 +1,329 @@
+// -*- C++ -*-
+/*!
+ * @file TimingRecorder.h
+ * @brief Asynchronous timestamp recorder
+ *
+ */
+
+#ifndef TIMINGRECORDER_H
+#define TIMINGRECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/*!
+ * @namespace DAQMW
+ * @brief common namespace of DAQ-Middleware
+ */
+namespace DAQMW
+{
+/**
+ *  Record kinds used by DaqComponentBase and DaqOperator.
+ *  Users may add their own kinds from TIMING_USER.
+ */
+enum TimingKind
+{
+    TIMING_CMD_SEND = 1,    // operator sends a command (arg: DAQCommand)
+    TIMING_CMD_DONE,        // command completed (arg: DAQCommand, operator value: usec of the slowest)
+    TIMING_CMD_PICKUP,      // component picked up a command (value: usec since setCommand())
+    TIMING_CMD_LATENCY,     // operator send to component done (value: usec)
+    TIMING_CMD_TRANSITION,  // component transition incl. trans lock wait (value: usec)
+    TIMING_COMP_DONE,       // operator: one component done (arg: index, value: usec since send)
+    TIMING_COMP_TIMEOUT,    // operator: one component not done in time (arg: index, value: DAQCommand)
+    TIMING_USER = 1000
+};
+
+/**
+ *  One timestamp record.  mono_ns is CLOCK_MONOTONIC in nsec.
+ *  The binary file is a plain array of this struct (native byte order).
+ */
+struct TimingRecord
+{
+    uint64_t mono_ns;
+    uint32_t kind;
+    int32_t arg;
+    int64_t value;
+};
+
+/*!
+ * @class TimingRecorder
+ * @brief lock-free ring of timestamp records flushed by a background thread
+ *
+ * record() only takes a CLOCK_MONOTONIC timestamp and stores 24 bytes in
+ * a preallocated ring, so it can stay enabled in production runs.
+ * The file is opened once in open() (missing directories of the path
+ * are created) and written by the flush thread.
+ * If the ring is full the record is counted as dropped, never blocks.
+ *
+ *   TimingRecorder rec;
+ *   rec.set_kind_name(TIMING_USER, "readout");
+ *   rec.open("/tmp/daqmw/timing.MyComp.csv", TimingRecorder::CSV);
+ *   rec.record(TIMING_USER, 0, nbytes);
+ *   ...
+ *   rec.close();
+ *
+ * CSV lines are "kind,arg,mono_ns,value".
+ */
+class TimingRecorder
+{
+  public:
+    enum Format
+    {
+        CSV,
+        BINARY
+    };
+
+    TimingRecorder(unsigned int capacity = DEFAULT_CAPACITY)
+        : m_slots(round_up(capacity)),
+          m_mask(round_up(capacity) - 1),
+          m_head(0), m_tail(0), m_dropped(0),
+          m_fp(0), m_format(CSV), m_running(false)
+    {
+        for (unsigned long i = 0; i < m_slots.size(); i++)
+        {
+            m_slots[i].turn.store(i, std::memory_order_relaxed);
+        }
+        set_kind_name(TIMING_CMD_SEND, "cmd_send");
+        set_kind_name(TIMING_CMD_DONE, "cmd_done");
+        set_kind_name(TIMING_CMD_PICKUP, "cmd_pickup");
+        set_kind_name(TIMING_CMD_LATENCY, "cmd_latency");
+        set_kind_name(TIMING_CMD_TRANSITION, "cmd_transition");
+        set_kind_name(TIMING_COMP_DONE, "comp_done");
+        set_kind_name(TIMING_COMP_TIMEOUT, "comp_timeout");
+    }
+
+    virtual ~TimingRecorder()
+    {
+        close();
+    }
+
+    /// name printed in the first CSV column instead of the kind number.
+    /// Call before open().
+    void set_kind_name(uint32_t kind, const std::string &name)
+    {
+        m_kind_names[kind] = name;
+    }
+
+    bool open(const std::string &path, Format format = CSV)
+    {
+        if (m_running)
+        {
+            return true;
+        }
+        if (!make_parent_dirs(path))
+        {
+            return false;
+        }
+        m_fp = fopen(path.c_str(), format == BINARY ? "ab" : "a");
+        if (m_fp == 0)
+        {
+            std::cerr << "### ERROR: TimingRecorder: cannot open " << path
+                      << ": " << strerror(errno) << '\n';
+            return false;
+        }
+        m_format = format;
+        m_running = true;
+        m_thread = std::thread(&TimingRecorder::flush_loop, this);
+        return true;
+    }
+
+    /// mkdir -p of the directory part of path
+    static bool make_parent_dirs(const std::string &path)
+    {
+        std::string::size_type pos = 0;
+        while ((pos = path.find('/', pos + 1)) != std::string::npos)
+        {
+            std::string dir = path.substr(0, pos);
+            if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+            {
+                std::cerr << "### ERROR: TimingRecorder: cannot create " << dir
+                          << ": " << strerror(errno) << '\n';
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (!m_running)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_cond.notify_one();
+        m_thread.join();
+        flush();
+        unsigned long long dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+            std::cerr << "TimingRecorder: " << dropped << " records dropped\n";
+        }
+        fclose(m_fp);
+        m_fp = 0;
+    }
+
+    bool is_open() const
+    {
+        return m_running;
+    }
+
+    /// Store one record.  Safe from any thread, never blocks.
+    bool record(uint32_t kind, int32_t arg = 0, int64_t value = 0)
+    {
+        if (!m_running.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        unsigned long pos = m_head.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;)
+        {
+            slot = &m_slots[pos & m_mask];
+            unsigned long turn = slot->turn.load(std::memory_order_acquire);
+            long diff = (long)turn - (long)pos;
+            if (diff == 0)
+            {
+                if (m_head.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+        slot->rec.mono_ns = now.tv_sec * 1000000000ULL + now.tv_nsec;
+        slot->rec.kind = kind;
+        slot->rec.arg = arg;
+        slot->rec.value = value;
+        slot->turn.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    unsigned long long get_dropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static const unsigned int DEFAULT_CAPACITY = 4096;
+    static const int FLUSH_CYCLE_MSEC = 200;
+
+    struct Slot
+    {
+        std::atomic<unsigned long> turn;
+        TimingRecord rec;
+    };
+
+    static unsigned int round_up(unsigned int n)
+    {
+        unsigned int size = 2;
+        while (size < n)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    void flush_loop()
+    {
+        const int cycle_msec = FLUSH_CYCLE_MSEC; // no odr-use before C++17
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_running)
+        {
+            m_cond.wait_for(lock, std::chrono::milliseconds(cycle_msec));
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    /// pop every published record and write it (flush thread only)
+    void flush()
+    {
+        int n = 0;
+        for (;;)
+        {
+            unsigned long pos = m_tail.load(std::memory_order_relaxed);
+            Slot *slot = &m_slots[pos & m_mask];
+            if (slot->turn.load(std::memory_order_acquire) != pos + 1)
+            {
+                break;
+            }
+            TimingRecord rec = slot->rec;
+            slot->turn.store(pos + m_slots.size(), std::memory_order_release);
+            m_tail.store(pos + 1, std::memory_order_relaxed);
+            write(rec);
+            n++;
+        }
+        if (n > 0)
+        {
+            fflush(m_fp);
+        }
+    }
+
+    void write(const TimingRecord &rec)
+    {
+        if (m_format == BINARY)
+        {
+            fwrite(&rec, sizeof(rec), 1, m_fp);
+            return;
+        }
+        std::map<uint32_t, std::string>::const_iterator it = m_kind_names.find(rec.kind);
+        if (it != m_kind_names.end())
+        {
+            fprintf(m_fp, "%s,", it->second.c_str());
+        }
+        else
+        {
+            fprintf(m_fp, "%u,", rec.kind);
+        }
+        fprintf(m_fp, "%d,%llu,%lld\n", rec.arg,
+                (unsigned long long)rec.mono_ns, (long long)rec.value);
+    }
+
+    std::vector<Slot> m_slots;
+    unsigned long m_mask;
+    std::atomic<unsigned long> m_head;
+    std::atomic<unsigned long> m_tail;
+    std::atomic<unsigned long long> m_dropped;
+
+    std::map<uint32_t, std::string> m_kind_names;
+    FILE *m_fp;
+    Format m_format;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+};
+
+} // namespace DAQMW
+
+#endif // TIMINGRECORDER_H
@@ -14,24 +14,84 @@
  */
 
 #include "DAQServiceSVC_impl.h"
+#include <poll.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/time.h>
 /*
  * Example implementational code for IDL interface DAQService
  */
 DAQServiceSVC_impl::DAQServiceSVC_impl()
-    : m_command(CMD_NOP),
-      m_new(0),
-      m_done(DONE),
+    : m_cmd_head(0),
+      m_cmd_tail(0),
+      m_done_seq(0),
+      m_done_command(CMD_NOP),
+      m_done_rejected(false),
+      m_done_sec(0),
+      m_done_usec(0),
+      m_current_seq(0),
+      m_current_command(CMD_NOP),
+      m_current_rejected(false),
       m_state(LOADED),
       m_run_no(0),
-      m_hb_msg(DEAD),
       m_hb_new(0),
-      m_send_count(0)
+      m_hb_count(0),
+      m_send_count(0),
+      m_wakeup_fd(-1)
 {
     // Please add extra constructor code here.
+    m_metrics.comp_name = CORBA::string_dup("");
+    m_metrics.state = LOADED;
+    m_metrics.event_num = 0;
+    m_metrics.byte_size = 0;
+    m_metrics.event_rate = 0.0;
+    m_metrics.byte_rate = 0.0;
+    m_metrics.run_count = 0;
+    for (int i = 0; i < RUN_HIST_SIZE; i++)
+    {
+        m_metrics.run_hist[i] = 0;
+    }
+    m_metrics.inport_timeout = 0;
+    m_metrics.outport_timeout = 0;
+    m_metrics.seq_gap = 0;
+    m_metrics.seq_gap_frames = 0;
+    m_metrics.seq_gap_max = 0;
+    m_metrics.stall_count = 0;
+    m_metrics.stall_usec = 0;
+    m_metrics.drop_count = 0;
+    m_metrics.port_buffer.length(0);
+    m_metrics.output_drops.length(0);
+    m_metrics.incomplete_events = 0;
+    m_metrics.late_fragments = 0;
+    m_metrics.compress_ratio = 0.0;
+    m_metrics.codec_byte_rate = 0.0;
+    for (unsigned int i = 0; i < CMD_QUEUE_SIZE; i++)
+    {
+        m_cmd_queue[i].turn.store(i, std::memory_order_relaxed);
+        m_cmd_queue[i].command = CMD_NOP;
+        m_cmd_queue[i].seq = 0;
+        m_cmd_queue[i].time.tv_sec = 0;
+        m_cmd_queue[i].time.tv_nsec = 0;
+    }
+    m_start.sec = 0;
+    m_start.usec = 0;
+    m_current_time.tv_sec = 0;
+    m_current_time.tv_nsec = 0;
+    m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeup_fd < 0)
+    {
+        perror("DAQServiceSVC_impl: eventfd");
+    }
 }
 DAQServiceSVC_impl::~DAQServiceSVC_impl()
 {
     // Please add extra destructor code here.
+    if (m_wakeup_fd >= 0)
+    {
+        close(m_wakeup_fd);
+    }
 }
 /*
  * Methods corresponding to IDL attributes and operations
@@ -40,42 +100,177 @@ DAQLifeCycleState DAQServiceSVC_impl::getState()
 {
     return m_state;
 }
+/*
+ * Commands are queued, never overwritten.  If the component thread does
+ * not keep up and the queue is full, the command is refused with
+ * RTC_ERROR so that the caller knows it was not delivered.
+ */
 RTC::ReturnCode_t DAQServiceSVC_impl::setCommand(DAQCommand command)
 {
-    m_command = command;
-    m_new = 1;
-    m_done = UNDONE;
+    unsigned long pos = m_cmd_head.load(std::memory_order_relaxed);
+    CommandSlot *slot;
+    for (;;)
+    {
+        slot = &m_cmd_queue[pos & (CMD_QUEUE_SIZE - 1)];
+        unsigned long turn = slot->turn.load(std::memory_order_acquire);
+        long diff = (long)turn - (long)pos;
+        if (diff == 0)
+        {
+            if (m_cmd_head.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            std::cerr << "### ERROR: setCommand: command queue full, command "
+                      << command << " refused" << std::endl;
+            return RTC::RTC_ERROR;
+        }
+        else
+        {
+            pos = m_cmd_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &slot->time);
+    slot->command = command;
+    slot->seq = pos + 1;
+    slot->turn.store(pos + 1, std::memory_order_release);
     ///std::cerr << "UNDONE\n";
+    if (m_wakeup_fd >= 0)
+    {
+        uint64_t one = 1;
+        if (write(m_wakeup_fd, &one, sizeof(one)) < 0)
+        {
+            perror("DAQServiceSVC_impl::setCommand: write");
+        }
+    }
     return RTC::RTC_OK;
 }
+/*
+ * Pop one command (component thread only).  The sequence ID of the
+ * popped command is the one setDone() reports as completed.
+ */
 DAQCommand DAQServiceSVC_impl::getCommand()
 {
-    if (m_new)
+    unsigned long pos = m_cmd_tail.load(std::memory_order_relaxed);
+    CommandSlot *slot = &m_cmd_queue[pos & (CMD_QUEUE_SIZE - 1)];
+    if (slot->turn.load(std::memory_order_acquire) != pos + 1)
     {
-        m_new = 0;
-        return m_command;
-    }
-    else
         return CMD_NOP;
+    }
+    m_current_command = slot->command;
+    m_current_seq = slot->seq;
+    m_current_time = slot->time;
+    m_current_rejected = false;
+    slot->turn.store(pos + CMD_QUEUE_SIZE, std::memory_order_release);
+    m_cmd_tail.store(pos + 1, std::memory_order_relaxed);
+    return m_current_command;
 }
+/*
+ * DONE only when every accepted command has been completed.
+ */
 DAQDone DAQServiceSVC_impl::checkDone()
 {
-    return m_done;
+    if (m_done_seq.load(std::memory_order_acquire) ==
+        (CORBA::ULong)m_cmd_head.load(std::memory_order_acquire))
+    {
+        return DONE;
+    }
+    return UNDONE;
+}
+/*
+ * Long poll for the operator: returns as soon as the component thread
+ * calls setDone() for the last accepted command.  The wait is capped at
+ * WAIT_DONE_MAX_MSEC so that an ORB thread is not held forever, the
+ * operator calls again until its own deadline.
+ */
+DAQDone DAQServiceSVC_impl::waitDone(CORBA::ULong timeout_msec)
+{
+    if (timeout_msec > WAIT_DONE_MAX_MSEC)
+    {
+        timeout_msec = WAIT_DONE_MAX_MSEC;
+    }
+    std::unique_lock<std::mutex> lock(m_done_mutex);
+    m_done_cond.wait_for(lock, std::chrono::milliseconds(timeout_msec),
+                         [this] { return checkDone() == DONE; });
+    return checkDone();
+}
+DoneStatus DAQServiceSVC_impl::getDoneStatus()
+{
+    DoneStatus mydone;
+    CORBA::ULong seq;
+    do
+    {
+        seq = m_done_seq.load(std::memory_order_acquire);
+        mydone.done_command = (DAQCommand)m_done_command.load(std::memory_order_relaxed);
+        mydone.done_time.sec = m_done_sec.load(std::memory_order_relaxed);
+        mydone.done_time.usec = m_done_usec.load(std::memory_order_relaxed);
+        mydone.rejected = m_done_rejected.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (seq != m_done_seq.load(std::memory_order_relaxed));
+    mydone.done_seq = seq;
+    mydone.issued_seq = m_cmd_head.load(std::memory_order_acquire);
+    return mydone;
+}
+/*
+ * The popped command was refused by the state machine, setDone()
+ * reports it as done and rejected.
+ */
+void DAQServiceSVC_impl::setRejected()
+{
+    m_current_rejected = true;
 }
 void DAQServiceSVC_impl::setDone()
 {
-    m_done = DONE;
+    struct timeval now;
+    gettimeofday(&now, 0);
+    m_done_command.store(m_current_command, std::memory_order_relaxed);
+    m_done_sec.store(now.tv_sec, std::memory_order_relaxed);
+    m_done_usec.store(now.tv_usec, std::memory_order_relaxed);
+    m_done_rejected.store(m_current_rejected, std::memory_order_relaxed);
+    m_done_seq.store(m_current_seq, std::memory_order_release);
+    {
+        // taken after the store, a waiter cannot miss the notify
+        std::lock_guard<std::mutex> lock(m_done_mutex);
+    }
+    m_done_cond.notify_all();
 }
+/*
+ * Status and fatal status hold strings the component thread replaces
+ * every status cycle while the ORB threads copy them, both under
+ * m_status_mutex.
+ */
 void DAQServiceSVC_impl::setStatus(const Status &stat)
 {
+    std::lock_guard<std::mutex> lock(m_status_mutex);
     m_status = stat;
 }
 Status *DAQServiceSVC_impl::getStatus()
 {
     Status *mystatus = new Status;
+    std::lock_guard<std::mutex> lock(m_status_mutex);
     *mystatus = m_status;
     return mystatus;
 }
+/*
+ * The component thread publishes its metrics once per status cycle,
+ * so the lock is never taken on the data path.
+ */
+void DAQServiceSVC_impl::setMetrics(const Metrics &metrics)
+{
+    std::lock_guard<std::mutex> lock(m_metrics_mutex);
+    m_metrics = metrics;
+}
+Metrics *DAQServiceSVC_impl::getMetrics()
+{
+    Metrics *mymetrics = new Metrics;
+    std::lock_guard<std::mutex> lock(m_metrics_mutex);
+    *mymetrics = m_metrics;
+    return mymetrics;
+}
 void DAQServiceSVC_impl::setCompParams(const NVList &comp_params)
 {
     m_comp_params = comp_params;
@@ -95,28 +290,47 @@ CORBA::Long DAQServiceSVC_impl::getRunNo()
 void DAQServiceSVC_impl::setFatalStatus(const FatalErrorStatus &fatalStatus)
 {
     std::cerr << "### setFatalStatus:" << fatalStatus.fatalTypes << std::endl;
+    std::lock_guard<std::mutex> lock(m_status_mutex);
     m_fatalStatus = fatalStatus;
 }
 FatalErrorStatus *DAQServiceSVC_impl::getFatalStatus()
 {
     FatalErrorStatus *myfatal = new FatalErrorStatus;
+    std::lock_guard<std::mutex> lock(m_status_mutex);
     *myfatal = m_fatalStatus;
     return myfatal;
 }
 void DAQServiceSVC_impl::setHB() // Usually zero
 {
-    m_hb_new = 1;
-    m_hb_msg = LIVE;
+    m_hb_new.store(1, std::memory_order_release);
+    m_hb_count.fetch_add(1, std::memory_order_relaxed);
 }
 HBMSG DAQServiceSVC_impl::getHB()
 {
-    if (m_hb_new)
+    if (m_hb_new.exchange(0, std::memory_order_acq_rel))
     {
-        m_hb_new = 0;
-        return m_hb_msg;
+        return LIVE;
     }
     return DEAD;
 }
+/*
+ * One reply for the periodic polling of the operator instead of
+ * getStatus(), getFatalStatus(), getHB() and the send count calls.
+ * The heartbeat is a counter, the operator compares it with the one it
+ * saw last, so nothing is consumed here.
+ */
+Snapshot *DAQServiceSVC_impl::getSnapshot()
+{
+    Snapshot *mysnapshot = new Snapshot;
+    {
+        std::lock_guard<std::mutex> lock(m_status_mutex);
+        mysnapshot->status = m_status;
+        mysnapshot->fatal_status = m_fatalStatus;
+    }
+    mysnapshot->hb_count = m_hb_count.load(std::memory_order_relaxed);
+    mysnapshot->done = getDoneStatus();
+    return mysnapshot;
+}
 RTC::ReturnCode_t DAQServiceSVC_impl::setTime(const TimeVal &now)
 {
     m_start = now;
@@ -124,20 +338,67 @@ RTC::ReturnCode_t DAQServiceSVC_impl::setTime(const TimeVal &now)
 }
 TimeVal DAQServiceSVC_impl::getTime()
 {
-    TimeVal *start_time = new TimeVal;
-    *start_time = m_start;
-    return *start_time;
+    return m_start;
+}
+/*
+ * Block the component thread until setCommand() is called or
+ * timeout_usec has passed.  Returns true if a new command is pending.
+ * Used by DaqComponentBase in event driven mode instead of usleep().
+ */
+bool DAQServiceSVC_impl::waitCommand(int timeout_usec)
+{
+    if (hasCommand())
+    {
+        return true;
+    }
+    if (m_wakeup_fd < 0)
+    {
+        usleep(timeout_usec);
+        return hasCommand();
+    }
+
+    struct pollfd pfd;
+    pfd.fd = m_wakeup_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ret = poll(&pfd, 1, timeout_usec / 1000);
+    if (ret > 0 && (pfd.revents & POLLIN))
+    {
+        uint64_t count;
+        if (read(m_wakeup_fd, &count, sizeof(count)) < 0)
+        {
+            perror("DAQServiceSVC_impl::waitCommand: read");
+        }
+    }
+    return hasCommand();
+}
+bool DAQServiceSVC_impl::hasCommand()
+{
+    unsigned long pos = m_cmd_tail.load(std::memory_order_relaxed);
+    CommandSlot *slot = &m_cmd_queue[pos & (CMD_QUEUE_SIZE - 1)];
+    return slot->turn.load(std::memory_order_acquire) == pos + 1;
+}
+/*
+ * Elapsed time in usec since setCommand() of the command last popped by
+ * getCommand() (CLOCK_MONOTONIC, component thread only).
+ */
+long DAQServiceSVC_impl::getCommandElapsedUsec()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - m_current_time.tv_sec) * 1000000
+           + (now.tv_nsec - m_current_time.tv_nsec) / 1000;
 }
 void DAQServiceSVC_impl::reset_send_count()
 {
-    m_send_count = 0;
+    m_send_count.store(0, std::memory_order_relaxed);
 }
 void DAQServiceSVC_impl::inc_send_count()
 {
-    m_send_count++;
+    m_send_count.fetch_add(1, std::memory_order_relaxed);
 }
 CORBA::Short DAQServiceSVC_impl::get_send_count()
 {
-    return m_send_count;
+    return m_send_count.load(std::memory_order_relaxed);
 }
 // End of example implementational code
\ No newline at end of file
@@ -16,6 +16,10 @@
 #include "DAQServiceSkel.h"
 #include <iostream>
 //#include <memory>
+#include <time.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <rtm/CORBA_SeqUtil.h>
 
 #ifndef DAQSERVICESVC_IMPL_H
@@ -43,9 +47,14 @@ class DAQServiceSVC_impl
 	RTC::ReturnCode_t setCommand(DAQCommand command);
 	DAQCommand getCommand();
 	DAQDone checkDone();
+	DAQDone waitDone(CORBA::ULong timeout_msec);
+	DoneStatus getDoneStatus();
 	void setDone();
+	void setRejected(); // before setDone(): the command is not a legal transition
 	void setStatus(const Status &stat);
 	Status *getStatus();
+	void setMetrics(const Metrics &metrics);
+	Metrics *getMetrics();
 	void setCompParams(const NVList &comp_params);
 	NVList *getCompParams();
 	void setRunNo(const CORBA::Long run_no);
@@ -57,6 +66,8 @@ class DAQServiceSVC_impl
 	void setHB();
 	HBMSG getHB();
 
+	Snapshot *getSnapshot();
+
 	// Heartbeat unreachable count
 	void reset_send_count();
 	void inc_send_count();
@@ -66,21 +77,60 @@ class DAQServiceSVC_impl
 	RTC::ReturnCode_t setTime(const TimeVal &now);
 	TimeVal getTime();
 
+	// Event driven wakeup of the component thread
+	bool waitCommand(int timeout_usec);
+	bool hasCommand();
+	long getCommandElapsedUsec();
+
   private:
-	DAQCommand m_command;
-	short m_new;
-	DAQDone m_done;
+	/*
+	 * Command mailbox: bounded MPSC queue (ORB threads push in
+	 * setCommand(), the component thread pops in getCommand()).
+	 * Each slot carries a turn counter so producers and the consumer
+	 * hand over a slot with acquire/release ordering and no lock.
+	 */
+	static const unsigned int CMD_QUEUE_SIZE = 16; // power of 2
+	struct CommandSlot
+	{
+		std::atomic<unsigned long> turn;
+		DAQCommand command;
+		CORBA::ULong seq;
+		struct timespec time; // CLOCK_MONOTONIC at setCommand()
+	};
+	CommandSlot m_cmd_queue[CMD_QUEUE_SIZE];
+	std::atomic<unsigned long> m_cmd_head; // next slot to push (= issued seq)
+	std::atomic<unsigned long> m_cmd_tail; // next slot to pop
+	std::atomic<CORBA::ULong> m_done_seq;
+	std::atomic<int> m_done_command;
+	std::atomic<bool> m_done_rejected;
+	std::atomic<long> m_done_sec;
+	std::atomic<long> m_done_usec;
+	// waitDone() sleeps on m_done_cond, setDone() wakes it
+	static const CORBA::ULong WAIT_DONE_MAX_MSEC = 10000; // per call
+	std::mutex m_done_mutex;
+	std::condition_variable m_done_cond;
+
+	CORBA::ULong m_current_seq;	 // component thread only
+	DAQCommand m_current_command; // component thread only
+	bool m_current_rejected;      // component thread only
+	struct timespec m_current_time; // component thread only
+
 	DAQLifeCycleState m_state;
 	Status m_status;
+	Metrics m_metrics;
+	std::mutex m_metrics_mutex; // set once per status cycle
 	FatalErrorStatus m_fatalStatus;
+	std::mutex m_status_mutex; // m_status and m_fatalStatus
 	NVList m_comp_params;
 	CORBA::Long m_run_no;
 
-	HBMSG m_hb_msg;
-	short m_hb_new;
-	CORBA::Short m_send_count;
+	std::atomic<short> m_hb_new;
+	std::atomic<unsigned long> m_hb_count;
+	std::atomic<short> m_send_count;
 
 	TimeVal m_start;
+
+	int m_wakeup_fd;
 };
 
 #endif // DAQSERVICESVC_IMPL_H
\ No newline at end of file
@@ -0,0 +1,132 @@
+// -*- C++ -*-
+/*!
+ * @file test_dataflow_stages.cpp
+ * @brief Unit test of DataFlowStages.h (DaqOperator)
+ *
+ * Edges are (upstream index, downstream index) like DaqOperator builds
+ * them from the inPorts of the configuration file.  stages[0] are the
+ * sinks, started first.
+ */
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "DataFlowStages.h"
+
+using namespace std;
+
+typedef vector<pair<int, int> > Edges;
+typedef vector<vector<int> > Stages;
+
+static int n_fail = 0;
+
+static void check(bool cond, const char *what)
+{
+    if (cond) {
+        return;
+    }
+    n_fail++;
+    if (n_fail <= 10) {
+        cerr << "### ERROR: " << what << endl;
+    }
+}
+
+static Stages make_stages(const char *s0, const char *s1 = 0,
+                          const char *s2 = 0, const char *s3 = 0)
+{
+    const char *spec[] = {s0, s1, s2, s3};
+    Stages stages;
+    for (int i = 0; i < 4 && spec[i] != 0; i++) {
+        vector<int> stage;
+        for (const char *p = spec[i]; *p; p++) {
+            stage.push_back(*p - '0');
+        }
+        stages.push_back(stage);
+    }
+    return stages;
+}
+
+/// reader 0 -> filter 1 -> logger 2
+static void test_chain()
+{
+    Edges edges;
+    edges.push_back(make_pair(0, 1));
+    edges.push_back(make_pair(1, 2));
+    Stages stages;
+    check(build_dataflow_stages(3, edges, stages), "chain rejected");
+    check(stages == make_stages("2", "1", "0"), "chain stages");
+}
+
+/// reader 0 -> dispatcher 1 -> logger 2, monitor 3
+/// readers 0, 1 -> merger 2 -> logger 3
+static void test_fan_out_fan_in()
+{
+    Edges edges;
+    edges.push_back(make_pair(0, 1));
+    edges.push_back(make_pair(1, 2));
+    edges.push_back(make_pair(1, 3));
+    Stages stages;
+    check(build_dataflow_stages(4, edges, stages), "fan-out rejected");
+    check(stages == make_stages("23", "1", "0"), "fan-out stages");
+
+    edges.clear();
+    edges.push_back(make_pair(0, 2));
+    edges.push_back(make_pair(1, 2));
+    edges.push_back(make_pair(2, 3));
+    check(build_dataflow_stages(4, edges, stages), "fan-in rejected");
+    check(stages == make_stages("3", "2", "01"), "fan-in stages");
+
+    // a path of a different length: 0 -> 1 -> 3 and 0 -> 3
+    edges.clear();
+    edges.push_back(make_pair(0, 1));
+    edges.push_back(make_pair(1, 3));
+    edges.push_back(make_pair(0, 3));
+    edges.push_back(make_pair(2, 3));
+    check(build_dataflow_stages(4, edges, stages), "diamond rejected");
+    check(stages == make_stages("3", "12", "0"), "diamond stages");
+
+    // no edges: one stage
+    edges.clear();
+    check(build_dataflow_stages(3, edges, stages), "no edges rejected");
+    check(stages == make_stages("012"), "no edges stages");
+}
+
+static void test_invalid()
+{
+    Edges edges;
+    edges.push_back(make_pair(0, 1));
+    edges.push_back(make_pair(1, 2));
+    edges.push_back(make_pair(2, 1)); // cycle 1 <-> 2
+    edges.push_back(make_pair(2, 3));
+    Stages stages = make_stages("0");
+    check(!build_dataflow_stages(4, edges, stages), "cycle accepted");
+    check(stages.empty(), "stages of a cycle");
+
+    edges.clear();
+    edges.push_back(make_pair(0, 0));
+    check(!build_dataflow_stages(1, edges, stages), "self loop accepted");
+
+    edges.clear();
+    edges.push_back(make_pair(0, 3));
+    check(!build_dataflow_stages(3, edges, stages), "edge out of range accepted");
+    check(stages.empty(), "stages of an edge out of range");
+
+    edges.clear();
+    edges.push_back(make_pair(-1, 0));
+    check(!build_dataflow_stages(3, edges, stages), "negative index accepted");
+}
+
+int main(int argc, char** argv)
+{
+    test_chain();
+    test_fan_out_fan_in();
+    test_invalid();
+
+    if (n_fail > 0) {
+        cout << "test_dataflow_stages: " << n_fail << " failures" << endl;
+        return 1;
+    }
+    cout << "test_dataflow_stages: OK" << endl;
+    return 0;
+}
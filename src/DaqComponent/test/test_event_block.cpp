@@ -0,0 +1,174 @@
+// -*- C++ -*-
+/*!
+ * @file test_event_block.cpp
+ * @brief Unit test of EventBlock.h
+ *
+ * Builds blocks in a plain buffer the way DaqComponentBase does in the
+ * OutPort data (reserve_block_event(), commit_block_event(),
+ * commit_block()) and reads them back with EventBlockReader.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "EventBlock.h"
+
+using namespace DAQMW;
+using namespace std;
+
+static int n_fail = 0;
+
+static void check(bool cond, const char *what)
+{
+    if (cond) {
+        return;
+    }
+    n_fail++;
+    if (n_fail <= 10) {
+        cerr << "### ERROR: " << what << endl;
+    }
+}
+
+static unsigned int event_size(unsigned int n)
+{
+    return (n * 13) % 200; // includes empty events
+}
+
+/// payload of one block: events n0 ... n0 + event_num - 1
+struct Block
+{
+    vector<unsigned char> payload;
+    unsigned int resized;   // times the buffer had to grow
+};
+
+static void add_event(Block &b, EventBlockWriter &writer, unsigned int n,
+                      unsigned int max_event_byte_size)
+{
+    unsigned int pos = writer.event_byte_size();
+    if (pos + max_event_byte_size > b.payload.size()) {
+        b.payload.resize(writer.reserve_byte_size(max_event_byte_size));
+        b.resized++;
+    }
+    for (unsigned int i = 0; i < event_size(n); i++) {
+        b.payload[pos + i] = (unsigned char)(n + i);
+    }
+    writer.add(event_size(n));
+}
+
+/// like commit_block(), which sizes the frame for the index
+static void close_block(Block &b, EventBlockWriter &writer)
+{
+    b.payload.resize(writer.block_byte_size());
+    writer.write_index(&b.payload[writer.event_byte_size()]);
+    writer.reset();
+}
+
+static void check_block(const Block &b, unsigned int n0, unsigned int event_num)
+{
+    EventBlockReader reader(&b.payload[0], b.payload.size());
+    check(reader.is_valid(), "block invalid");
+    check(reader.event_num() == event_num, "event count");
+    unsigned int n = n0;
+    for (EventBlockReader::iterator it = reader.begin(); it != reader.end(); ++it) {
+        check(it->size == event_size(n), "event size");
+        bool same = true;
+        for (unsigned int i = 0; i < it->size; i++) {
+            same = same && it->data[i] == (unsigned char)(n + i);
+        }
+        check(same, "event data");
+        n++;
+    }
+    check(n == n0 + event_num, "events iterated");
+}
+
+/// blocks closed by max_events and max_bytes, buffer sized once per block
+static void test_policy()
+{
+    EventBlockPolicy policy = {16, 1000, 0};
+    EventBlockWriter writer;
+    writer.set_policy(policy);
+
+    unsigned int n = 0;
+    for (int i = 0; i < 100; i++) {
+        Block b;
+        b.resized = 0;
+        unsigned int n0 = n;
+        while (!writer.flush_due()) {
+            add_event(b, writer, n, 200);
+            n++;
+        }
+        check(writer.event_num() <= policy.max_events, "max_events passed");
+        check(writer.event_byte_size() < policy.max_bytes + 200, "max_bytes passed");
+        check(b.resized == 1, "buffer resized more than once per block");
+        check(writer.block_byte_size() <= b.payload.size(), "index does not fit");
+        unsigned int event_num = writer.event_num();
+        close_block(b, writer);
+        check_block(b, n0, event_num);
+    }
+}
+
+/// no limits but the time: the buffer grows, the block stays valid
+static void test_no_policy()
+{
+    EventBlockWriter writer;
+    Block b;
+    b.resized = 0;
+    for (unsigned int n = 0; n < 500; n++) {
+        add_event(b, writer, n, event_size(n));
+    }
+    check(!writer.flush_due(), "flush without policy");
+    close_block(b, writer);
+    check_block(b, 0, 500);
+
+    Block empty;
+    empty.resized = 0;
+    close_block(empty, writer);
+    check_block(empty, 0, 0);
+}
+
+/// corrupted index or count is rejected
+static void test_invalid()
+{
+    EventBlockWriter writer;
+    Block b;
+    b.resized = 0;
+    for (unsigned int n = 1; n < 10; n++) {
+        add_event(b, writer, n, event_size(n));
+    }
+    close_block(b, writer);
+    check_block(b, 1, 9);
+
+    Block bad = b;
+    bad.payload[bad.payload.size() - 1]++; // event count
+    check(!EventBlockReader(&bad.payload[0], bad.payload.size()).is_valid(),
+          "wrong event count accepted");
+
+    bad = b;
+    unsigned int index_pos = bad.payload.size() - 10 * EVENT_BLOCK_WORD_SIZE;
+    bad.payload[index_pos + 3]++; // size of the first event
+    check(!EventBlockReader(&bad.payload[0], bad.payload.size()).is_valid(),
+          "wrong event size accepted");
+
+    bad = b;
+    EventBlockWriter::put_word(&bad.payload[bad.payload.size() - 4], 0xffffffff);
+    check(!EventBlockReader(&bad.payload[0], bad.payload.size()).is_valid(),
+          "huge event count accepted");
+
+    unsigned char short_payload[2] = {0, 0};
+    check(!EventBlockReader(short_payload, sizeof(short_payload)).is_valid(),
+          "short payload accepted");
+}
+
+int main(int argc, char** argv)
+{
+    test_policy();
+    test_no_policy();
+    test_invalid();
+
+    if (n_fail > 0) {
+        cout << "test_event_block: " << n_fail << " failures" << endl;
+        return 1;
+    }
+    cout << "test_event_block: OK" << endl;
+    return 0;
+}
@@ -0,0 +1,210 @@
+// -*- C++ -*-
+/*!
+ * @file test_event_merger.cpp
+ * @brief Unit test of EventMerger.h
+ *
+ * Event numbers go through extend_number() like EventBuilder does with
+ * the 32-bit footer sequence number or a narrow trigger counter, so the
+ * counters are tested across their wrap around.
+ */
+
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+
+#include "EventMerger.h"
+
+using namespace DAQMW;
+using namespace std;
+
+static int n_fail = 0;
+
+static void check(bool cond, const char *what)
+{
+    if (cond) {
+        return;
+    }
+    n_fail++;
+    if (n_fail <= 10) {
+        cerr << "### ERROR: " << what << endl;
+    }
+}
+
+/// fragment of input for event n: input_num bytes (n + input)
+static int add_fragment(EventMerger &merger, unsigned int input, uint64_t raw,
+                        unsigned int bits, uint64_t n)
+{
+    unsigned char data[4];
+    for (unsigned int i = 0; i < sizeof(data); i++) {
+        data[i] = (unsigned char)(n + input + i);
+    }
+    return merger.add(input, merger.extend_number(raw, bits), data, input + 1);
+}
+
+/**
+ * input_num inputs send events first .. first + event_num - 1 of a
+ * counter of bits width, input i lags i * skew events behind input 0.
+ * All events must come out complete, in order and numbered without gaps.
+ */
+static void run_wrap(unsigned int bits, uint64_t first, unsigned int event_num,
+                     unsigned int input_num, unsigned int skew, const char *what)
+{
+    EventMerger merger;
+    merger.init(input_num, 0);
+    uint64_t mask = (bits >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << bits) - 1);
+
+    bool ok = true;
+    uint64_t expect = first;
+    unsigned int lag = (input_num - 1) * skew;
+    for (unsigned int step = 0; step < event_num + lag; step++) {
+        for (unsigned int input = 0; input < input_num; input++) {
+            if (step < input * skew || step - input * skew >= event_num) {
+                continue;
+            }
+            uint64_t n = first + step - input * skew;
+            ok = ok && add_fragment(merger, input, n & mask, bits, n) == EventMerger::ADD_OK;
+        }
+        while (const EventMerger::Event *ev = merger.ready()) {
+            ok = ok && ev->is_complete() && ev->number() == expect;
+            for (unsigned int input = 0; ok && input < input_num; input++) {
+                ok = ev->fragment_byte_size(input) == input + 1
+                     && ev->fragment(input)[0] == (unsigned char)(expect + input);
+            }
+            merger.pop();
+            expect++;
+        }
+    }
+    ok = ok && expect == first + event_num && merger.pending() == 0
+         && merger.get_complete() == event_num && merger.get_incomplete() == 0
+         && merger.get_late() == 0;
+    check(ok, what);
+}
+
+static void test_wrap()
+{
+    run_wrap(32, 0xffffff00ULL, 1000, 2, 3, "32-bit counter wrap");
+    run_wrap(32, 0xfffffff0ULL, 100, 4, 1, "32-bit counter wrap, 4 inputs");
+    run_wrap(8, 200, 1000, 3, 5, "8-bit counter wrap");
+    run_wrap(8, 0, 300, 2, 100, "8-bit counter, lag of 100 events");
+}
+
+/// a fragment of an event sent before the wrap arrives after it
+static void test_late_after_wrap()
+{
+    EventMerger merger;
+    merger.init(2, 0);
+    for (uint64_t n = 0xfffffffcULL; n < 0x100000004ULL; n++) {
+        add_fragment(merger, 0, n & 0xffffffff, 32, n);
+        add_fragment(merger, 1, n & 0xffffffff, 32, n);
+        while (merger.ready()) {
+            merger.pop();
+        }
+    }
+    check(merger.get_complete() == 8, "events across the wrap");
+
+    int ret = add_fragment(merger, 1, 0xfffffffeULL, 32, 0xfffffffeULL);
+    check(ret == EventMerger::ADD_LATE, "fragment from before the wrap not late");
+    check(merger.get_late() == 1, "late count");
+    check(merger.pending() == 0, "late fragment started an event");
+
+    // the next number after the wrap is still new
+    ret = add_fragment(merger, 0, 4, 32, 0x100000004ULL);
+    check(ret == EventMerger::ADD_OK, "event after the wrap");
+    check(merger.front() != 0 && merger.front()->number() == 0x100000004ULL,
+          "number after the wrap extended");
+
+    // a number before the first one extended
+    EventMerger first;
+    first.init(1, 0);
+    check(first.extend_number(1000, 32) == 1000, "first number");
+    check(first.extend_number(990, 32) == 990, "earlier number");
+    check(first.extend_number(0xfffffff0ULL, 32) == 0, "number before the first one");
+}
+
+static void test_duplicate()
+{
+    EventMerger merger;
+    merger.init(3, 0);
+    unsigned char data[1] = {0};
+    check(merger.add(0, 10, data, 1) == EventMerger::ADD_OK, "first fragment");
+    check(merger.add(0, 10, data, 1) == EventMerger::ADD_DUPLICATE, "duplicate accepted");
+    check(merger.add(3, 10, data, 1) == EventMerger::ADD_BAD_INPUT, "bad input accepted");
+    check(merger.get_duplicate() == 1, "duplicate count");
+    const EventMerger::Event *ev = merger.front();
+    check(ev != 0 && ev->fragment_num() == 1 && ev->byte_size() == 1,
+          "duplicate changed the event");
+    check(merger.ready() == 0, "incomplete event ready");
+
+    merger.add(1, 10, data, 1);
+    merger.add(2, 10, data, 1);
+    check(merger.ready() != 0, "complete event not ready");
+    merger.pop();
+    check(merger.add(2, 10, data, 1) == EventMerger::ADD_LATE, "fragment of a sent event");
+}
+
+/// input 1 is silent: the oldest event is released beyond max_pending
+static void test_max_pending()
+{
+    EventMerger merger;
+    merger.init(2, 0, 4);
+    unsigned char data[1] = {0};
+    for (uint64_t n = 0; n < 4; n++) {
+        merger.add(0, n, data, 1);
+    }
+    check(merger.ready() == 0, "released at max_pending");
+
+    // a complete event waits behind the incomplete ones
+    merger.add(0, 4, data, 1);
+    merger.add(1, 4, data, 1);
+    const EventMerger::Event *ev = merger.ready();
+    check(ev != 0 && ev->number() == 0 && !ev->is_complete(),
+          "oldest event not released beyond max_pending");
+    check(ev != 0 && !ev->has_fragment(1) && ev->fragment_byte_size(1) == 0,
+          "missing fragment");
+    merger.pop();
+    check(merger.ready() == 0, "released below max_pending");
+    check(merger.get_incomplete() == 1, "incomplete count");
+
+    // late input 1 fragments of the pending events complete them
+    for (uint64_t n = 1; n < 4; n++) {
+        merger.add(1, n, data, 1);
+    }
+    uint64_t expect = 1;
+    while ((ev = merger.ready()) != 0) {
+        check(ev->number() == expect && ev->is_complete(), "order after release");
+        merger.pop();
+        expect++;
+    }
+    check(expect == 5, "events after release");
+    check(merger.add(1, 0, data, 1) == EventMerger::ADD_LATE, "fragment of a released event");
+}
+
+static void test_timeout()
+{
+    EventMerger merger;
+    merger.init(2, 2000);
+    unsigned char data[1] = {0};
+    merger.add(0, 1, data, 1);
+    check(merger.ready() == 0, "released before the timeout");
+    usleep(5000);
+    const EventMerger::Event *ev = merger.ready();
+    check(ev != 0 && !ev->is_complete(), "not released after the timeout");
+    merger.pop();
+    check(merger.get_incomplete() == 1, "incomplete count after timeout");
+}
+
+int main(int argc, char** argv)
+{
+    test_wrap();
+    test_late_after_wrap();
+    test_duplicate();
+    test_max_pending();
+    test_timeout();
+
+    if (n_fail > 0) {
+        cout << "test_event_merger: " << n_fail << " failures" << endl;
+        return 1;
+    }
+    cout << "test_event_merger: OK" << endl;
+    return 0;
+}
@@ -0,0 +1,206 @@
+// -*- C++ -*-
+/*!
+ * @file test_event_scan.cpp
+ * @brief Unit test of EventScan.h
+ *
+ * Every buffer is scanned by scan_frames() (the SSE2 path where the
+ * compiler has SSE2) and by scan_frames_scalar(); both must give the
+ * expected EventScanResult and frame offsets.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "EventScan.h"
+
+using namespace DAQMW;
+using namespace std;
+
+static int n_fail = 0;
+
+static void check(bool cond, const char *what)
+{
+    if (cond) {
+        return;
+    }
+    n_fail++;
+    if (n_fail <= 10) {
+        cerr << "### ERROR: " << what << endl;
+    }
+}
+
+static void put_be32(unsigned char *p, unsigned int val)
+{
+    p[0] = (val >> 24) & 0xff;
+    p[1] = (val >> 16) & 0xff;
+    p[2] = (val >> 8) & 0xff;
+    p[3] = val & 0xff;
+}
+
+static unsigned int event_size(unsigned int n)
+{
+    return (n * 29) % 100; // includes empty events
+}
+
+/// frames n = 0 ... frame_num - 1 with footer sequence first_seq + n
+struct Frames
+{
+    vector<unsigned char> buf;
+    vector<unsigned int> offsets;
+};
+
+static Frames make_frames(unsigned int frame_num, unsigned int first_seq)
+{
+    Frames f;
+    for (unsigned int n = 0; n < frame_num; n++) {
+        unsigned int pos = f.buf.size();
+        unsigned int size = event_size(n);
+        f.offsets.push_back(pos);
+        f.buf.resize(pos + SCAN_HEADER_BYTE_SIZE + size + SCAN_FOOTER_BYTE_SIZE);
+        unsigned char *header = &f.buf[pos];
+        header[0] = SCAN_HEADER_MAGIC;
+        header[1] = SCAN_HEADER_MAGIC;
+        header[2] = 0;
+        header[3] = 0;
+        put_be32(&header[4], size);
+        for (unsigned int i = 0; i < size; i++) {
+            header[SCAN_HEADER_BYTE_SIZE + i] = (unsigned char)(n + i);
+        }
+        unsigned char *footer = &f.buf[pos + SCAN_HEADER_BYTE_SIZE + size];
+        footer[0] = SCAN_FOOTER_MAGIC;
+        footer[1] = SCAN_FOOTER_MAGIC;
+        footer[2] = 0;
+        footer[3] = 0;
+        put_be32(&footer[4], first_seq + n);
+    }
+    return f;
+}
+
+static unsigned char *footer_of(Frames &f, unsigned int n)
+{
+    return &f.buf[f.offsets[n] + SCAN_HEADER_BYTE_SIZE + event_size(n)];
+}
+
+/// both paths: error at frame bad (bad == frame_num: no error)
+static void expect(const Frames &f, unsigned int len, bool check_seq,
+                   unsigned int first_seq, int error, unsigned int bad,
+                   const char *what)
+{
+    for (int path = 0; path < 2; path++) {
+        EventScanResult res;
+        vector<unsigned int> offsets;
+        if (path == 0) {
+            scan_frames(f.buf.data(), len, &offsets, check_seq, first_seq, &res);
+        }
+        else {
+            scan_frames_scalar(f.buf.data(), len, &offsets, check_seq, first_seq, &res);
+        }
+        bool ok = res.error == error && res.event_num == bad
+                  && offsets.size() == bad;
+        for (unsigned int n = 0; ok && n < bad; n++) {
+            ok = offsets[n] == f.offsets[n];
+        }
+        unsigned int bad_offset = bad < f.offsets.size() ? f.offsets[bad] : len;
+        ok = ok && res.byte_size == bad_offset;
+        if (error != SCAN_OK) {
+            ok = ok && res.error_offset == bad_offset;
+        }
+        if (!ok) {
+            cerr << (path == 0 ? "scan_frames: " : "scan_frames_scalar: ")
+                 << scan_error_string(res.error) << " event_num " << res.event_num
+                 << " error_offset " << res.error_offset << endl;
+        }
+        check(ok, what);
+    }
+}
+
+static void test_valid()
+{
+    Frames f = make_frames(50, 7);
+    expect(f, f.buf.size(), true, 7, SCAN_OK, 50, "valid frames");
+    expect(f, f.buf.size(), false, 0, SCAN_OK, 50, "valid frames, no sequence check");
+
+    Frames none = make_frames(0, 0);
+    expect(none, 0, true, 0, SCAN_OK, 0, "empty buffer");
+
+    // the footer sequence number wraps around like the 32bit counter
+    Frames wrap = make_frames(5, 0xfffffffe);
+    expect(wrap, wrap.buf.size(), true, 0xfffffffe, SCAN_OK, 5, "sequence wrap");
+}
+
+static void test_truncated()
+{
+    Frames f = make_frames(10, 0);
+    unsigned int n = 6;
+
+    // cut in the event data, in the footer and in the header of frame n
+    expect(f, f.offsets[n] + SCAN_HEADER_BYTE_SIZE + event_size(n) / 2, true, 0,
+           SCAN_TRUNCATED, n, "cut in the event data");
+    expect(f, f.offsets[n + 1] - 1, true, 0, SCAN_TRUNCATED, n, "cut in the footer");
+    expect(f, f.offsets[n] + 3, true, 0, SCAN_TRUNCATED, n, "cut in the header");
+
+    // header size larger than the rest of the buffer
+    put_be32(&f.buf[f.offsets[n] + 4], 0xffffff00);
+    expect(f, f.buf.size(), true, 0, SCAN_TRUNCATED, n, "size past the end");
+}
+
+static void test_bad_magic()
+{
+    for (int byte = 0; byte < 2; byte++) {
+        Frames f = make_frames(10, 0);
+        f.buf[f.offsets[4] + byte] = 0x00;
+        expect(f, f.buf.size(), true, 0, SCAN_BAD_HEADER_MAGIC, 4, "bad header magic");
+        expect(f, f.buf.size(), false, 0, SCAN_BAD_HEADER_MAGIC, 4,
+               "bad header magic, no sequence check");
+
+        Frames g = make_frames(10, 0);
+        footer_of(g, 7)[byte] = 0x00;
+        expect(g, g.buf.size(), true, 0, SCAN_BAD_FOOTER_MAGIC, 7, "bad footer magic");
+        expect(g, g.buf.size(), false, 0, SCAN_BAD_FOOTER_MAGIC, 7,
+               "bad footer magic, no sequence check");
+    }
+
+    // garbage with a huge size field is a bad header, not a truncated frame
+    Frames f = make_frames(3, 0);
+    f.buf[f.offsets[1]] = 0x12;
+    put_be32(&f.buf[f.offsets[1] + 4], 0xffffff00);
+    expect(f, f.buf.size(), true, 0, SCAN_BAD_HEADER_MAGIC, 1, "bad header, bad size");
+}
+
+static void test_seq_mismatch()
+{
+    Frames f = make_frames(10, 100);
+    put_be32(&footer_of(f, 5)[4], 200);
+    expect(f, f.buf.size(), true, 100, SCAN_SEQ_MISMATCH, 5, "sequence mismatch");
+    expect(f, f.buf.size(), false, 100, SCAN_OK, 10, "mismatch without sequence check");
+
+    for (int path = 0; path < 2; path++) {
+        EventScanResult res;
+        if (path == 0) {
+            scan_frames(f.buf.data(), f.buf.size(), 0, true, 100, &res);
+        }
+        else {
+            scan_frames_scalar(f.buf.data(), f.buf.size(), 0, true, 100, &res);
+        }
+        check(res.expected_seq == 105 && res.found_seq == 200, "expected/found sequence");
+    }
+
+    // first_seq other than the first footer
+    Frames g = make_frames(4, 0);
+    expect(g, g.buf.size(), true, 1, SCAN_SEQ_MISMATCH, 0, "wrong first_seq");
+}
+
+int main(int argc, char** argv)
+{
+    test_valid();
+    test_truncated();
+    test_bad_magic();
+    test_seq_mismatch();
+
+    if (n_fail > 0) {
+        cout << "test_event_scan: " << n_fail << " failures" << endl;
+        return 1;
+    }
+    cout << "test_event_scan: OK" << endl;
+    return 0;
+}
@@ -0,0 +1,193 @@
+// -*- C++ -*-
+/*!
+ * @file test_shm_ring.cpp
+ * @brief Unit test of ShmRing.h
+ *
+ * The producer and the consumer attach to one ring in /dev/shm like the
+ * OutPort and the InPort side of the shm transport, here in one process.
+ * Checks that a producer running ahead of the consumer never overwrites
+ * a record before release(), the buffer_length record limit, and the
+ * futex waits with a producer thread.
+ */
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "ShmRing.h"
+
+using namespace DAQMW;
+using namespace std;
+
+static int n_fail = 0;
+
+static void check(bool cond, const char *what)
+{
+    if (cond) {
+        return;
+    }
+    n_fail++;
+    if (n_fail <= 10) {
+        cerr << "### ERROR: " << what << endl;
+    }
+}
+
+/// record n: byte_size bytes of (n + i)
+static void fill(vector<unsigned char> &buf, unsigned int n, unsigned int byte_size)
+{
+    buf.resize(byte_size);
+    for (unsigned int i = 0; i < byte_size; i++) {
+        buf[i] = (unsigned char)(n + i);
+    }
+}
+
+static bool verify(const unsigned char *p, uint64_t byte_size, unsigned int n,
+                   unsigned int expect_size)
+{
+    if (byte_size != expect_size) {
+        return false;
+    }
+    for (unsigned int i = 0; i < byte_size; i++) {
+        if (p[i] != (unsigned char)(n + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static unsigned int record_size(unsigned int n)
+{
+    return 1 + (n * 37) % 900;
+}
+
+/// producer pushes until the ring is full while the consumer holds a record
+static void test_overrun(const string &name)
+{
+    ShmRing consumer;
+    ShmRing producer;
+    check(consumer.create(name, 4096), "create");
+    check(producer.open(name), "open");
+
+    vector<unsigned char> buf;
+    unsigned int pushed = 0;
+    unsigned int popped = 0;
+    for (int round = 0; round < 300; round++) {
+        // run ahead until full, the oldest record is peeked meanwhile
+        uint64_t byte_size = 0;
+        const unsigned char *oldest = consumer.peek(&byte_size);
+        for (;;) {
+            fill(buf, pushed, record_size(pushed));
+            if (!producer.push(&buf[0], buf.size())) {
+                break;
+            }
+            pushed++;
+            if (oldest == 0) {
+                oldest = consumer.peek(&byte_size);
+            }
+        }
+        check(oldest != 0, "ring full but nothing to peek");
+        check(!producer.has_space(record_size(pushed)), "full ring has space");
+        check(!producer.wait_space(record_size(pushed), 1000), "full ring got space");
+        check(verify(oldest, byte_size, popped, record_size(popped)),
+              "peeked record overwritten by the producer");
+
+        // drain a few, the rest stays for the next round
+        for (int i = 0; i < 3 && oldest != 0; i++) {
+            const unsigned char *p = consumer.peek(&byte_size);
+            check(p != 0 && verify(p, byte_size, popped, record_size(popped)),
+                  "record corrupted");
+            consumer.release();
+            popped++;
+        }
+    }
+    const unsigned char *p;
+    uint64_t byte_size;
+    while ((p = consumer.peek(&byte_size)) != 0) {
+        check(verify(p, byte_size, popped, record_size(popped)), "record corrupted");
+        consumer.release();
+        popped++;
+    }
+    check(popped == pushed, "records lost");
+    check(consumer.empty(), "not empty");
+    check(!consumer.wait_data(1000), "empty ring has data");
+}
+
+/// at most max_records records regardless of the free bytes
+static void test_record_limit(const string &name)
+{
+    ShmRing consumer;
+    ShmRing producer;
+    check(consumer.create(name, 1024 * 1024, 4), "create");
+    check(producer.open(name), "open");
+
+    unsigned char data[16] = {0};
+    int n = 0;
+    while (producer.push(data, sizeof(data))) {
+        n++;
+    }
+    check(n == 4, "record limit");
+    uint64_t byte_size;
+    check(consumer.peek(&byte_size) != 0, "peek");
+    consumer.release();
+    check(producer.push(data, sizeof(data)), "push after release");
+    check(!producer.push(data, sizeof(data)), "record limit after release");
+}
+
+/// producer thread with wait_space(), consumer with wait_data()
+static void test_threads(const string &name)
+{
+    static const unsigned int RECORD_NUM = 200000;
+    ShmRing consumer;
+    check(consumer.create(name, 64 * 1024, 8), "create");
+
+    std::thread producer_thread([&name] {
+        ShmRing producer;
+        if (!producer.open(name)) {
+            return;
+        }
+        vector<unsigned char> buf;
+        for (unsigned int n = 0; n < RECORD_NUM; n++) {
+            fill(buf, n, record_size(n));
+            while (!producer.push(&buf[0], buf.size())) {
+                producer.wait_space(buf.size(), 100000);
+            }
+        }
+    });
+
+    unsigned int popped = 0;
+    int idle = 0;
+    while (popped < RECORD_NUM && idle < 50) {
+        uint64_t byte_size;
+        const unsigned char *p = consumer.peek(&byte_size);
+        if (p == 0) {
+            if (!consumer.wait_data(100000)) {
+                idle++;
+            }
+            continue;
+        }
+        idle = 0;
+        check(verify(p, byte_size, popped, record_size(popped)), "record corrupted");
+        consumer.release();
+        popped++;
+    }
+    producer_thread.join();
+    check(popped == RECORD_NUM, "records lost");
+}
+
+int main(int argc, char** argv)
+{
+    string name = "/daqmw_test_" + to_string(getpid());
+
+    test_overrun(name);
+    test_record_limit(name);
+    test_threads(name);
+
+    if (n_fail > 0) {
+        cout << "test_shm_ring: " << n_fail << " failures" << endl;
+        return 1;
+    }
+    cout << "test_shm_ring: OK" << endl;
+    return 0;
+}
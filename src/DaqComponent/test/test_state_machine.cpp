@@ -0,0 +1,164 @@
+// -*- C++ -*-
+/*!
+ * @file test_state_machine.cpp
+ * @brief Unit test of DaqStateMachine.h
+ *
+ * Drives every command sequence up to MAX_DEPTH commands through
+ * DaqStateMachine and compares each step with a reference model
+ * written as the switch of DaqOperator.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "DaqStateMachine.h"
+
+using namespace DAQMW;
+using namespace std;
+
+static const int MAX_DEPTH = 7;
+static const DAQCommand ALL_COMMANDS[] = {
+    CMD_CONFIGURE, CMD_START, CMD_STOP, CMD_UNCONFIGURE,
+    CMD_PAUSE, CMD_RESUME, CMD_RESTART, CMD_NOP
+};
+static const int COMMAND_NUM = sizeof(ALL_COMMANDS) / sizeof(ALL_COMMANDS[0]);
+static const DAQLifeCycleState ALL_STATES[] = {
+    LOADED, CONFIGURED, RUNNING, PAUSED, ERRORED
+};
+static const int STATE_NUM = sizeof(ALL_STATES) / sizeof(ALL_STATES[0]);
+
+// compile time checks
+static_assert(DaqTransitionOf<LOADED, CMD_CONFIGURE>::to == CONFIGURED, "configure");
+static_assert(DaqTransitionOf<CONFIGURED, CMD_START>::to == RUNNING, "start");
+static_assert(DaqTransitionOf<RUNNING, CMD_STOP>::to == CONFIGURED, "stop");
+static_assert(DaqTransitionOf<RUNNING, CMD_STOP>::trans_lock, "stop locks");
+static_assert(DaqTransitionOf<CONFIGURED, CMD_UNCONFIGURE>::to == LOADED, "unconfigure");
+static_assert(!DaqTransitionOf<CONFIGURED, CMD_UNCONFIGURE>::trans_lock, "unconfigure");
+static_assert(DaqTransitionOf<RUNNING, CMD_PAUSE>::to == PAUSED, "pause");
+static_assert(DaqTransitionOf<RUNNING, CMD_PAUSE>::trans_lock, "pause locks");
+static_assert(DaqTransitionOf<PAUSED, CMD_RESUME>::to == RUNNING, "resume");
+static_assert(!daq_is_legal_transition(LOADED, CMD_START), "start in LOADED");
+static_assert(!daq_is_legal_transition(RUNNING, CMD_UNCONFIGURE), "unconfigure in RUNNING");
+static_assert(!daq_is_legal_transition(PAUSED, CMD_STOP), "stop in PAUSED");
+static_assert(!daq_is_legal_transition(ERRORED, CMD_STOP), "stop in ERRORED");
+static_assert(!daq_is_legal_transition(RUNNING, CMD_NOP), "nop");
+
+#ifdef TEST_ILLEGAL_TRANSITION
+// must not compile (see Makefile)
+static_assert(DaqTransitionOf<LOADED, CMD_START>::to == RUNNING, "");
+#endif
+
+/// reference: next state, or -1 for an illegal command
+static int reference_next(DAQLifeCycleState state, DAQCommand command)
+{
+    switch (state) {
+    case LOADED:
+        if (command == CMD_CONFIGURE) return CONFIGURED;
+        break;
+    case CONFIGURED:
+        if (command == CMD_START)       return RUNNING;
+        if (command == CMD_UNCONFIGURE) return LOADED;
+        break;
+    case RUNNING:
+        if (command == CMD_STOP)  return CONFIGURED;
+        if (command == CMD_PAUSE) return PAUSED;
+        break;
+    case PAUSED:
+        if (command == CMD_RESUME) return RUNNING;
+        break;
+    default:
+        break;
+    }
+    return -1;
+}
+
+static int n_fail = 0;
+
+static void check(bool cond, const char *what, const vector<DAQCommand> &seq)
+{
+    if (cond) {
+        return;
+    }
+    n_fail++;
+    if (n_fail > 10) {
+        return;
+    }
+    cerr << "### ERROR: " << what << ", sequence:";
+    for (unsigned int i = 0; i < seq.size(); i++) {
+        cerr << " " << seq[i];
+    }
+    cerr << endl;
+}
+
+static int n_legal = 0;
+static int n_illegal = 0;
+
+static void drive(DaqStateMachine sm, vector<DAQCommand> &seq)
+{
+    if ((int)seq.size() == MAX_DEPTH) {
+        return;
+    }
+    for (int c = 0; c < COMMAND_NUM; c++) {
+        DAQCommand command = ALL_COMMANDS[c];
+        DaqStateMachine next = sm;
+        seq.push_back(command);
+
+        int expect = reference_next(sm.state(), command);
+        const DaqTransition *t = next.fire(command);
+        if (expect < 0) {
+            n_illegal++;
+            check(t == 0, "illegal command accepted", seq);
+            check(next.state() == sm.state(), "illegal command changed state", seq);
+            check(next.prev_state() == sm.prev_state(), "illegal command changed prev state", seq);
+        }
+        else {
+            n_legal++;
+            check(t != 0, "legal command rejected", seq);
+            check(next.state() == expect, "wrong next state", seq);
+            check(next.prev_state() == sm.state(), "wrong prev state", seq);
+            if (t) {
+                check(t->command == command, "wrong transition entry", seq);
+                check(t->trans_lock == (command == CMD_STOP || command == CMD_PAUSE),
+                      "wrong trans lock", seq);
+            }
+            drive(next, seq);
+        }
+        seq.pop_back();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // every (state, command) pair against the reference
+    vector<DAQCommand> none;
+    for (int s = 0; s < STATE_NUM; s++) {
+        for (int c = 0; c < COMMAND_NUM; c++) {
+            bool legal = daq_is_legal_transition(ALL_STATES[s], ALL_COMMANDS[c]);
+            check(legal == (reference_next(ALL_STATES[s], ALL_COMMANDS[c]) >= 0),
+                  "daq_is_legal_transition differs from reference", none);
+        }
+    }
+
+    vector<DAQCommand> seq;
+    DaqStateMachine sm;
+    drive(sm, seq);
+
+    // a full run cycle returns to LOADED
+    sm.reset();
+    const DAQCommand cycle[] = {
+        CMD_CONFIGURE, CMD_START, CMD_PAUSE, CMD_RESUME, CMD_STOP, CMD_UNCONFIGURE
+    };
+    for (unsigned int i = 0; i < sizeof(cycle) / sizeof(cycle[0]); i++) {
+        check(sm.fire(cycle[i]) != 0, "run cycle rejected", none);
+    }
+    check(sm.state() == LOADED && sm.prev_state() == CONFIGURED,
+          "run cycle end state", none);
+
+    cout << "legal steps: " << n_legal << "  illegal steps: " << n_illegal << endl;
+    if (n_fail > 0) {
+        cout << "test_state_machine: " << n_fail << " failures" << endl;
+        return 1;
+    }
+    cout << "test_state_machine: OK" << endl;
+    return 0;
+}
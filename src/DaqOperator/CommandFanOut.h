@@ -0,0 +1,143 @@
+// -*- C++ -*-
+/*!
+ * @file CommandFanOut.h
+ * @brief Thread pool issuing DAQService commands to components concurrently
+ *
+ */
+
+#ifndef COMMANDFANOUT_H
+#define COMMANDFANOUT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * @class CommandFanOut
+ * @brief runs one task per component on worker threads and waits for all
+ *
+ * The operator hands run() a task (set command, wait done) and the number
+ * of components; the workers call task(0) ... task(n - 1) concurrently, so
+ * a transition takes as long as the slowest component instead of the sum.
+ * run() is the completion barrier.  If the barrier times out, the tasks
+ * still running finish in the background and the next run() waits for
+ * them first, so a task only has to bound its own waiting.
+ *
+ * Without start() (0 threads) run() calls the tasks one by one.
+ */
+class CommandFanOut
+{
+  public:
+    typedef std::function<void(unsigned int index)> Task;
+
+    CommandFanOut()
+        : m_task_num(0), m_next(0), m_done(0), m_stop(false)
+    {
+    }
+
+    virtual ~CommandFanOut()
+    {
+        stop();
+    }
+
+    void start(unsigned int thread_num)
+    {
+        stop();
+        m_stop = false;
+        for (unsigned int i = 0; i < thread_num; i++)
+        {
+            m_threads.emplace_back(&CommandFanOut::worker_loop, this);
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_work_cv.notify_all();
+        for (auto &t : m_threads)
+        {
+            t.join();
+        }
+        m_threads.clear();
+    }
+
+    unsigned int thread_num() const
+    {
+        return m_threads.size();
+    }
+
+    /**
+     *  Call task(i) for i in [0, task_num) and wait until all returned or
+     *  timeout_usec passed.  Returns the number of tasks not finished.
+     */
+    unsigned int run(unsigned int task_num, Task task, long long timeout_usec)
+    {
+        if (m_threads.empty())
+        {
+            for (unsigned int i = 0; i < task_num; i++)
+            {
+                task(i);
+            }
+            return 0;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done_cv.wait(lock, [this] { return m_done == m_task_num; });
+        m_task = task;
+        m_task_num = task_num;
+        m_next = 0;
+        m_done = 0;
+        m_work_cv.notify_all();
+        m_done_cv.wait_for(lock, std::chrono::microseconds(timeout_usec),
+                           [this] { return m_done == m_task_num; });
+        return m_task_num - m_done;
+    }
+
+    /// wait for the tasks of a timed out run()
+    void wait_idle()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done_cv.wait(lock, [this] { return m_done == m_task_num; });
+    }
+
+  private:
+    void worker_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_work_cv.wait(lock, [this] { return m_stop || m_next < m_task_num; });
+            if (m_next >= m_task_num)
+            { // m_stop
+                return;
+            }
+            unsigned int index = m_next++;
+            lock.unlock();
+            // m_task is not replaced before every task has returned
+            m_task(index);
+            lock.lock();
+            if (++m_done == m_task_num)
+            {
+                m_done_cv.notify_all();
+            }
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    std::vector<std::thread> m_threads;
+    Task m_task;
+    unsigned int m_task_num;
+    unsigned int m_next;
+    unsigned int m_done;
+    bool m_stop;
+};
+
+#endif // COMMANDFANOUT_H
@@ -210,6 +210,15 @@ class ComponentInfoContainer
       return m_buffer_write_full_policy;
     }
 
+    void setTransport(std::string transport)
+    {
+      m_transport.push_back(transport);
+    }
+    std::vector<std::string> getTransport()
+    {
+      return m_transport;
+    }
+
     void setOutport(std::string outport) 	
     {
       m_outport.push_back(outport);
@@ -218,6 +227,62 @@ class ComponentInfoContainer
     {
       return m_outport;
     }
+    void setOutSubscriptionType(std::string subscription_type)
+    {
+      m_out_subscription_type.push_back(subscription_type);
+    }
+    std::vector<std::string> getOutSubscriptionType()
+    {
+      return m_out_subscription_type;
+    }
+    void setOutPushInterval(std::string push_interval)
+    {
+      m_out_push_interval.push_back(push_interval);
+    }
+    std::vector<std::string> getOutPushInterval()
+    {
+      return m_out_push_interval;
+    }
+    void setOutBufferLength(std::string buffer_length)
+    {
+      m_out_buffer_length.push_back(buffer_length);
+    }
+    std::vector<std::string> getOutBufferLength()
+    {
+      return m_out_buffer_length;
+    }
+    void setOutBufferReadTimeout(std::string buffer_read_timeout)
+    {
+      m_out_buffer_read_timeout.push_back(buffer_read_timeout);
+    }
+    std::vector<std::string> getOutBufferReadTimeout()
+    {
+      return m_out_buffer_read_timeout;
+    }
+    void setOutBufferWriteTimeout(std::string buffer_write_timeout)
+    {
+      m_out_buffer_write_timeout.push_back(buffer_write_timeout);
+    }
+    std::vector<std::string> getOutBufferWriteTimeout()
+    {
+      return m_out_buffer_write_timeout;
+    }
+    void setOutBufferReadEmptyPolicy(std::string buffer_read_empty_policy)
+    {
+      m_out_buffer_read_empty_policy.push_back(buffer_read_empty_policy);
+    }
+    std::vector<std::string> getOutBufferReadEmptyPolicy()
+    {
+      return m_out_buffer_read_empty_policy;
+    }
+    void setOutBufferWriteFullPolicy(std::string buffer_write_full_policy)
+    {
+      m_out_buffer_write_full_policy.push_back(buffer_write_full_policy);
+    }
+    std::vector<std::string> getOutBufferWriteFullPolicy()
+    {
+      return m_out_buffer_write_full_policy;
+    }
 
   private:
     std::string m_id;
@@ -235,7 +300,15 @@ class ComponentInfoContainer
     std::vector<std::string> m_buffer_write_timeout;
     std::vector<std::string> m_buffer_read_empty_policy;
     std::vector<std::string> m_buffer_write_full_policy;
+    std::vector<std::string> m_transport;
     std::vector<std::string> m_outport;
+    std::vector<std::string> m_out_subscription_type;
+    std::vector<std::string> m_out_push_interval;
+    std::vector<std::string> m_out_buffer_length;
+    std::vector<std::string> m_out_buffer_read_timeout;
+    std::vector<std::string> m_out_buffer_write_timeout;
+    std::vector<std::string> m_out_buffer_read_empty_policy;
+    std::vector<std::string> m_out_buffer_write_full_policy;
 };
 typedef std::vector<ComponentInfoContainer> CompInfoList;
 
@@ -273,6 +346,8 @@ typedef std::vector<ComponentGroup> CompGroupList;
 struct groupStatus {
   char * groupId;
   Status comp_status;
+  bool has_metrics;
+  Metrics comp_metrics;
 };
 
 typedef std::vector< groupStatus > groupStatusList;
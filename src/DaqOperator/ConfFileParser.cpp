@@ -41,6 +41,9 @@ ConfFileParser::ConfFileParser()
      TAG_compBufferWriteTimeout = XMLString::transcode("buffer_write_timeout");
      TAG_compBufferReadEmptyPolicy = XMLString::transcode("buffer_read_empty_policy");
      TAG_compBufferWriteFullPolicy = XMLString::transcode("buffer_write_full_policy");
+     TAG_compTransport = XMLString::transcode("transport");
+     TAG_compSubscriptionType = XMLString::transcode("subscription_type");
+     TAG_compPushInterval = XMLString::transcode("push_interval");
      TAG_paramId      = XMLString::transcode("pid");
      TAG_params       = XMLString::transcode("params");
      TAG_param        = XMLString::transcode("param");
@@ -73,6 +76,9 @@ ConfFileParser::~ConfFileParser()
         XMLString::release( &TAG_compBufferWriteTimeout );
         XMLString::release( &TAG_compBufferReadEmptyPolicy );
         XMLString::release( &TAG_compBufferWriteFullPolicy );
+        XMLString::release( &TAG_compTransport );
+        XMLString::release( &TAG_compSubscriptionType );
+        XMLString::release( &TAG_compPushInterval );
         XMLString::release( &TAG_paramId );
         if (TAG_params) {
             XMLString::release( &TAG_params );
@@ -318,64 +324,37 @@ int ConfFileParser::getElementsFromParent(
                 ///std::string inport  = gid + ":" + myport;
                 ///std::string outfrom = gid + ":" + from;
 
-                //// buffer_length attribute ////
-                std::string buffer_length;
-                if (nodeEle->getAttributeNode(TAG_compBufferLength)) {
-                    char *buf_len
-                        = XMLString::transcode(nodeEle->getAttributeNode(TAG_compBufferLength)->getValue() );
-                    buffer_length = buf_len;
-                    XMLString::release(&buf_len);
+                //// buffer attributes ////
+                std::string buffer_length
+                    = getAttribute(nodeEle, TAG_compBufferLength, "256");
+                std::string buffer_read_timeout
+                    = getAttribute(nodeEle, TAG_compBufferReadTimeout, "0.005"); // 5 milli seconds
+                std::string buffer_write_timeout
+                    = getAttribute(nodeEle, TAG_compBufferWriteTimeout, "0.005"); // 5 milli seconds
+                std::string buffer_read_empty_policy
+                    = getAttribute(nodeEle, TAG_compBufferReadEmptyPolicy, "block");
+                std::string buffer_write_full_policy
+                    = getAttribute(nodeEle, TAG_compBufferWriteFullPolicy, "block");
+
+                //// transport attribute ////
+                std::string transport
+                    = getAttribute(nodeEle, TAG_compTransport, "corba"); // CORBA (corba_cdr)
+
+                std::string err = checkBufferAttributes(buffer_length,
+                                                        buffer_read_timeout,
+                                                        buffer_write_timeout,
+                                                        buffer_read_empty_policy,
+                                                        buffer_write_full_policy);
+                if (err.empty() && transport != "corba" && transport != "shm") {
+                    err = "transport must be corba or shm: " + transport;
                 }
-                else {
-                    buffer_length = "256";
-                }
-
-                //// buffer_read_timeout attribute ////
-                std::string buffer_read_timeout;
-                if (nodeEle->getAttributeNode(TAG_compBufferReadTimeout)) {
-                    char *r_timeout
-                        = XMLString::transcode(nodeEle->getAttributeNode(TAG_compBufferReadTimeout)->getValue() );
-                    buffer_read_timeout = r_timeout;
-                    XMLString::release(&r_timeout);
-                }
-                else {
-                    buffer_read_timeout = "0.005"; // 5 milli seconds
-                }
-
-                //// buffer_write_timeout attribute ////
-                std::string buffer_write_timeout;
-                if (nodeEle->getAttributeNode(TAG_compBufferWriteTimeout)) {
-                    char *w_timeout
-                        = XMLString::transcode(nodeEle->getAttributeNode(TAG_compBufferWriteTimeout)->getValue() );
-                    buffer_write_timeout = w_timeout;
-                    XMLString::release(&w_timeout);
-                }
-                else {
-                    buffer_write_timeout = "0.005"; // 5 milli seconds
-                }
-
-                //// buffer_read_empty_policy attribute ////
-                std::string buffer_read_empty_policy;
-                if (nodeEle->getAttributeNode(TAG_compBufferReadEmptyPolicy)) {
-                    char *r_empty
-                        = XMLString::transcode(nodeEle->getAttributeNode(TAG_compBufferReadEmptyPolicy)->getValue() );
-                    buffer_read_empty_policy = r_empty;
-                    XMLString::release(&r_empty);
-                }
-                else {
-                    buffer_read_empty_policy = "block"; // block 
-                }
-
-                //// buffer_write_full_policy attribute ////
-                std::string buffer_write_full_policy;
-                if (nodeEle->getAttributeNode(TAG_compBufferWriteFullPolicy)) {
-                    char *w_full
-                        = XMLString::transcode(nodeEle->getAttributeNode(TAG_compBufferWriteFullPolicy)->getValue() );
-                    buffer_write_full_policy = w_full;
-                    XMLString::release(&w_full);
-                }
-                else {
-                    buffer_write_full_policy = "block"; // block 
+                if (!err.empty()) {
+                    std::cerr << "### ERROR: ConfFileParser: inPort " << myport << ": "
+                              << err << std::endl;
+                    XMLString::release(&from);
+                    XMLString::release(&textCont);
+                    XMLString::release(&tagName);
+                    throw std::runtime_error("Bad inPort attribute in configuration file");
                 }
 
                 std::string inport  = myport;
@@ -388,13 +367,59 @@ int ConfFileParser::getElementsFromParent(
                 compCont->setBufferWriteTimeout(buffer_write_timeout);
                 compCont->setBufferReadEmptyPolicy(buffer_read_empty_policy);
                 compCont->setBufferWriteFullPolicy(buffer_write_full_policy);
+                compCont->setTransport(transport);
                 XMLString::release(&from);
             }
             else if (strcmp(tagName, "outPort") == 0) {
                 ///std::string outport = gid + ":" + myport;
                 std::string outport = myport;
                 ///std::cerr << "$$$$$ outport: " << outport << std::endl;
+
+                //// OutPort buffer, used with subscription_type new/periodic ////
+                std::string subscription_type
+                    = getAttribute(nodeEle, TAG_compSubscriptionType, "flush");
+                std::string push_interval
+                    = getAttribute(nodeEle, TAG_compPushInterval, "1.0");
+                std::string buffer_length
+                    = getAttribute(nodeEle, TAG_compBufferLength, "8");
+                std::string buffer_read_timeout
+                    = getAttribute(nodeEle, TAG_compBufferReadTimeout, "0.005");
+                std::string buffer_write_timeout
+                    = getAttribute(nodeEle, TAG_compBufferWriteTimeout, "0.005");
+                std::string buffer_read_empty_policy
+                    = getAttribute(nodeEle, TAG_compBufferReadEmptyPolicy, "block");
+                std::string buffer_write_full_policy
+                    = getAttribute(nodeEle, TAG_compBufferWriteFullPolicy, "block");
+
+                std::string err = checkBufferAttributes(buffer_length,
+                                                        buffer_read_timeout,
+                                                        buffer_write_timeout,
+                                                        buffer_read_empty_policy,
+                                                        buffer_write_full_policy);
+                if (err.empty() && subscription_type != "flush"
+                    && subscription_type != "new" && subscription_type != "periodic") {
+                    err = "subscription_type must be flush, new or periodic: "
+                        + subscription_type;
+                }
+                if (err.empty() && atof(push_interval.c_str()) <= 0.0) {
+                    err = "push_interval must be > 0: " + push_interval;
+                }
+                if (!err.empty()) {
+                    std::cerr << "### ERROR: ConfFileParser: outPort " << myport << ": "
+                              << err << std::endl;
+                    XMLString::release(&textCont);
+                    XMLString::release(&tagName);
+                    throw std::runtime_error("Bad outPort attribute in configuration file");
+                }
+
                 compCont->setOutport(outport);
+                compCont->setOutSubscriptionType(subscription_type);
+                compCont->setOutPushInterval(push_interval);
+                compCont->setOutBufferLength(buffer_length);
+                compCont->setOutBufferReadTimeout(buffer_read_timeout);
+                compCont->setOutBufferWriteTimeout(buffer_write_timeout);
+                compCont->setOutBufferReadEmptyPolicy(buffer_read_empty_policy);
+                compCont->setOutBufferWriteFullPolicy(buffer_write_full_policy);
             }
             else {
                 std::cerr << "### ERROR: ConfFileParser::getElementsFromParent(): Bad Tag in configuration file\n";
@@ -409,6 +434,54 @@ int ConfFileParser::getElementsFromParent(
     return 0;
 }
 
+std::string ConfFileParser::getAttribute(xercesc::DOMElement* ele, XMLCh* chName,
+                                         std::string defaultValue)
+{
+    DOMAttr* attr = ele->getAttributeNode(chName);
+    if (attr == 0) {
+        return defaultValue;
+    }
+    char* value = XMLString::transcode(attr->getValue());
+    std::string ret = value;
+    XMLString::release(&value);
+    return ret;
+}
+
+/*
+ * Values accepted for the RTC::RingBuffer of a connection.
+ * "skip" is an alias of do_nothing: a write to a full buffer is dropped.
+ * Returns an error message, empty if the attributes are good.
+ */
+std::string ConfFileParser::checkBufferAttributes(std::string& length,
+                                                  std::string& read_timeout,
+                                                  std::string& write_timeout,
+                                                  std::string& read_empty_policy,
+                                                  std::string& write_full_policy)
+{
+    if (atoi(length.c_str()) <= 0) {
+        return "buffer_length must be > 0: " + length;
+    }
+    if (atof(read_timeout.c_str()) < 0.0) {
+        return "buffer_read_timeout must be >= 0: " + read_timeout;
+    }
+    if (atof(write_timeout.c_str()) < 0.0) {
+        return "buffer_write_timeout must be >= 0: " + write_timeout;
+    }
+    if (read_empty_policy != "block" && read_empty_policy != "do_nothing") {
+        return "buffer_read_empty_policy must be block or do_nothing: "
+            + read_empty_policy;
+    }
+    if (write_full_policy == "skip") {
+        write_full_policy = "do_nothing";
+    }
+    if (write_full_policy != "block" && write_full_policy != "overwrite"
+        && write_full_policy != "do_nothing") {
+        return "buffer_write_full_policy must be block, overwrite or skip: "
+            + write_full_policy;
+    }
+    return "";
+}
+
 int ConfFileParser::getParams(xercesc::DOMElement* myEle, XMLCh* chName, std::string xpath, std::string compId, ComponentInfoContainer* compCont)
 {
     DOMNodeList* nodeList = myEle->getElementsByTagName(chName);
@@ -15,6 +15,7 @@
 #ifndef CONFFILEPASER_H
 #define CONFFILEPASER_H
 
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -81,6 +82,15 @@ private:
 			      std::string gid,
 			      ComponentInfoContainer* compCont);
 
+    std::string getAttribute(xercesc::DOMElement* ele,
+			     XMLCh* chName,
+			     std::string defaultValue);
+    std::string checkBufferAttributes(std::string& length,
+				      std::string& read_timeout,
+				      std::string& write_timeout,
+				      std::string& read_empty_policy,
+				      std::string& write_full_policy);
+
     int getParams(xercesc::DOMElement* myEle,
 		  XMLCh* chName,
 		  std::string xpath,
@@ -125,6 +135,9 @@ private:
     XMLCh* TAG_compBufferWriteTimeout;
     XMLCh* TAG_compBufferReadEmptyPolicy;
     XMLCh* TAG_compBufferWriteFullPolicy;
+    XMLCh* TAG_compTransport;
+    XMLCh* TAG_compSubscriptionType;
+    XMLCh* TAG_compPushInterval;
     XMLCh* TAG_paramId;
     XMLCh* TAG_params;
     XMLCh* TAG_param;
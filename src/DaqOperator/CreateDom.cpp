@@ -399,9 +399,99 @@ void CreateDom::makeLog(groupStatus status)
 
 	make(m_logElem, "compStatus", comp_status);
 
+	if (status.has_metrics) {
+	    makeMetrics(status.comp_metrics);
+	}
+
 	return;
 }
 
+void CreateDom::makeMetrics(const Metrics& metrics)
+{
+	char num[32];
+
+	sprintf(num, "%llu", (long long unsigned int)metrics.event_num);
+	make(m_logElem, "metricsEventNum", num);
+	sprintf(num, "%.1f", metrics.event_rate);
+	make(m_logElem, "eventRate", num);
+	sprintf(num, "%.1f", metrics.byte_rate);
+	make(m_logElem, "byteRate", num);
+	sprintf(num, "%llu", (long long unsigned int)metrics.run_count);
+	make(m_logElem, "runCount", num);
+
+	// daq_run() duration histogram, log2(usec) bins separated by space
+	std::string hist;
+	for (int i = 0; i < RUN_HIST_SIZE; i++) {
+	    sprintf(num, "%llu", (long long unsigned int)metrics.run_hist[i]);
+	    if (i > 0) {
+		hist += " ";
+	    }
+	    hist += num;
+	}
+	make(m_logElem, "runHist", hist);
+
+	sprintf(num, "%llu", (long long unsigned int)metrics.inport_timeout);
+	make(m_logElem, "inPortTimeout", num);
+	sprintf(num, "%llu", (long long unsigned int)metrics.outport_timeout);
+	make(m_logElem, "outPortTimeout", num);
+	sprintf(num, "%llu", (long long unsigned int)metrics.seq_gap);
+	make(m_logElem, "seqGap", num);
+	sprintf(num, "%llu", (long long unsigned int)metrics.seq_gap_frames);
+	make(m_logElem, "seqGapFrames", num);
+	sprintf(num, "%llu", (long long unsigned int)metrics.seq_gap_max);
+	make(m_logElem, "seqGapMax", num);
+	sprintf(num, "%llu", (long long unsigned int)metrics.stall_count);
+	make(m_logElem, "stallCount", num);
+	sprintf(num, "%llu", (long long unsigned int)metrics.stall_usec);
+	make(m_logElem, "stallUsec", num);
+	sprintf(num, "%llu", (long long unsigned int)metrics.drop_count);
+	make(m_logElem, "dropCount", num);
+
+	// connector buffer occupancy, port:readable/length separated by space
+	std::string buffers;
+	for (CORBA::ULong i = 0; i < metrics.port_buffer.length(); i++) {
+	    if (i > 0) {
+		buffers += " ";
+	    }
+	    buffers += (const char *)metrics.port_buffer[i].port_name;
+	    sprintf(num, ":%lu/%lu",
+		    (unsigned long)metrics.port_buffer[i].readable,
+		    (unsigned long)metrics.port_buffer[i].length);
+	    buffers += num;
+	}
+	make(m_logElem, "portBuffer", buffers);
+
+	// sampled outputs, port:sent/prescale/rate/latest/full drops
+	std::string drops;
+	for (CORBA::ULong i = 0; i < metrics.output_drops.length(); i++) {
+	    const OutputDrops& d = metrics.output_drops[i];
+	    if (i > 0) {
+		drops += " ";
+	    }
+	    drops += (const char *)d.port_name;
+	    sprintf(num, ":%llu/", (long long unsigned int)d.sent);
+	    drops += num;
+	    sprintf(num, "%llu/", (long long unsigned int)d.prescale_drop);
+	    drops += num;
+	    sprintf(num, "%llu/", (long long unsigned int)d.rate_drop);
+	    drops += num;
+	    sprintf(num, "%llu/", (long long unsigned int)d.latest_drop);
+	    drops += num;
+	    sprintf(num, "%llu", (long long unsigned int)d.full_drop);
+	    drops += num;
+	}
+	make(m_logElem, "outputDrops", drops);
+
+	sprintf(num, "%llu", (long long unsigned int)metrics.incomplete_events);
+	make(m_logElem, "incompleteEvents", num);
+	sprintf(num, "%llu", (long long unsigned int)metrics.late_fragments);
+	make(m_logElem, "lateFragments", num);
+	sprintf(num, "%.2f", metrics.compress_ratio);
+	make(m_logElem, "compressRatio", num);
+	sprintf(num, "%.1f", metrics.codec_byte_rate / 1.0e6);
+	make(m_logElem, "codecMBps", num);
+}
+
 #ifdef MLF
 bool CreateDom::check(std::string name, int *cnt, int *type, int *index)
 {
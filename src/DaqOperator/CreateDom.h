@@ -78,6 +78,7 @@ private:
 	void makeValue(DOMElement* ele, int index, std::string value);
 	void makeLogs();
 	void makeLog(groupStatus groupStatus);
+	void makeMetrics(const Metrics& metrics);
 	std::string getBuffer();
 
 private:
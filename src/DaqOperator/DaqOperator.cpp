@@ -49,6 +49,8 @@ DaqOperator::DaqOperator(RTC::Manager *manager)
 	  deadFlag(false),
 	  resFlag(false),
 	  m_new(0),
+	  m_cmd_timeout_usec(CMD_TIMEOUT_SEC * 1000000LL),
+	  m_cmd_slow_usec(CMD_SLOW_MSEC * 1000LL),
 	  m_state(LOADED),
 	  m_runNumber(0),
 	  m_start_date(" "),
@@ -136,6 +138,7 @@ DaqOperator::DaqOperator(RTC::Manager *manager)
 }
 DaqOperator::~DaqOperator()
 {
+	m_status_cache.stop();
 	XMLPlatformUtils::Terminate();
 }
 RTC::ReturnCode_t DaqOperator::onInitialize()
@@ -259,30 +262,32 @@ void DaqOperator::run_data()
 {
 	cerr << "\033[;H\033[2J";
 
+	shared_ptr<const CompStatusCache::View> view = get_status_view();
 	try
 	{
-		for (int i = 0; i < m_comp_num; i++)
+		for (int i = 0; i < m_comp_num && i < (int)view->items.size(); i++)
 		{
-			Status_var status;
-			status = m_daqservices[i]->getStatus();
+			const CompSnapshot &item = view->items[i];
+			if (!item.polled)
+			{
+				continue;
+			}
+			const Status &status = item.snapshot.status;
 
-			if (status->comp_status == COMP_FATAL)
+			if (status.comp_status == COMP_FATAL)
 			{
-				RTC::ConnectorProfileList_var myprof =
-					m_DaqServicePorts[i]->get_connector_profiles();
-				cerr << myprof[0].name << " "
+				cerr << item.id << " "
 					 << "### on ERROR ###  " << '\n';
 
-				FatalErrorStatus_var errStatus;
-				errStatus = m_daqservices[i]->getFatalStatus();
+				const FatalErrorStatus &errStatus = item.snapshot.fatal_status;
 				cerr << "\033[1;0H";
 				cerr << "errStatus.fatalTypes:"
-					 << errStatus->fatalTypes << '\n';
+					 << errStatus.fatalTypes << '\n';
 				cerr << "errStatus.errorCode:"
-					 << errStatus->errorCode << '\n';
+					 << errStatus.errorCode << '\n';
 				cerr << "errStatus.description:"
-					 << errStatus->description << '\n';
-				m_err_msg = errStatus->description;
+					 << errStatus.description << '\n';
+				m_err_msg = errStatus.description;
 			} // if fatal
 		}
 	}
@@ -302,7 +307,7 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 	string srunNo = "0";
 	/* console error display */
 	vector<string> d_compname;
-	vector<FatalErrorStatus_var> d_message;
+	vector<string> d_message;
 
 	m_tout.tv_sec = 2;
 	m_tout.tv_usec = 0;
@@ -352,7 +357,7 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 		command = (int)(comm[0] - '0');
 
 		// set time1
-		if (m_time)
+		if (m_time || m_timing.is_open())
 		{
 			set_time();
 			output_performance(command);
@@ -365,8 +370,10 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 			switch ((DAQCommand)command)
 			{
 			case CMD_RESUME:
-				resume_procedure(); ///
-				m_state = RUNNING;
+				if (resume_procedure() == 0) ///
+				{
+					m_state = RUNNING;
+				}
 				break;
 			default:
 				cerr << "   Bad Command:" << command << '\n';
@@ -377,8 +384,10 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 			switch ((DAQCommand)command)
 			{
 			case CMD_CONFIGURE:
-				configure_procedure();
-				m_state = CONFIGURED;
+				if (configure_procedure() == 0)
+				{
+					m_state = CONFIGURED;
+				}
 				break;
 			default:
 				cerr << "   Bad Command\n";
@@ -395,19 +404,23 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 				cin >> srunNo;
 
 				// set time2
-				if (m_time)
+				if (m_time || m_timing.is_open())
 				{
 					set_time();
 					output_performance(command);
 				}
 
 				m_runNumber = atoi(srunNo.c_str());
-				start_procedure();
-				m_state = RUNNING;
+				if (start_procedure() == 0)
+				{
+					m_state = RUNNING;
+				}
 				break;
 			case CMD_UNCONFIGURE:
-				unconfigure_procedure();
-				m_state = LOADED;
+				if (unconfigure_procedure() == 0)
+				{
+					m_state = LOADED;
+				}
 				break;
 			default:
 				cerr << "   Bad Command\n";
@@ -418,12 +431,16 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 			switch ((DAQCommand)command)
 			{
 			case CMD_STOP:
-				stop_procedure();
-				m_state = CONFIGURED;
+				if (stop_procedure() == 0)
+				{
+					m_state = CONFIGURED;
+				}
 				break;
 			case CMD_PAUSE:		   ///
-				pause_procedure(); ///
-				m_state = PAUSED;
+				if (pause_procedure() == 0) ///
+				{
+					m_state = PAUSED;
+				}
 				break;
 			default:
 				cerr << "   Bad Command: ";
@@ -435,20 +452,31 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 			switch ((DAQCommand)command)
 			{
 			case CMD_STOP:
-				stop_procedure();
-				m_state = CONFIGURED; ///
+				if (stop_procedure() == 0)
+				{
+					m_state = CONFIGURED; ///
+				}
 				break;
 			case CMD_RESTART:
-				error_stop_procedure();
+				if (error_stop_procedure() != 0)
+				{
+					break;
+				}
 				sleep(2);
-				other_stop_procedure();
+				if (other_stop_procedure() != 0)
+				{
+					break;
+				}
 				sleep(1);
 				cerr << "\033[5;20H"; // default:3;20H
 				cerr << "input RUN NO(same run no is prohibited):   ";
 				cerr << "\033[5;62H";
 				cin >> srunNo;
 				m_runNumber = atoi(srunNo.c_str());
-				start_procedure();
+				if (start_procedure() != 0)
+				{
+					break;
+				}
 				cerr << "\033[0;13H"
 					 << "\033[34m"
 					 << "Send reboot command"
@@ -464,9 +492,6 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 	else
 	{
 		// Console memu
-		Status_var status;
-		FatalErrorStatus_var errStatus;
-
 		cerr << " " << '\n';
 		cerr << "\033[0;0H\033[2J";
 		cerr << "\033[8;0H";
@@ -477,6 +502,7 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 			 << '\n';
 		///cerr << "RUN NO: " << m_runNumber << '\n';
 
+		shared_ptr<const CompStatusCache::View> view = get_status_view();
 		string compname;
 		for (int i = (m_comp_num - 1); i >= 0; i--)
 		{
@@ -484,57 +510,66 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 			{
 				// copy_compname();
 
-				RTC::ConnectorProfileList_var myprof =
-					m_DaqServicePorts[i]->get_connector_profiles();
-				compname = myprof[0].name;
+				if (i >= (int)view->items.size())
+				{
+					continue;
+				}
+				const CompSnapshot &item = view->items[i];
+				compname = item.id;
 
-				status = m_daqservices[i]->getStatus();
+				if (!view->ok[i] || !item.polled)
+				{
+					cerr << " ### ERROR: "
+						 << setw(22) << right
+						 << compname << " : cannot connect\n";
+					continue;
+				}
+				const Status &status = item.snapshot.status;
+				const FatalErrorStatus &errStatus = item.snapshot.fatal_status;
 				cerr << " " << setw(22) << left
 					 << compname
 					 << '\t'
 					 << setw(14) << right
-					 << status->event_size; // data size(byte)
+					 << status.event_size; // data size(byte)
 
-				if (status->comp_status == COMP_FATAL)
+				if (status.comp_status == COMP_FATAL)
 				{
-					errStatus = m_daqservices[i]->getFatalStatus();
 					cerr << "\033[35m"
 						 << setw(12) << right
 						 << "RUNNING"
 						 << "\033[39m"
 						 << "\033[31m" << setw(14) << right
-						 << check_compStatus(status->comp_status)
+						 << check_compStatus(status.comp_status)
 						 << "\033[39m" << '\n';
 
 					/** Use error console display **/
 					d_compname.emplace_back(compname);
-					d_message.emplace_back(move(errStatus));
+					d_message.emplace_back(errStatus.description);
 					m_state = ERRORED;
 				} ///if Fatal
-				else if (status->comp_status == COMP_RESTART)
+				else if (status.comp_status == COMP_RESTART)
 				{
-					errStatus = m_daqservices[i]->getFatalStatus();
 					cerr << "\033[35m"
 						 << setw(12) << right
 						 << "RUNNING"
 						 << "\033[39m"
 						 << "\033[33m" << setw(14) << right
-						 << check_compStatus(status->comp_status)
+						 << check_compStatus(status.comp_status)
 						 << "\033[39m" << '\n';
 
 					/** Use error console display **/
 					d_compname.emplace_back(compname);
-					d_message.emplace_back(move(errStatus));
+					d_message.emplace_back(errStatus.description);
 					m_state = ERRORED;
 					resFlag = true;
 				} ///if Restart Request
 				else
 				{
 					cerr << setw(12) << right
-						 << check_state(status->state)
+						 << check_state(status.state)
 						 << "\033[32m"
 						 << setw(14) << right
-						 << check_compStatus(status->comp_status)
+						 << check_compStatus(status.comp_status)
 						 << "\033[39m" << '\n';
 				}
 			}
@@ -547,9 +582,9 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 			}
 		} //for
 		cerr << '\n';
-		for (auto &da : m_daqservices)
+		for (unsigned int i = 0; i < m_hb_miss.size(); i++)
 		{
-			if (da->getHB())
+			if (i < view->ok.size() && view->ok[i] && m_hb_miss[i] == 0)
 				cerr << "1";
 			else
 				cerr << "0";
@@ -566,7 +601,7 @@ RTC::ReturnCode_t DaqOperator::run_console_mode()
 				cerr << " [ERROR" << cnt << "] "
 					 << compname << '\t'
 					 << "\033[31m"
-					 << "<- " << d_message[cnt - 1]->description
+					 << "<- " << d_message[cnt - 1]
 					 << "\033[39m" << '\n';
 			} ///for
 			if (deadFlag == true)
@@ -683,41 +718,53 @@ int DaqOperator::set_runno(RTC::CorbaConsumer<DAQService> daqservice, unsigned r
 	}
 	return 0;
 }
-int DaqOperator::set_command(RTC::CorbaConsumer<DAQService> daqservice,
-							 DAQCommand daqcom)
+/*
+ * RTC_ERROR if the component refused the command (its command queue is
+ * full) or did not answer: the command will never be done.
+ */
+RTC::ReturnCode_t DaqOperator::set_command(RTC::CorbaConsumer<DAQService> daqservice,
+										   DAQCommand daqcom)
 {
 	try
 	{
-		daqservice->setCommand(daqcom);
+		return daqservice->setCommand(daqcom);
 	}
 	catch (...)
 	{
 		cerr << "### ERROR: set command: exception occured\n ";
 	}
-	return 0;
+	return RTC::RTC_ERROR;
 }
 int DaqOperator::clockwork_hb_recv()
 {
 	if (mytimer->checkTimer())
 	{
-		for (auto &daqservice : m_daqservices)
+		shared_ptr<const CompStatusCache::View> view = get_status_view();
+		if (m_hb_seen.size() != view->items.size())
 		{
-			if (daqservice->getHB())
+			m_hb_seen.assign(view->items.size(), 0);
+			m_hb_miss.assign(view->items.size(), 0);
+		}
+		for (unsigned int i = 0; i < view->items.size(); i++)
+		{
+			CORBA::ULong hb_count = view->items[i].snapshot.hb_count;
+			if (view->ok[i] && hb_count != m_hb_seen[i])
 			{
+				m_hb_seen[i] = hb_count;
 				if (deadFlag == true)
 				{
 					deadFlag = false;
 					resFlag = true;
 				}
-				daqservice->reset_send_count();
+				m_hb_miss[i] = 0;
 			}
 			else
 			{
 				if (deadFlag == false)
 				{
-					if (daqservice->get_send_count() > 10)
+					if (m_hb_miss[i] > 10)
 					{
-						daqservice->reset_send_count();
+						m_hb_miss[i] = 0;
 						deadFlag = true;
 					}
 				}
@@ -725,28 +772,497 @@ int DaqOperator::clockwork_hb_recv()
 				{
 					cout << "Dead end\n";
 				}
+				m_hb_miss[i]++;
 			}
-			daqservice->inc_send_count();
 		}
 		mytimer->resetTimer();
 	}
 	return 0;
 }
-int DaqOperator::check_done(RTC::CorbaConsumer<DAQService> daqservice)
+/*
+ * The status of the components as last polled by the background thread
+ * of m_status_cache, started here on first use.  The console display,
+ * the HTTP status and log, the heartbeat check and the stop procedures
+ * read it instead of calling the components, so a reader never waits
+ * for a component and the polling load does not depend on the number
+ * of readers.
+ */
+shared_ptr<const DaqOperator::CompStatusCache::View> DaqOperator::get_status_view()
+{
+	if (!m_status_cache.running())
+	{
+		m_status_cache.start(m_daqservices.size(),
+							 [this](unsigned int index, CompSnapshot &item) {
+								 return poll_component(index, item);
+							 },
+							 STATUS_POLL_MSEC * 1000LL);
+	}
+	return m_status_cache.get();
+}
+/*
+ * A view polled after this call, for procedures that select components
+ * by a state that may just have changed.  Waits at most the command
+ * timeout.
+ */
+shared_ptr<const DaqOperator::CompStatusCache::View> DaqOperator::refresh_status_view()
+{
+	get_status_view();
+	return m_status_cache.refresh(m_cmd_timeout_usec);
+}
+/*
+ * Poll one component on the thread of m_status_cache: one getSnapshot()
+ * (status, fatal status, heartbeat, done), in HTTP mode getMetrics() for
+ * the log.  The component id is looked up until the port is connected.
+ * item holds the previous result; false keeps it as last known.
+ */
+bool DaqOperator::poll_component(unsigned int index, CompSnapshot &item)
+{
+	if (!item.has_id)
+	{
+		item.has_id = find_comp_id(index, item.id);
+	}
+	try
+	{
+		Snapshot_var snapshot = m_daqservices[index]->getSnapshot();
+		item.snapshot = snapshot.in();
+		item.polled = true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+	if (!m_isConsoleMode)
+	{
+		try
+		{
+			Metrics_var metrics = m_daqservices[index]->getMetrics();
+			item.metrics = metrics.in();
+			item.has_metrics = true;
+		}
+		catch (...)
+		{
+			// component built without getMetrics()
+			item.has_metrics = false;
+		}
+	}
+	return true;
+}
+/*
+ * Indices of all the components in the order of m_daqservices.
+ */
+vector<int> DaqOperator::all_components()
+{
+	vector<int> targets;
+	for (int i = 0; i < (int)m_daqservices.size(); i++)
+	{
+		targets.push_back(i);
+	}
+	return targets;
+}
+static long long elapsed_usec(const struct timespec &from, const struct timespec &to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000000LL + (to.tv_nsec - from.tv_nsec) / 1000;
+}
+/*
+ * Wait until the component has completed every command sent to it or
+ * the deadline (CLOCK_MONOTONIC) passed.  waitDone() blocks in the
+ * component until setDone(), so the operator learns the completion
+ * without polling; it is called in slices of WAIT_DONE_SLICE_MSEC to
+ * warn about slow components before the deadline.
+ */
+bool DaqOperator::wait_done(int index, const struct timespec &start,
+							const struct timespec &deadline)
+{
+	bool warned = false;
+	for (;;)
+	{
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		long long left_msec = elapsed_usec(now, deadline) / 1000;
+		if (left_msec < 0)
+		{
+			left_msec = 0;
+		}
+		if (left_msec > WAIT_DONE_SLICE_MSEC)
+		{
+			left_msec = WAIT_DONE_SLICE_MSEC;
+		}
+		try
+		{
+			if (m_daqservices[index]->waitDone(left_msec) == DONE)
+			{
+				if (m_debug)
+				{
+					DoneStatus done = m_daqservices[index]->getDoneStatus();
+					ostringstream msg;
+					msg << "waitDone: command " << done.done_command
+						<< " seq " << done.done_seq << "/" << done.issued_seq
+						<< " done at " << done.done_time.sec << "."
+						<< setfill('0') << setw(6) << done.done_time.usec << '\n';
+					cerr << msg.str();
+				}
+				return true;
+			}
+		}
+		catch (...)
+		{
+			cerr << "### waitDone: failed" << '\n';
+			return false;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (elapsed_usec(now, deadline) <= 0)
+		{
+			return false;
+		}
+		if (!warned && elapsed_usec(start, now) >= m_cmd_slow_usec)
+		{
+			ostringstream msg;
+			msg << "### WARNING: " << m_comp_ids[index] << ": not done after "
+				<< elapsed_usec(start, now) / 1000 << " msec" << '\n';
+			cerr << msg.str();
+			warned = true;
+		}
+	}
+}
+/*
+ * The last command the component completed was an illegal transition
+ * for it (DoneStatus.rejected).  Call after wait_done().
+ */
+bool DaqOperator::done_rejected(int index)
+{
+	try
+	{
+		return m_daqservices[index]->getDoneStatus().rejected;
+	}
+	catch (...)
+	{
+		cerr << "### getDoneStatus: failed" << '\n';
+	}
+	return false;
+}
+string DaqOperator::get_comp_id(int index)
+{
+	string id;
+	find_comp_id(index, id);
+	return id;
+}
+/*
+ * The connector profile name of the DAQService port of the component.
+ * Returns false and "component <index>" if the port is not connected.
+ */
+bool DaqOperator::find_comp_id(int index, string &id)
 {
 	try
 	{
-		if (daqservice->checkDone() == 0)
+		RTC::ConnectorProfileList_var myprof =
+			m_DaqServicePorts[index]->get_connector_profiles();
+		if (myprof->length() > 0)
 		{
-			usleep(0);
+			id = (string)myprof[0].name;
+			return true;
 		}
 	}
 	catch (...)
 	{
-		cerr << "### checkDone: failed" << '\n';
+	}
+	ostringstream fallback;
+	fallback << "component " << index;
+	id = fallback.str();
+	return false;
+}
+/*
+ * Send daqcom to the targets concurrently (CommandFanOut) and wait until
+ * all of them are done, each at most m_cmd_timeout_usec.  CMD_START sets
+ * the run number first.  The latency of each component (send to done)
+ * is kept in m_cmd_usec and written to the timing file (-t):
+ *   comp_done,<index>,<mono_ns>,<usec>      index: startOrd - 1
+ *   comp_timeout,<index>,<mono_ns>,<command>
+ *   cmd_done,<command>,<mono_ns>,<usec of the slowest component>
+ *                                           (only if all are done)
+ * Components slower than m_cmd_slow_usec are reported while waiting,
+ * the ones not done in time with their DoneStatus at the end.  A
+ * component that refused the command or rejected it as an illegal
+ * transition counts as not done.
+ * Returns the number of components not done in time.
+ */
+int DaqOperator::fan_out_command(const vector<int> &targets, DAQCommand daqcom)
+{
+	if (m_fanout.thread_num() == 0 && m_daqservices.size() > 1)
+	{
+		int thread_num = m_daqservices.size();
+		if (thread_num > MAX_FANOUT_THREADS)
+		{
+			thread_num = MAX_FANOUT_THREADS;
+		}
+		m_fanout.start(thread_num);
+	}
+	m_fanout.wait_idle();
+	m_cmd_usec.assign(m_daqservices.size(), -1);
+	if (m_comp_ids.size() != m_daqservices.size())
+	{
+		m_comp_ids.clear();
+		for (int i = 0; i < (int)m_daqservices.size(); i++)
+		{
+			m_comp_ids.push_back(get_comp_id(i));
+		}
+	}
+
+	struct timespec start, deadline;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	deadline.tv_sec = start.tv_sec + m_cmd_timeout_usec / 1000000;
+	deadline.tv_nsec = start.tv_nsec + (m_cmd_timeout_usec % 1000000) * 1000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+	unsigned int runno = m_runNumber;
+
+	// Tasks may outlive this call after a timeout: they get targets by
+	// value and write their latency only into result, under its mutex.
+	shared_ptr<FanOutResult> result(new FanOutResult);
+	result->usec.assign(targets.size(), -1);
+	result->refused.assign(targets.size(), false);
+	result->rejected.assign(targets.size(), false);
+	m_fanout.run(targets.size(), [this, targets, daqcom, runno, start, deadline, result](unsigned int i) {
+		int index = targets[i];
+		if (daqcom == CMD_START)
+		{
+			set_runno(m_daqservices[index], runno);
+		}
+		if (set_command(m_daqservices[index], daqcom) != RTC::RTC_OK)
+		{
+			// the done sequence of the component never reaches a refused
+			// command, waitDone() would report the previous one as DONE
+			m_timing.record(DAQMW::TIMING_COMP_TIMEOUT, index, daqcom);
+			lock_guard<mutex> lock(result->usec_mutex);
+			result->refused[i] = true;
+		}
+		else if (!wait_done(index, start, deadline))
+		{
+			m_timing.record(DAQMW::TIMING_COMP_TIMEOUT, index, daqcom);
+		}
+		else if (done_rejected(index))
+		{
+			m_timing.record(DAQMW::TIMING_COMP_TIMEOUT, index, daqcom);
+			lock_guard<mutex> lock(result->usec_mutex);
+			result->rejected[i] = true;
+		}
+		else
+		{
+			struct timespec done;
+			clock_gettime(CLOCK_MONOTONIC, &done);
+			long long usec = elapsed_usec(start, done);
+			m_timing.record(DAQMW::TIMING_COMP_DONE, index, usec);
+			lock_guard<mutex> lock(result->usec_mutex);
+			result->usec[i] = usec;
+		}
+	}, m_cmd_timeout_usec + WAIT_DONE_SLICE_MSEC * 1000LL); // tasks give up at the deadline
+
+	vector<bool> refused;
+	vector<bool> rejected;
+	{
+		lock_guard<mutex> lock(result->usec_mutex);
+		for (unsigned int i = 0; i < targets.size(); i++)
+		{
+			m_cmd_usec[targets[i]] = result->usec[i];
+		}
+		refused = result->refused;
+		rejected = result->rejected;
+	}
+
+	int not_done = 0;
+	long long slowest = 0;
+	int slowest_index = -1;
+	for (unsigned int i = 0; i < targets.size(); i++)
+	{
+		int index = targets[i];
+		long long usec = m_cmd_usec[index];
+		if (refused[i])
+		{
+			cerr << "### ERROR: " << m_comp_ids[index] << ": command "
+				 << daqcom << " refused" << '\n';
+			not_done++;
+		}
+		else if (rejected[i])
+		{
+			cerr << "### ERROR: " << m_comp_ids[index] << ": command "
+				 << daqcom << " rejected, illegal transition" << '\n';
+			not_done++;
+		}
+		else if (usec < 0)
+		{
+			cerr << "### ERROR: " << m_comp_ids[index] << ": command "
+				 << daqcom << " not done in "
+				 << m_cmd_timeout_usec / 1000 << " msec";
+			try
+			{
+				DoneStatus done = m_daqservices[index]->getDoneStatus();
+				cerr << " (done seq " << done.done_seq << "/" << done.issued_seq
+					 << ", last done command " << done.done_command << ")";
+			}
+			catch (...)
+			{
+				cerr << " (no reply)";
+			}
+			cerr << '\n';
+			not_done++;
+		}
+		else if (usec >= slowest)
+		{
+			slowest = usec;
+			slowest_index = index;
+		}
+	}
+	if (not_done == 0)
+	{
+		m_timing.record(DAQMW::TIMING_CMD_DONE, daqcom, slowest);
+	}
+	if (m_debug && slowest_index >= 0)
+	{
+		cerr << "command " << daqcom << ": " << targets.size()
+			 << " components, slowest " << m_comp_ids[slowest_index]
+			 << " " << slowest << " usec" << '\n';
+	}
+	return not_done;
+}
+/*
+ * Stages of the data flow graph of the configuration file: the component
+ * of index startOrd - 1 gets an edge from every component its inPorts
+ * read from.  Without a usable graph (unknown from= or a cycle) every
+ * component is a stage of its own in startOrd order, as before.
+ * startOrd must number the components 1 ... comp_num, each once,
+ * otherwise -1 is returned.
+ */
+int DaqOperator::build_stages(CompGroupList &groupList)
+{
+	int comp_num = m_daqservices.size();
+	map<string, int> index_of;
+	vector<string> comp_of(comp_num); // component id by index
+	vector<pair<int, int>> edges;
+	bool ok = true;
+	int ret = 0;
+
+	for (auto &group : groupList)
+	{
+		string gid = group.getGroupId();
+		for (auto &comp : group.getCompInfoList())
+		{
+			string ord = comp.getStartupOrder();
+			int index = atoi(ord.c_str()) - 1;
+			if (index < 0 || index >= comp_num)
+			{
+				cerr << "### ERROR: " << comp.getId() << ": startOrd " << ord
+					 << " out of range 1.." << comp_num << '\n';
+				ret = -1;
+				continue;
+			}
+			if (!comp_of[index].empty())
+			{
+				cerr << "### ERROR: " << comp.getId() << ": startOrd " << ord
+					 << " already used by " << comp_of[index] << '\n';
+				ret = -1;
+				continue;
+			}
+			comp_of[index] = comp.getId();
+			index_of[gid + ":" + comp.getId()] = index;
+		}
+	}
+	for (int i = 0; i < comp_num; i++)
+	{
+		if (comp_of[i].empty())
+		{
+			cerr << "### ERROR: no component has startOrd " << i + 1 << '\n';
+			ret = -1;
+		}
+	}
+	if (ret < 0)
+	{
+		m_stages.clear();
+		return ret;
+	}
+	for (auto &group : groupList)
+	{
+		string gid = group.getGroupId();
+		for (auto &comp : group.getCompInfoList())
+		{
+			int index = index_of[gid + ":" + comp.getId()];
+			vector<string> from = comp.getFromOutPort();
+			for (unsigned int i = 0; i < from.size(); i++)
+			{
+				string up = gid + ":" + from[i].substr(0, from[i].find(':'));
+				if (index_of.find(up) == index_of.end())
+				{
+					cerr << "### WARNING: " << comp.getId() << ": unknown from " << from[i] << '\n';
+					ok = false;
+					continue;
+				}
+				edges.emplace_back(index_of[up], index);
+			}
+		}
+	}
+
+	if (!ok || !build_dataflow_stages(comp_num, edges, m_stages))
+	{
+		cerr << "### WARNING: no data flow stages, startOrd order is used\n";
+		m_stages.clear();
+		for (int i = 0; i < comp_num; i++)
+		{
+			m_stages.push_back(vector<int>(1, i));
+		}
+	}
+	if (m_debug)
+	{
+		for (unsigned int s = 0; s < m_stages.size(); s++)
+		{
+			cerr << "stage " << s << ":";
+			for (unsigned int i = 0; i < m_stages[s].size(); i++)
+			{
+				cerr << " " << m_stages[s][i];
+			}
+			cerr << '\n';
+		}
 	}
 	return 0;
 }
+/*
+ * fan_out_command() stage by stage: start and resume from the sinks to
+ * the sources, stop and pause (reverse) from the sources to the sinks,
+ * so a component only gets data after its consumers are running and
+ * stops only after its producers.  Components of one stage get the
+ * command concurrently.  Returns the number of components not done.
+ */
+int DaqOperator::staged_command(const vector<int> &targets, DAQCommand daqcom,
+								bool reverse)
+{
+	if (m_stages.empty())
+	{ // not configured from a file yet
+		return fan_out_command(targets, daqcom);
+	}
+	vector<bool> is_target(m_daqservices.size(), false);
+	for (unsigned int i = 0; i < targets.size(); i++)
+	{
+		is_target[targets[i]] = true;
+	}
+	int not_done = 0;
+	for (unsigned int n = 0; n < m_stages.size(); n++)
+	{
+		const vector<int> &stage = m_stages[reverse ? m_stages.size() - 1 - n : n];
+		vector<int> stage_targets;
+		for (unsigned int i = 0; i < stage.size(); i++)
+		{
+			if (stage[i] < (int)is_target.size() && is_target[stage[i]])
+			{
+				stage_targets.push_back(stage[i]);
+			}
+		}
+		if (!stage_targets.empty())
+		{
+			not_done += fan_out_command(stage_targets, daqcom);
+		}
+	}
+	return not_done;
+}
 int DaqOperator::set_time()
 {
 	TimeVal *st = new TimeVal;
@@ -780,20 +1296,21 @@ int DaqOperator::set_time()
 
 int DaqOperator::error_stop_procedure()
 {
-	Status_var status;
+	shared_ptr<const CompStatusCache::View> view = get_status_view();
 	m_com_completed = false;
+	int not_done = 0;
 
 	try
 	{
-		for (int i = (m_comp_num - 1); i >= 0; i--)
+		vector<int> targets;
+		for (int i = (int)view->items.size() - 1; i >= 0; i--)
 		{
-			status = m_daqservices[i]->getStatus();
-			if (status->comp_status == COMP_FATAL)
+			if (view->ok[i] && view->items[i].snapshot.status.comp_status == COMP_FATAL)
 			{ // RESTART
-				set_command(m_daqservices[i], CMD_STOP);
-				check_done(m_daqservices[i]);
+				targets.push_back(i);
 			}
 		}
+		not_done += staged_command(targets, CMD_STOP, true);
 	}
 	catch (...)
 	{
@@ -808,22 +1325,22 @@ int DaqOperator::error_stop_procedure()
 
 	try
 	{
-		for (auto &daqservice : m_daqservices)
+		// the states changed by the command above
+		view = refresh_status_view();
+		vector<int> targets;
+		for (int i = 0; i < (int)view->items.size(); i++)
 		{
-			status = daqservice->getStatus();
-			if (status->state == CONFIGURED)
+			if (view->ok[i] && view->items[i].snapshot.status.state == CONFIGURED)
 			{
-				set_command(daqservice, CMD_UNCONFIGURE);
-				check_done(daqservice);
+				targets.push_back(i);
 			}
 		}
+		not_done += fan_out_command(targets, CMD_UNCONFIGURE);
 
 		ParamList paramList;
-		for (int i = 0; i < (int)m_daqservices.size(); i++)
+		for (int i = 0; i < (int)view->items.size(); i++)
 		{
-			RTC::ConnectorProfileList_var myprof = m_DaqServicePorts[i]->get_connector_profiles();
-
-			char *id = CORBA::string_dup(myprof[0].name);
+			const string &id = view->items[i].id;
 
 			for (int j = 0; j < (int)paramList.size(); j++)
 			{
@@ -835,24 +1352,30 @@ int DaqOperator::error_stop_procedure()
 					m_daqservices[i]->setCompParams(paramList[j].getList());
 				}
 			}
-			CORBA::string_free(id);
 		}
 
-		for (auto &daqservice : m_daqservices)
+		view = refresh_status_view();
+		targets.clear();
+		for (int i = 0; i < (int)view->items.size(); i++)
 		{
-			status = daqservice->getStatus();
-			if (status->state == LOADED)
+			if (view->ok[i] && view->items[i].snapshot.status.state == LOADED)
 			{
-				set_command(daqservice, CMD_CONFIGURE);
-				check_done(daqservice);
+				targets.push_back(i);
 			}
 		}
+		not_done += fan_out_command(targets, CMD_CONFIGURE);
 	}
 	catch (...)
 	{
 		cerr << "### ERROR: DaqOperator: unconfigure, configure Components.\n";
 		return 1;
 	}
+	if (not_done > 0)
+	{
+		cerr << "### ERROR: DaqOperator: " << not_done
+			 << " Components not restarted(stop).\n";
+		return 1;
+	}
 
 	m_com_completed = true;
 	return 0;
@@ -860,7 +1383,8 @@ int DaqOperator::error_stop_procedure()
 int DaqOperator::other_stop_procedure()
 {
 	m_com_completed = false;
-	Status_var status;
+	// not the cached view: a component may have stopped meanwhile
+	shared_ptr<const CompStatusCache::View> view = refresh_status_view();
 
 	time_t now = time(0);
 	m_stop_date = asctime(localtime(&now));
@@ -869,15 +1393,19 @@ int DaqOperator::other_stop_procedure()
 
 	try
 	{
-		for (auto &daqservice : m_daqservices)
+		vector<int> targets;
+		for (int i = 0; i < (int)view->items.size(); i++)
 		{
-			status = daqservice->getStatus();
-			if (status->state == RUNNING)
+			if (view->ok[i] && view->items[i].snapshot.status.state == RUNNING)
 			{
-				set_command(daqservice, CMD_STOP);
-				check_done(daqservice);
+				targets.push_back(i);
 			}
 		}
+		if (staged_command(targets, CMD_STOP, true) > 0)
+		{
+			cerr << "### ERROR: DaqOperator: Components not stopped.\n";
+			return 1;
+		}
 	}
 	catch (...)
 	{
@@ -940,6 +1468,11 @@ int DaqOperator::configure_procedure()
 		m_comp_num = MyParser.readConfFile(m_conf_file.c_str(), true);
 		paramList = MyParser.getParamList();
 		groupList = MyParser.getGroupList();
+		if (build_stages(groupList) < 0)
+		{
+			cerr << "### ERROR: DaqOperator: bad startOrd in the Configuration file\n";
+			return 1;
+		}
 
 		if (m_debug)
 		{
@@ -1032,10 +1565,10 @@ int DaqOperator::configure_procedure()
 			CORBA::string_free(id);
 		}
 
-		for (auto &daqservice : m_daqservices)
+		if (fan_out_command(all_components(), CMD_CONFIGURE) > 0)
 		{
-			set_command(daqservice, CMD_CONFIGURE);
-			check_done(daqservice);
+			cerr << "### ERROR: DaqOperator: Components not configured.\n";
+			return 1;
 		}
 	}
 	catch (...)
@@ -1051,10 +1584,10 @@ int DaqOperator::unconfigure_procedure()
 	m_com_completed = false;
 	try
 	{
-		for (auto &daqservice : m_daqservices)
+		if (fan_out_command(all_components(), CMD_UNCONFIGURE) > 0)
 		{
-			set_command(daqservice, CMD_UNCONFIGURE);
-			check_done(daqservice);
+			cerr << "### ERROR: DaqOperator: Components not unconfigured.\n";
+			return 1;
 		}
 	}
 	catch (...)
@@ -1082,16 +1615,11 @@ int DaqOperator::start_procedure()
 			cerr << "start_parocedure: runno: " << m_runNumber << '\n';
 		}
 
-		for (auto &daqservice : m_daqservices)
-		{
-			set_runno(daqservice, m_runNumber);
-			check_done(daqservice);
-		}
-
-		for (auto &daqservice : m_daqservices)
+		// sets the run number, then CMD_START
+		if (staged_command(all_components(), CMD_START, false) > 0)
 		{
-			set_command(daqservice, CMD_START);
-			check_done(daqservice);
+			cerr << "### ERROR: DaqOperator: Components not started.\n";
+			return 1;
 		}
 	}
 	catch (...)
@@ -1107,16 +1635,17 @@ int DaqOperator::stop_procedure()
 	m_com_completed = false;
 	try
 	{
-		for (int i = (m_comp_num - 1); i >= 0; i--)
-		{
-			set_command(m_daqservices[i], CMD_STOP);
-			check_done(m_daqservices[i]);
-		}
+		int not_done = staged_command(all_components(), CMD_STOP, true);
 
 		time_t now = time(0);
 		m_stop_date = asctime(localtime(&now));
 		m_stop_date[m_stop_date.length() - 1] = ' ';
 		m_stop_date.erase(0, 4);
+		if (not_done > 0)
+		{
+			cerr << "### ERROR: DaqOperator: Components not stopped.\n";
+			return 1;
+		}
 	}
 	catch (...)
 	{
@@ -1134,10 +1663,10 @@ int DaqOperator::pause_procedure()
 	try
 	{
 
-		for (int i = (m_comp_num - 1); i >= 0; i--)
+		if (staged_command(all_components(), CMD_PAUSE, true) > 0)
 		{
-			set_command(m_daqservices[i], CMD_PAUSE);
-			check_done(m_daqservices[i]);
+			cerr << "### ERROR: DaqOperator: Components not paused.\n";
+			return 1;
 		}
 	}
 	catch (...)
@@ -1154,10 +1683,10 @@ int DaqOperator::resume_procedure()
 	try
 	{
 
-		for (auto &daqservice : m_daqservices)
+		if (staged_command(all_components(), CMD_RESUME, false) > 0)
 		{
-			set_command(daqservice, CMD_RESUME);
-			check_done(daqservice);
+			cerr << "### ERROR: DaqOperator: Components not resumed.\n";
+			return 1;
 		}
 	}
 	catch (...)
@@ -1199,6 +1728,21 @@ void DaqOperator::addCorbaPort()
 void DaqOperator::delCorbaPort() {}
 #endif
 
+/**
+ * Record command timing to path (see TimingRecorder.h).
+ */
+int DaqOperator::set_timing_file(string path)
+{
+	if (!m_timing.open(path))
+	{
+		return -1;
+	}
+	return 0;
+}
+void DaqOperator::set_command_timeout(int sec)
+{
+	m_cmd_timeout_usec = sec * 1000000LL;
+}
 void DaqOperator::set_console_flag(bool isConsole)
 {
 	cerr << "set_console_flag(): " << isConsole << '\n';
@@ -1267,7 +1811,11 @@ int DaqOperator::command_unconfigure()
 		cerr << "   Bad Command\n";
 		return 1;
 	}
-	unconfigure_procedure();
+	if (unconfigure_procedure() != 0)
+	{
+		createDom_ng("ResetParams");
+		return 1;
+	}
 	m_state = LOADED;
 	createDom_ok("ResetParams");
 	return 0;
@@ -1283,7 +1831,11 @@ int DaqOperator::command_start()
 		cerr << "   Bad Command\n";
 		return 1;
 	}
-	start_procedure();
+	if (start_procedure() != 0)
+	{
+		createDom_ng("Begin");
+		return 1;
+	}
 	m_state = RUNNING;
 	createDom_ok("Begin");
 	return 0;
@@ -1299,7 +1851,11 @@ int DaqOperator::command_stop()
 		return 1;
 	}
 
-	stop_procedure();
+	if (stop_procedure() != 0)
+	{
+		createDom_ng("End");
+		return 1;
+	}
 	m_state = CONFIGURED;
 	createDom_ok("End");
 
@@ -1318,7 +1874,11 @@ int DaqOperator::command_abort()
 	}
 
 	abort_procedure();
-	unconfigure_procedure();
+	if (unconfigure_procedure() != 0)
+	{
+		createDom_ng("Abort");
+		return 1;
+	}
 	m_state = LOADED;
 
 	createDom_ok("Abort");
@@ -1376,18 +1936,30 @@ int DaqOperator::command_log()
 
 	bool fatal_error = false;
 
-	for (int i = 0; i < m_comp_num; i++)
+	// last polled status, see get_status_view()
+	shared_ptr<const CompStatusCache::View> view = get_status_view();
+	for (int i = 0; i < m_comp_num && i < (int)view->items.size(); i++)
 	{
+		const CompSnapshot &item = view->items[i];
+		if (!item.polled)
+		{
+			continue;
+		}
+
+		groupStat.groupId = CORBA::string_dup(item.id.c_str());
 
-		RTC::ConnectorProfileList_var myprof = m_DaqServicePorts[i]->get_connector_profiles();
-		groupStat.groupId = CORBA::string_dup(myprof[0].name);
+		const Status &status = item.snapshot.status;
 
-		Status_var status = m_daqservices[i]->getStatus();
+		groupStat.comp_status.comp_name = CORBA::string_dup(status.comp_name);
+		groupStat.comp_status.state = status.state;
+		groupStat.comp_status.event_size = status.event_size;
+		groupStat.comp_status.comp_status = status.comp_status;
 
-		groupStat.comp_status.comp_name = CORBA::string_dup(status->comp_name);
-		groupStat.comp_status.state = status->state;
-		groupStat.comp_status.event_size = status->event_size;
-		groupStat.comp_status.comp_status = status->comp_status;
+		groupStat.has_metrics = item.has_metrics;
+		if (item.has_metrics)
+		{
+			groupStat.comp_metrics = item.metrics;
+		}
 
 		if (groupStat.comp_status.comp_status == COMP_FATAL)
 		{
@@ -1423,7 +1995,11 @@ int DaqOperator::command_pause()
 		return 1;
 	}
 
-	pause_procedure();
+	if (pause_procedure() != 0)
+	{
+		createDom_ng("Pause");
+		return 1;
+	}
 	m_state = PAUSED;
 
 	createDom_ok("Pause");
@@ -1438,7 +2014,11 @@ int DaqOperator::command_resume()
 		return 1;
 	}
 
-	resume_procedure();
+	if (resume_procedure() != 0)
+	{
+		createDom_ng("Restart");
+		return 1;
+	}
 	m_state = RUNNING;
 
 	createDom_ok("Restart");
@@ -1509,49 +2089,7 @@ int DaqOperator::reset_mytimer()
 }
 int DaqOperator::output_performance(int command)
 {
-	struct timeval start_time;
-	struct timezone tz;
-	struct passwd *pw;
-	uid_t uid;
-	char fname[256];
-	long gt[2];
-	const string fout = "s4i-output";
-	/* end time */
-	gettimeofday(&start_time, &tz);
-	gt[0] = start_time.tv_sec;
-	gt[1] = start_time.tv_usec;
-	uid = getuid();
-	if ((pw = getpwuid(uid)))
-	{
-		sprintf(fname, "/home/%s/DAQ-Middleware/csv/s4i/%s.csv", pw->pw_name, fout.c_str());
-	}
-	/* File  */
-	ofstream csv_file(fname, ios::app);
-	switch (command)
-	{
-	case CMD_CONFIGURE:
-		csv_file << "st,Configure," << gt[0] << ',' << gt[1] << '\n';
-		break;
-	case CMD_START:
-		csv_file << "st,Start," << gt[0] << ',' << gt[1] << '\n';
-		break;
-	case CMD_STOP:
-		csv_file << "st,Stop," << gt[0] << ',' << gt[1] << '\n';
-		break;
-	case CMD_UNCONFIGURE:
-		csv_file << "st,Unconfigure," << gt[0] << ',' << gt[1] << '\n';
-		break;
-	case CMD_PAUSE:
-		csv_file << "st,Pause," << gt[0] << ',' << gt[1] << '\n';
-		break;
-	case CMD_RESUME:
-		csv_file << "st,Resume," << gt[0] << ',' << gt[1] << '\n';
-		break;
-	case CMD_RESTART:
-		csv_file << "st,Restart," << gt[0] << ',' << gt[1] << '\n';
-		break;
-	}
-	csv_file.close();
+	m_timing.record(DAQMW::TIMING_CMD_SEND, command);
 	return 0;
 }
 int DaqOperator::state_change_automation()
@@ -31,11 +31,12 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <fstream>
 #include <cstdlib>
-#include <pwd.h>
 #include <sys/select.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include "DAQServiceStub.h"
 
@@ -47,6 +48,10 @@
 #include "ParameterServer.h"
 
 #include "Timer.h"
+#include "TimingRecorder.h"
+#include "CommandFanOut.h"
+#include "DataFlowStages.h"
+#include "StatusCache.h"
 
 using namespace std;
 using namespace RTC;
@@ -110,6 +115,8 @@ class DaqOperator
     int command_dummy();
 
     void set_console_flag(bool console);
+    int set_timing_file(string path);
+    void set_command_timeout(int sec);
     void set_port_no(int port);
     string getConfFilePath();
 
@@ -124,7 +131,7 @@ class DaqOperator
     int m_comp_num;
     int m_service_num;
     int set_runno(RTC::CorbaConsumer<DAQService> daqservice, unsigned runno);
-    int set_command(RTC::CorbaConsumer<DAQService> daqservice, DAQCommand daqcom);
+    RTC::ReturnCode_t set_command(RTC::CorbaConsumer<DAQService> daqservice, DAQCommand daqcom);
 
     /* Add flags */
     bool deadFlag; // Dead flag
@@ -147,12 +154,64 @@ class DaqOperator
     int clockwork_hb_recv();
     int reset_mytimer();
 
+    /* Component status polled in the background (StatusCache.h) */
+    struct CompSnapshot
+    {
+        string id;                // connector profile name, group:component
+        bool has_id = false;
+        bool polled = false;      // snapshot holds an answer
+        Snapshot snapshot;
+        bool has_metrics = false; // HTTP mode only, for the log
+        Metrics metrics;
+    };
+    typedef StatusCache<CompSnapshot> CompStatusCache;
+    // one background poll per interval, whatever the onExecute() rate;
+    // the heartbeat check needs a fresh hb_count every heartbeat cycle
+    static constexpr int STATUS_POLL_MSEC = 500;
+    static_assert(STATUS_POLL_MSEC <= HB_CYCLE_SEC * 1000,
+                  "status poll slower than the heartbeat cycle");
+    CompStatusCache m_status_cache;
+    vector<CORBA::ULong> m_hb_seen; // hb_count of the last heartbeat cycle
+    vector<int> m_hb_miss;          // heartbeat cycles without a new hb_count
+    bool poll_component(unsigned int index, CompSnapshot &item);
+    shared_ptr<const CompStatusCache::View> get_status_view();
+    shared_ptr<const CompStatusCache::View> refresh_status_view();
+
     /* Time measurement */
     int set_time();
     int output_performance(int command);
     int state_change_automation();
 
-    int check_done(RTC::CorbaConsumer<DAQService> daqservice);
+    /* Concurrent command fan-out */
+    static constexpr int MAX_FANOUT_THREADS = 64;
+    static constexpr int CMD_TIMEOUT_SEC = 10;
+    static constexpr int CMD_SLOW_MSEC = 1000;      // warn while waiting
+    static constexpr int WAIT_DONE_SLICE_MSEC = 1000; // one waitDone() call
+    CommandFanOut m_fanout;
+    struct FanOutResult
+    {
+        mutex usec_mutex;
+        vector<long long> usec; // per task, -1: not done
+        vector<bool> refused;   // per task, setCommand() refused
+        vector<bool> rejected;  // per task, illegal transition for the component
+    };
+    long long m_cmd_timeout_usec;
+    long long m_cmd_slow_usec;
+    vector<long long> m_cmd_usec; // per component, last command, -1: not done
+    vector<string> m_comp_ids;
+    vector<int> all_components();
+    int fan_out_command(const vector<int> &targets, DAQCommand daqcom);
+    bool wait_done(int index, const struct timespec &start,
+                   const struct timespec &deadline);
+    bool done_rejected(int index);
+    string get_comp_id(int index);
+    bool find_comp_id(int index, string &id);
+
+    /* Start/stop stages from the data flow (inPort from=) */
+    vector<vector<int>> m_stages; // sinks first, sources last
+    int build_stages(CompGroupList &groupList);
+    int staged_command(const vector<int> &targets, DAQCommand daqcom, bool reverse);
+
     int set_sitcp_num(int sitcp_num);
     int set_service_list();
 
@@ -214,6 +273,7 @@ class DaqOperator
 
     bool m_debug;
     bool m_time;
+    DAQMW::TimingRecorder m_timing;
 };
 extern "C"
 {
@@ -38,12 +38,20 @@ struct inport_info {
     std::string buffer_read_timeout;      // 0.005 5m sec
     std::string buffer_write_timeout;     // 0.005 5m sec
     std::string buffer_length;            // 256
+    std::string transport;                // corba or shm
     PortService_ptr inport_ptr;
     ConnectorProfile prof;
 };
 
 struct outport_info {
     std::string outport_name;
+    std::string subscription_type;        // flush, new or periodic
+    std::string push_interval;            // 1.0 Hz (periodic)
+    std::string buffer_read_empty_policy; // block
+    std::string buffer_write_full_policy; // block
+    std::string buffer_read_timeout;      // 0.005 5m sec
+    std::string buffer_write_timeout;     // 0.005 5m sec
+    std::string buffer_length;            // 8
     PortService_ptr outport_ptr;
 };
 
@@ -81,6 +89,8 @@ std::string xml_file = "";         //initial value
 int port_param_server = 30000;     //initial value
 std::string host_ns = "localhost"; //initial value
 std::string port_ns = "9876";      //initial value
+std::string timing_file = "";      //initial value
+int cmd_timeout_sec = 0;           //0: DaqOperator default
 constexpr int port_no = 30000;
 constexpr int FIND_COMP_RETRY_MAX_CNTS = 20;
 
@@ -246,6 +256,7 @@ int find_comps(CorbaNaming* naming, CompGroupList* daq_group_list)
                     std::vector<std::string> myBufferWriteTimeout = p.getBufferWriteTimeout();
                     std::vector<std::string> myBufferReadEmptyPolicy = p.getBufferReadEmptyPolicy();
                     std::vector<std::string> myBufferWriteFullPolicy = p.getBufferWriteFullPolicy();
+                    std::vector<std::string> myTransport = p.getTransport();
                     if (debug) {
                         std::cerr << "*** DataInPort\n";
                         std::cerr << "    myInport:" << myInport[0] << std::endl;
@@ -261,6 +272,7 @@ int find_comps(CorbaNaming* naming, CompGroupList* daq_group_list)
                         inport_info.buffer_write_timeout = myBufferWriteTimeout[inport_count];
                         inport_info.buffer_read_empty_policy = myBufferReadEmptyPolicy[inport_count];
                         inport_info.buffer_write_full_policy = myBufferWriteFullPolicy[inport_count];
+                        inport_info.transport = myTransport[inport_count];
                         if (debug) {
                             std::cerr << "  inport_info.inport_name:" << inport_info.inport_name << std::endl;
                             std::cerr << "  inport_info.from_name:"   << inport_info.from_name   << std::endl;
@@ -269,6 +281,7 @@ int find_comps(CorbaNaming* naming, CompGroupList* daq_group_list)
                             std::cerr << "  inport_info.buffer_write_timeout:"  << inport_info.buffer_write_timeout << std::endl;
                             std::cerr << "  inport_info.buffer_read_emtpy_policy:"  << inport_info.buffer_read_empty_policy << std::endl;
                             std::cerr << "  inport_info.buffer_write_full_policy:"  << inport_info.buffer_write_full_policy << std::endl;
+                            std::cerr << "  inport_info.transport:"  << inport_info.transport << std::endl;
                         }
 
                         inport_info.inport_ptr  = port;
@@ -283,6 +296,13 @@ int find_comps(CorbaNaming* naming, CompGroupList* daq_group_list)
                         std::cerr << "    myOutport:" << myOutport[outport_count] << std::endl;
                         outport_info.outport_name = gid + p.getId() + ":" + myOutport[outport_count];
                         outport_info.outport_ptr  = port;
+                        outport_info.subscription_type = p.getOutSubscriptionType()[outport_count];
+                        outport_info.push_interval     = p.getOutPushInterval()[outport_count];
+                        outport_info.buffer_length     = p.getOutBufferLength()[outport_count];
+                        outport_info.buffer_read_timeout  = p.getOutBufferReadTimeout()[outport_count];
+                        outport_info.buffer_write_timeout = p.getOutBufferWriteTimeout()[outport_count];
+                        outport_info.buffer_read_empty_policy = p.getOutBufferReadEmptyPolicy()[outport_count];
+                        outport_info.buffer_write_full_policy = p.getOutBufferWriteFullPolicy()[outport_count];
                         outport_list.emplace_back(outport_info);
                         outport_count++;
                     }
@@ -344,19 +364,25 @@ int connect_data_ports()
 
                 prof.ports[1] = outport_list[index2].outport_ptr;
 
+                // transport="shm": shared memory ring (ShmTransport.h),
+                // both components must run on the same host
+                std::string interface_type = "corba_cdr";
+                if (inport_list[index].transport == "shm") {
+                    interface_type = "shm_ring";
+                }
                 CORBA_SeqUtil::push_back(prof.properties,
                                          NVUtil::newNV("dataport.interface_type",
                                                        ///"CORBA_Any"));
-                                                       "corba_cdr"));
+                                                       interface_type.c_str()));
                 CORBA_SeqUtil::push_back(prof.properties,
                                          NVUtil::newNV("dataport.dataflow_type",
                                                        "push"));
                 CORBA_SeqUtil::push_back(prof.properties,
                                          NVUtil::newNV("dataport.subscription_type",
-                                                       "flush"));
+                                                       outport_list[index2].subscription_type.c_str()));
                 CORBA_SeqUtil::push_back(prof.properties,
                                          NVUtil::newNV("dataport.push_interval",
-                                                       "1.0"));
+                                                       outport_list[index2].push_interval.c_str()));
                 /**
                  *  Added new buffer properties from OpenRTM-aist-1.0.0
                  */
@@ -375,13 +401,35 @@ int connect_data_ports()
                 CORBA_SeqUtil::push_back(prof.properties,
                                          NVUtil::newNV("dataport.inport.buffer.length",
                                                        inport_list[index].buffer_length.c_str()));
+                /**
+                 *  OutPort buffer between OutPort::write() and the publisher
+                 *  thread, only used with subscription_type new or periodic
+                 */
+                CORBA_SeqUtil::push_back(prof.properties,
+                                         NVUtil::newNV("dataport.outport.buffer.read.empty_policy",
+                                                       outport_list[index2].buffer_read_empty_policy.c_str()));
+                CORBA_SeqUtil::push_back(prof.properties,
+                                         NVUtil::newNV("dataport.outport.buffer.write.full_policy",
+                                                       outport_list[index2].buffer_write_full_policy.c_str()));
+                CORBA_SeqUtil::push_back(prof.properties,
+                                         NVUtil::newNV("dataport.outport.buffer.read.timeout",
+                                                       outport_list[index2].buffer_read_timeout.c_str()));
+                CORBA_SeqUtil::push_back(prof.properties,
+                                         NVUtil::newNV("dataport.outport.buffer.write.timeout",
+                                                       outport_list[index2].buffer_write_timeout.c_str()));
+                CORBA_SeqUtil::push_back(prof.properties,
+                                         NVUtil::newNV("dataport.outport.buffer.length",
+                                                       outport_list[index2].buffer_length.c_str()));
                 // debug = true;
                 if (debug) {
                     std::cerr << "buffer_read_empty_policy: " << inport_list[index].buffer_read_empty_policy << std::endl;
                     std::cerr << "buffer_write_full_policy: " << inport_list[index].buffer_write_full_policy << std::endl;
+                    std::cerr << "transport:                " << inport_list[index].transport                << std::endl;
                     std::cerr << "buffer_read_timeout:      " << inport_list[index].buffer_read_timeout      << std::endl;
                     std::cerr << "buffer_write_timeout:     " << inport_list[index].buffer_write_timeout     << std::endl;
                     std::cerr << "buffer_length:            " << inport_list[index].buffer_length            << std::endl;
+                    std::cerr << "subscription_type:        " << outport_list[index2].subscription_type      << std::endl;
+                    std::cerr << "outport buffer_length:    " << outport_list[index2].buffer_length          << std::endl;
                 }
                 // debug = false;
 
@@ -532,6 +580,12 @@ void MyModuleInit(RTC::Manager* manager)
     }
     DaqOperator* daq = (DaqOperator*)comp;
     daq->set_console_flag(isConsoleMode);
+    if (timing_file != "") {
+        daq->set_timing_file(timing_file);
+    }
+    if (cmd_timeout_sec > 0) {
+        daq->set_command_timeout(cmd_timeout_sec);
+    }
     if (debug) {
     std::cerr << "conf:" << xml_file << std::endl;
     }
@@ -622,9 +676,11 @@ int main (int argc, char** argv)
        h: Host name of Name Server of Omni ORB
        p: Port NO. of Name Server of Omni ORB
        c: Use console mode
+       t: File name of command timing record (CSV)
+       T: Timeout of a command to all components (sec)
     */
 
-    while( (result = getopt(argc, argv, "x:w:h:p:f:c")) != -1 ) {
+    while( (result = getopt(argc, argv, "x:w:h:p:f:ct:T:")) != -1 ) {
         switch(result) {
         case 'c':
             isConsoleMode = true;
@@ -648,6 +704,14 @@ int main (int argc, char** argv)
             std::cerr << "Port NO. of Corba NS: "
                       << port_ns << std::endl;
             break;
+        case 't':
+            timing_file = optarg;
+            std::cerr << "Timing record file: " << timing_file << std::endl;
+            break;
+        case 'T':
+            cmd_timeout_sec = atoi(optarg);
+            std::cerr << "Command timeout (sec): " << cmd_timeout_sec << std::endl;
+            break;
         }
     }
 
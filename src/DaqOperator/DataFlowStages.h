@@ -0,0 +1,82 @@
+// -*- C++ -*-
+/*!
+ * @file DataFlowStages.h
+ * @brief Start/stop stages of the components from the data flow graph
+ *
+ */
+
+#ifndef DATAFLOWSTAGES_H
+#define DATAFLOWSTAGES_H
+
+#include <utility>
+#include <vector>
+
+/**
+ *  Group comp_num components into stages by the data flow
+ *  (edges: upstream index, downstream index, one per inPort).
+ *
+ *  stages[0] holds the components nobody downstream waits for (sinks),
+ *  stages[k] the ones whose consumers are all in stages[0..k-1], so the
+ *  sources come last.  Start runs the stages in this order, stop in the
+ *  reverse order; the components of one stage are independent of each
+ *  other and get the command concurrently.  The number of stages is the
+ *  depth of the pipeline.
+ *
+ *  Returns false (stages empty) if the graph has a cycle or an edge
+ *  outside [0, comp_num).
+ */
+inline bool build_dataflow_stages(int comp_num,
+                                  const std::vector<std::pair<int, int> > &edges,
+                                  std::vector<std::vector<int> > &stages)
+{
+    stages.clear();
+    std::vector<int> consumers(comp_num, 0);          // not yet staged
+    std::vector<std::vector<int> > producers(comp_num);
+    for (unsigned int i = 0; i < edges.size(); i++)
+    {
+        int up = edges[i].first;
+        int down = edges[i].second;
+        if (up < 0 || up >= comp_num || down < 0 || down >= comp_num)
+        {
+            return false;
+        }
+        consumers[up]++;
+        producers[down].push_back(up);
+    }
+
+    std::vector<int> stage;
+    for (int i = 0; i < comp_num; i++)
+    {
+        if (consumers[i] == 0)
+        {
+            stage.push_back(i);
+        }
+    }
+    int staged = 0;
+    while (!stage.empty())
+    {
+        staged += stage.size();
+        std::vector<int> next;
+        for (unsigned int i = 0; i < stage.size(); i++)
+        {
+            const std::vector<int> &up = producers[stage[i]];
+            for (unsigned int j = 0; j < up.size(); j++)
+            {
+                if (--consumers[up[j]] == 0)
+                {
+                    next.push_back(up[j]);
+                }
+            }
+        }
+        stages.push_back(stage);
+        stage.swap(next);
+    }
+    if (staged != comp_num)
+    { // cycle
+        stages.clear();
+        return false;
+    }
+    return true;
+}
+
+#endif // DATAFLOWSTAGES_H
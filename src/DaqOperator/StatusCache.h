@@ -0,0 +1,160 @@
+// -*- C++ -*-
+/*!
+ * @file StatusCache.h
+ * @brief Status of the components polled by a background thread
+ *
+ */
+
+#ifndef STATUSCACHE_H
+#define STATUSCACHE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+/*!
+ * @class StatusCache
+ * @brief keeps the last polled status of every component
+ *
+ * A worker thread calls poll(i, item) for every component each interval
+ * and publishes the results as a new View.  A view is never modified
+ * once published: readers take the current one with get() and may keep
+ * it as long as they like, so reading the status costs no remote call
+ * and never waits for a slow component.  Views are numbered, a larger
+ * version is a later poll.
+ *
+ * poll() gets the item of the previous view and returns false if the
+ * component did not answer; the item then stays as last known.
+ */
+template <class T>
+class StatusCache
+{
+  public:
+    struct View
+    {
+        unsigned long version;  // 0: nothing polled yet
+        struct timespec time;   // CLOCK_MONOTONIC at the end of the poll
+        std::vector<T> items;
+        std::vector<bool> ok;   // false: the last poll failed
+    };
+    typedef std::function<bool(unsigned int index, T &item)> PollFunc;
+
+    StatusCache()
+        : m_view(new View()), m_interval_usec(0),
+          m_started(0), m_published(0), m_wake(false), m_stop(false)
+    {
+    }
+
+    virtual ~StatusCache()
+    {
+        stop();
+    }
+
+    void start(unsigned int item_num, PollFunc poll, long long interval_usec)
+    {
+        stop();
+        std::shared_ptr<View> view(new View());
+        view->version = m_published;
+        view->time.tv_sec = 0;
+        view->time.tv_nsec = 0;
+        view->items.resize(item_num);
+        view->ok.assign(item_num, false);
+        std::atomic_store(&m_view, std::shared_ptr<const View>(view));
+
+        m_poll = poll;
+        m_interval_usec = interval_usec;
+        m_stop = false;
+        m_wake = false;
+        m_thread = std::thread(&StatusCache::poll_loop, this);
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake_cv.notify_all();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    bool running() const
+    {
+        return m_thread.joinable();
+    }
+
+    /// the last published view
+    std::shared_ptr<const View> get() const
+    {
+        return std::atomic_load(&m_view);
+    }
+
+    /**
+     *  Poll now and wait until a poll started after this call is
+     *  published, at most timeout_usec.  For callers that just changed
+     *  the state of the components and must not see the old one.
+     */
+    std::shared_ptr<const View> refresh(long long timeout_usec)
+    {
+        if (running())
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            unsigned long want = m_started + 1;
+            m_wake = true;
+            m_wake_cv.notify_all();
+            m_done_cv.wait_for(lock, std::chrono::microseconds(timeout_usec),
+                               [this, want] { return m_stop || m_published >= want; });
+        }
+        return get();
+    }
+
+  private:
+    void poll_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop)
+        {
+            unsigned long version = ++m_started;
+            m_wake = false;
+            lock.unlock();
+
+            std::shared_ptr<View> view(new View(*get()));
+            view->version = version;
+            for (unsigned int i = 0; i < view->items.size(); i++)
+            {
+                view->ok[i] = m_poll(i, view->items[i]);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &view->time);
+            std::atomic_store(&m_view, std::shared_ptr<const View>(view));
+
+            lock.lock();
+            m_published = version;
+            m_done_cv.notify_all();
+            m_wake_cv.wait_for(lock, std::chrono::microseconds(m_interval_usec),
+                               [this] { return m_stop || m_wake; });
+        }
+    }
+
+    std::shared_ptr<const View> m_view; // std::atomic_load/store only
+    PollFunc m_poll;
+    long long m_interval_usec;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake_cv;
+    std::condition_variable m_done_cv;
+    std::thread m_thread;
+    unsigned long m_started;   // version of the poll running or last run
+    unsigned long m_published; // version of m_view
+    bool m_wake;
+    bool m_stop;
+};
+
+#endif // STATUSCACHE_H
@@ -31,6 +31,7 @@ OBJS     += $(subst .cpp,.o, $(SRCS))
 
 CXXFLAGS += $(shell rtm-config --cflags)
 LDFLAGS  += $(shell rtm-config --libs)
+LDLIBS   += -lrt # shm_open() for ShmTransport.h
 SHFLAGS  = -shared
 
 IDLC     = `rtm-config --idlc`